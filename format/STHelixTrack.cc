@@ -1,6 +1,8 @@
 #include "STHelixTrack.hh"
 
 #include <iostream>
+#include <algorithm>
+#include <limits>
 using namespace std;
 
 ClassImp(STHelixTrack)
@@ -49,16 +51,23 @@ void STHelixTrack::Clear(Option_t *option)
 
   fIsPositiveChargeParticle = true;
 
+  // TClonesArray::Clear("C") calls Clear("") of each track: hits and clusters
+  // belong to their own array and clear() keeps the capacity for the next event.
   if (TString(option) == "C")
     DeleteHits();
   else {
     fMainHits.clear();
     fCandHits.clear();
     fHitClusters.clear();
+
+    fHitOrder.clear();
+    fNumHitOrderKeys = 0;
+    fHitGeneration++;
   }
 
   fMainHitIDs.clear();
   fClusterIDs.clear();
+  fdEdxArray.clear();
 
   fGenfitID  = -999;
   fGenfitMomentum = -999;
@@ -114,6 +123,8 @@ void STHelixTrack::AddHit(STHit *hit)
   fChargeSum = W;
 
   fMainHits.push_back(hit);
+  fHitOrder.push_back(std::make_pair(0., hit));
+  fHitGeneration++;
 }
 
 void STHelixTrack::Remove(STHit *hit)
@@ -133,6 +144,16 @@ void STHelixTrack::Remove(STHit *hit)
     }
   }
 
+  auto numOrdered = fHitOrder.size();
+  for (auto iHit = 0; iHit < numOrdered; iHit++) {
+    if (fHitOrder[iHit].second == hit) {
+      fHitOrder.erase(fHitOrder.begin()+iHit);
+      if (iHit < fNumHitOrderKeys)
+        fNumHitOrderKeys--;
+      break;
+    }
+  }
+
   fExpectationX = (fChargeSum * fExpectationX - w * x) / W;
   fExpectationY = (fChargeSum * fExpectationY - w * y) / W;
   fExpectationZ = (fChargeSum * fExpectationZ - w * z) / W;
@@ -146,6 +167,7 @@ void STHelixTrack::Remove(STHit *hit)
   fExpectationZX = (fChargeSum * fExpectationZX - w * z * x) / W;
 
   fChargeSum = W;
+  fHitGeneration++;
 }
 
 void STHelixTrack::DeleteHits()
@@ -154,6 +176,9 @@ void STHelixTrack::DeleteHits()
     delete hit;
 
   fMainHits.clear();
+  fHitOrder.clear();
+  fNumHitOrderKeys = 0;
+  fHitGeneration++;
 
   for (auto hit : fCandHits)
     delete hit;
@@ -166,15 +191,66 @@ void STHelixTrack::DeleteHits()
   fHitClusters.clear();
 }
 
-void STHelixTrack::SortHits(bool increasing)
+bool STHelixTrack::IsHitOrderCurrent() const
 {
-  if (increasing) {
-    auto sorting = STHitSortByIncreasingLength(this);
-    sort(fMainHits.begin(), fMainHits.end(), sorting);
-  } else {
-    auto sorting = STHitSortByDecreasingLength(this);
-    sort(fMainHits.begin(), fMainHits.end(), sorting);
+  return fHitOrderParams[0] == fXHelixCenter
+      && fHitOrderParams[1] == fZHelixCenter
+      && fHitOrderParams[2] == fHelixRadius
+      && fHitOrderParams[3] == fYInitial
+      && fHitOrderParams[4] == fAlphaSlope
+      && fHitOrderParams[5] == fAlphaHead
+      && fHitOrderParams[6] == fAlphaTail
+      && fHitOrderParams[7] == fRMSH;
+}
+
+void STHelixTrack::UpdateHitOrder()
+{
+  auto numHits = fMainHits.size();
+
+  // Hit array was changed without AddHit() or Remove()
+  if (fHitOrder.size() != numHits) {
+    fHitOrder.clear();
+    for (auto hit : fMainHits)
+      fHitOrder.push_back(std::make_pair(0., hit));
+    fNumHitOrderKeys = 0;
   }
+
+  if (fNumHitOrderKeys > 0 && !IsHitOrderCurrent())
+    fNumHitOrderKeys = 0;
+
+  if (fNumHitOrderKeys == numHits)
+    return;
+
+  fHitOrderParams[0] = fXHelixCenter;
+  fHitOrderParams[1] = fZHelixCenter;
+  fHitOrderParams[2] = fHelixRadius;
+  fHitOrderParams[3] = fYInitial;
+  fHitOrderParams[4] = fAlphaSlope;
+  fHitOrderParams[5] = fAlphaHead;
+  fHitOrderParams[6] = fAlphaTail;
+  fHitOrderParams[7] = fRMSH;
+
+  for (auto iHit = fNumHitOrderKeys; iHit < numHits; iHit++)
+    fHitOrder[iHit].first = Map(fHitOrder[iHit].second -> GetPosition()).Z();
+
+  auto byKey = [](const std::pair<Double_t, STHit *> &a, const std::pair<Double_t, STHit *> &b) { return a.first < b.first; };
+
+  // Sort the hits without keys and merge them into the ordered part
+  auto middle = fHitOrder.begin() + fNumHitOrderKeys;
+  stable_sort(middle, fHitOrder.end(), byKey);
+  if (fNumHitOrderKeys > 0)
+    inplace_merge(fHitOrder.begin(), middle, fHitOrder.end(), byKey);
+
+  fNumHitOrderKeys = numHits;
+}
+
+void STHelixTrack::SortHits(bool increasing)
+{
+  UpdateHitOrder();
+
+  auto numHits = fHitOrder.size();
+  for (auto iHit = 0; iHit < numHits; iHit++)
+    fMainHits[iHit] = fHitOrder[increasing ? iHit : numHits-iHit-1].second;
 }
 
 void STHelixTrack::SortClusters(bool increasing)
@@ -933,6 +1009,174 @@ STHelixTrack::ExtrapolateByMap(TVector3 p, TVector3 &q, TVector3 &m) const
   return alpha * fHelixRadius / TMath::Cos(DipAngle()); 
 }
 
+namespace {
+  /// Body of STHelixTrack::FastATan2(), inlined into the loop of MapBatch()
+  template <typename T>
+  inline T ATan2Poly(T y, T x)
+  {
+    const T pi = T(TMath::Pi());
+
+    T ax = std::abs(x);
+    T ay = std::abs(y);
+    T tMax = std::max(ax, ay);
+    T t = std::min(ax, ay) / std::max(tMax, std::numeric_limits<T>::min());
+    T s = t * t;
+
+    // atan(t) ~ t * P(t^2) on [0, 1], minimax coefficients of P
+    T a =            T(-1.50942342057007523e-03);
+    a = a * s + T( 9.56790900748308852e-03);
+    a = a * s + T(-2.84919080409160050e-02);
+    a = a * s + T( 5.50293321997897608e-02);
+    a = a * s + T(-8.21384120321045346e-02);
+    a = a * s + T( 1.08780409248821243e-01);
+    a = a * s + T(-1.42472297661412517e-01);
+    a = a * s + T( 1.99964376893974543e-01);
+    a = a * s + T(-3.33331804260444961e-01);
+    a = a * s + T( 9.99999980568374852e-01);
+    a = a * t;
+
+    // Octant selection as arithmetic instead of branches: a or (c - a) by the flag 0/1
+    T swap = T(ay > ax);
+    T negX = T(std::signbit(x));
+    a = swap * T(.5) * pi + (1 - 2 * swap) * a;
+    a = negX * pi + (1 - 2 * negX) * a;
+
+    return std::copysign(a, y);
+  }
+}
+
+template <typename T>
+T
+STHelixTrack::FastATan2(T y, T x)
+{
+  return ATan2Poly(y, x);
+}
+
+template <>
+void
+STHelixTrack::MapBatch<Double_t>(Int_t n, const Double_t *x, const Double_t *y, const Double_t *z,
+                                 Double_t *w, Double_t *h, Double_t *l, Double_t *alpha) const
+{
+  Double_t lHead = ExtrapolateToAlpha(fAlphaHead);
+  Double_t lTail = ExtrapolateToAlpha(fAlphaTail);
+  Double_t lOff = lHead;
+  if (lHead > lTail)
+    lOff = lTail;
+
+  const Double_t xC = fXHelixCenter;
+  const Double_t zC = fZHelixCenter;
+  const Double_t radius = fHelixRadius;
+  const Double_t slope = fAlphaSlope;
+  const Double_t yInitial = fYInitial;
+  const Double_t lengthPerAlpha = ExtrapolateToAlpha(1.);
+  const Double_t invCosDip = 1. / TMath::Cos(DipAngle());
+  const Double_t sinDip = TMath::Sin(DipAngle());
+
+  auto MapPoint = [&](Int_t i) {
+    Double_t dx = x[i] - xC;
+    Double_t dz = z[i] - zC;
+    Double_t a = ATan2Poly(dz, dx);
+    Double_t dy = y[i] - (a * slope + yInitial);
+    w[i] = std::sqrt(dx*dx + dz*dz) - radius;
+    h[i] = dy * invCosDip;
+    l[i] = a * lengthPerAlpha + dy * sinDip - lOff;
+    return a;
+  };
+
+  if (alpha == nullptr) {
+    for (Int_t i = 0; i < n; i++)
+      MapPoint(i);
+  }
+  else {
+    for (Int_t i = 0; i < n; i++)
+      alpha[i] = MapPoint(i);
+  }
+}
+
+template <typename T>
+void
+STHelixTrack::MapBatch(Int_t n, const T *x, const T *y, const T *z,
+                       T *w, T *h, T *l, T *alpha) const
+{
+  Double_t lHead = ExtrapolateToAlpha(fAlphaHead);
+  Double_t lTail = ExtrapolateToAlpha(fAlphaTail);
+  Double_t lOff = lHead;
+  if (lHead > lTail)
+    lOff = lTail;
+
+  // Reference on the helix at the head: position, radial and tangential unit vectors
+  Double_t cosRef = TMath::Cos(fAlphaHead);
+  Double_t sinRef = TMath::Sin(fAlphaHead);
+  Double_t alphaRef = TMath::ATan2(sinRef, cosRef);
+  Double_t lengthPerAlpha = ExtrapolateToAlpha(1.);
+
+  const T xRef = fXHelixCenter + fHelixRadius * cosRef;
+  const T zRef = fZHelixCenter + fHelixRadius * sinRef;
+  const T yRef = alphaRef * fAlphaSlope + fYInitial;
+  const T lRef = alphaRef * lengthPerAlpha - lOff;
+  const T ux = cosRef;
+  const T uz = sinRef;
+  const T aRef = alphaRef;
+  const T radius = fHelixRadius;
+  const T slope = fAlphaSlope;
+  const T lPerA = lengthPerAlpha;
+  const T invCosDip = 1. / TMath::Cos(DipAngle());
+  const T sinDip = TMath::Sin(DipAngle());
+  const T pi = T(TMath::Pi());
+  const T twoPi = T(TMath::TwoPi());
+
+  // Points are mapped in blocks into local buffers, so that the loop has a fixed
+  // trip count and its stores cannot alias the input arrays.
+  const Int_t numBlock = 64;
+  T wBlock[numBlock], hBlock[numBlock], lBlock[numBlock], aBlock[numBlock];
+
+  auto MapBlock = [&](Int_t begin, Int_t num) {
+    const T *xBlock = x + begin;
+    const T *yBlock = y + begin;
+    const T *zBlock = z + begin;
+
+    for (Int_t i = 0; i < num; i++) {
+      T dx = xBlock[i] - xRef;
+      T dz = zBlock[i] - zRef;
+      T du = dx * ux + dz * uz;  // radial
+      T dt = dz * ux - dx * uz;  // tangential
+      T rU = radius + du;
+      T rho = std::sqrt(rU*rU + dt*dt);
+
+      // alpha from the reference, wrapped so that alpha is in (-pi, pi] as in Map()
+      T dAlpha = ATan2Poly(dt, rU);
+      T sum = aRef + dAlpha;
+      dAlpha = dAlpha + twoPi * (T(sum <= -pi) - T(sum > pi));
+
+      T dy = (yBlock[i] - yRef) - dAlpha * slope;
+      wBlock[i] = (2 * radius * du + du*du + dt*dt) / (rho + radius);
+      hBlock[i] = dy * invCosDip;
+      lBlock[i] = lRef + dAlpha * lPerA + dy * sinDip;
+      aBlock[i] = aRef + dAlpha;
+    }
+  };
+
+  for (Int_t begin = 0; begin < n; begin += numBlock)
+  {
+    Int_t num = std::min(numBlock, n - begin);
+    if (num == numBlock)
+      MapBlock(begin, numBlock);
+    else
+      MapBlock(begin, num);
+
+    std::copy(wBlock, wBlock + num, w + begin);
+    std::copy(hBlock, hBlock + num, h + begin);
+    std::copy(lBlock, lBlock + num, l + begin);
+    if (alpha != nullptr)
+      std::copy(aBlock, aBlock + num, alpha + begin);
+  }
+}
+
+template Double_t STHelixTrack::FastATan2<Double_t>(Double_t, Double_t);
+template Float_t STHelixTrack::FastATan2<Float_t>(Float_t, Float_t);
+template void STHelixTrack::MapBatch<Float_t>(Int_t, const Float_t *, const Float_t *, const Float_t *,
+                                              Float_t *, Float_t *, Float_t *, Float_t *) const;
+
 Double_t 
 STHelixTrack::Continuity(Double_t &totalLength, Double_t &continuousLength)
 {
@@ -944,18 +1188,14 @@ STHelixTrack::Continuity(Double_t &totalLength, Double_t &continuousLength)
 
   Double_t total = 0;
   Double_t continuous = 0;
-  TVector3 before = Map(fMainHits[0]->GetPosition());
 
   for (auto iHit = 1; iHit < numHits; iHit++) 
   {
-    TVector3 current = Map(fMainHits[iHit]->GetPosition());
-    auto length = std::abs(current.Z()-before.Z());
+    auto length = std::abs(fHitOrder[iHit].first - fHitOrder[iHit-1].first);
 
     total += length;
     if (length < 20)
       continuous += length;
-
-    before = current;
   }
 
   totalLength = total;
@@ -975,18 +1215,14 @@ STHelixTrack::Continuity()
 
   Double_t total = 0;
   Double_t continuous = 0;
-  TVector3 before = Map(fMainHits[0]->GetPosition());
 
   for (auto iHit = 1; iHit < numHits; iHit++) 
   {
-    TVector3 current = Map(fMainHits[iHit]->GetPosition());
-    auto length = std::abs(current.Z()-before.Z());
+    auto length = std::abs(fHitOrder[iHit].first - fHitOrder[iHit-1].first);
 
     total += length;
     if (length < 20)
       continuous += length;
-
-    before = current;
   }
 
   return continuous/total;
@@ -29,7 +29,11 @@ STHit::STHit(Int_t hitID, Double_t x, Double_t y, Double_t z, Double_t charge)
 STHit::STHit(STHit *hit)
 {
   Clear();
+  SetHit(hit);
+}
 
+void STHit::SetHit(STHit *hit)
+{
   fIsClustered = hit -> IsClustered();
   fClusterID = hit -> GetClusterID();
   fTrackID = hit -> GetTrackID();
@@ -67,6 +71,8 @@ void STHit::Clear(Option_t *)
 
   fChi2 = -1;
   fNDF = 0;
+
+  fTrackCandArray.clear();
 }
 
 void STHit::SetHit(Int_t hitID, TVector3 vec, Double_t charge) 
@@ -29,6 +29,8 @@ class STHit : public TObject
     void SetHit(Int_t hitID, TVector3 vec, Double_t charge);
     /// Hit setter
     void SetHit(Int_t hitID, Double_t x, Double_t y, Double_t z, Double_t charge);
+    /// Copy of hit, same as STHit(STHit *hit). For object recycled with TClonesArray::ConstructedAt().
+    void SetHit(STHit *hit);
 
     void Clear(Option_t * = "");                             ///< Clear method for reuse object
 
@@ -15,6 +15,14 @@ ClassImp(STHitCluster);
 
 STHitCluster::STHitCluster()
 {
+  fCovMatrix.ResizeTo(3, 3);
+  Clear();
+}
+
+void STHitCluster::Clear(Option_t *option)
+{
+  STHit::Clear(option);
+
   fClusterID = -1;
 
   fX = 0;
@@ -24,13 +32,21 @@ STHitCluster::STHitCluster()
   fDy = 0;
   fDz = 0;
 
-  fCovMatrix.ResizeTo(3, 3);
   for (Int_t iElem = 0; iElem < 9; iElem++)
     fCovMatrix(iElem/3, iElem%3) = 0;
 
   fCharge = 0.;
 
   fIsClustered = kFALSE;
+
+  fLength = 0;
+
+  fPOCAX = 0;
+  fPOCAY = 0;
+  fPOCAZ = 0;
+
+  fHitIDArray.clear();
+  fHitPtrArray.clear();
 }
 
 STHitCluster::STHitCluster(STHitCluster *cluster)
@@ -55,6 +71,37 @@ STHitCluster::STHitCluster(STHitCluster *cluster)
   fCharge = cluster -> GetCharge();
 }
 
+void STHitCluster::SetCluster(STHitCluster *cluster)
+{
+  fIsClustered = cluster -> fIsClustered;
+  fHitID = cluster -> fHitID;
+  fClusterID = cluster -> fClusterID;
+  fTrackID = cluster -> fTrackID;
+
+  fX = cluster -> fX;
+  fY = cluster -> fY;
+  fZ = cluster -> fZ;
+  fDx = cluster -> fDx;
+  fDy = cluster -> fDy;
+  fDz = cluster -> fDz;
+  fCharge = cluster -> fCharge;
+
+  fRow = cluster -> fRow;
+  fLayer = cluster -> fLayer;
+  fTb = cluster -> fTb;
+  fChi2 = cluster -> fChi2;
+  fNDF = cluster -> fNDF;
+
+  fCovMatrix = cluster -> fCovMatrix;
+  fHitIDArray = cluster -> fHitIDArray;
+  fHitPtrArray = cluster -> fHitPtrArray;
+
+  fLength = cluster -> fLength;
+  fPOCAX = cluster -> fPOCAX;
+  fPOCAY = cluster -> fPOCAY;
+  fPOCAZ = cluster -> fPOCAZ;
+}
+
 void STHitCluster::SetCovMatrix(TMatrixD matrix) { fCovMatrix = matrix; } 
 
 Bool_t STHitCluster::IsClustered() const { return kTRUE; }
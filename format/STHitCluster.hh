@@ -25,6 +25,12 @@ class STHitCluster : public STHit
     STHitCluster(STHitCluster *cluster);
     virtual ~STHitCluster() {}
 
+    /// Reset for reuse with TClonesArray::Clear("C"). Vectors keep their capacity.
+    void Clear(Option_t *option = "");
+
+    /// Copy cluster into this (recycled) object. Hit IDs of the hits are not changed.
+    void SetCluster(STHitCluster *cluster);
+
     void SetCovMatrix(TMatrixD matrix);  ///< Set covariance matrix
 
     Bool_t IsClustered() const;
@@ -1,9 +1,11 @@
 #include "STHelixTrackFinder.hh"
 
 #include <iostream>
+#include <algorithm>
 using namespace std;
 
 #include "STGlobal.hh"
+#include "FairLogger.h"
 
 ClassImp(STHelixTrackFinder)
 
@@ -11,26 +13,220 @@ STHelixTrackFinder::STHelixTrackFinder()
 {
   fFitter = new STHelixTrackFitter();
   fEventMap = new STPadPlaneMap();
+  fHitTable = new STHitTable();
 
   fCandHits = new std::vector<STHit*>;
   fGoodHits = new std::vector<STHit*>;
   fBadHits = new std::vector<STHit*>;
 }
 
+STHelixTrackFinder::~STHelixTrackFinder()
+{
+  delete fFitter;
+  delete fEventMap;
+  delete fHitTable;
+
+  delete fCandHits;
+  delete fGoodHits;
+  delete fBadHits;
+
+  for (auto finder : fSectorFinders) delete finder;
+  for (auto array : fSectorHitArrays) delete array;
+  for (auto array : fSectorTrackArrays) delete array;
+  delete fValidationTrackArray;
+
+  // Cluster slabs are owned by the clustering finders, the hit table by the caller
+  for (auto finder : fClusteringFinders) {
+    delete finder -> fHitClusterArray;
+    finder -> fHitTable = nullptr;
+    delete finder;
+  }
+}
+
 void 
 STHelixTrackFinder::BuildTracks(TClonesArray *hitArray, TClonesArray *trackArray, TClonesArray *hitClusterArray)
 {
+  bool useSectors = fNumSectors > 1;
+
+  fHitTable -> Fill(hitArray);
+  Int_t numTotalHits = fHitTable -> GetNumHits();
+
+  if (useSectors && fValidateSectors)
+    RunSerialValidation();
+
   fTrackArray = trackArray;
   fHitClusterArray = hitClusterArray;
   fEventMap -> Clear();
+  fFailedTrack = nullptr;
   fCandHits -> clear();
   fGoodHits -> clear();
   fBadHits -> clear();
 
-  Int_t numTotalHits = hitArray -> GetEntries();
-  for (Int_t iHit = 0; iHit < numTotalHits; iHit++)
-    fEventMap -> AddHit((STHit *) hitArray -> At(iHit));
+  if (useSectors)
+    FindTracksInSectors();
+  else {
+    for (Int_t iHit = 0; iHit < numTotalHits; iHit++)
+      fEventMap -> AddHit(fHitTable -> GetHit(iHit));
+
+    FindTracks();
+  }
+  fTrackArray -> Compress();
+
+  for (Int_t iHit = 0; iHit < numTotalHits; iHit++) {
+    Int_t owner = CheckHitOwner(fHitTable -> GetHit(iHit));
+    fHitTable -> SetOwner(iHit, owner < 0 ? -1 : owner);
+  }
+
+  if (useSectors && fValidateSectors && !CompareWithSerial()) {
+    // Out of the tolerances: tracks of the serial finder instead
+    fTrackArray -> Clear("C");
+    fEventMap -> Clear();
+    fFailedTrack = nullptr;
+    for (Int_t iHit = 0; iHit < numTotalHits; iHit++) {
+      auto hit = fHitTable -> GetHit(iHit);
+      hit -> GetTrackCandArray() -> clear();
+      fEventMap -> AddHit(hit);
+    }
+
+    FindTracks();
+    fTrackArray -> Compress();
+
+    for (Int_t iHit = 0; iHit < numTotalHits; iHit++) {
+      Int_t owner = CheckHitOwner(fHitTable -> GetHit(iHit));
+      fHitTable -> SetOwner(iHit, owner < 0 ? -1 : owner);
+    }
+    fNumFallbackEvents++;
+  }
+
+  TVector3 vertex = FindVertex(fTrackArray);
+
+  FinalizeTracks(vertex);
+}
+
+void
+STHelixTrackFinder::FinalizeTracks(TVector3 vertex)
+{
+  if (fPool == nullptr)
+    fPool = STThreadPool::Instance();
+
+  Int_t numWorkers = fPool -> GetNumThreads() + 1;
+  while (fClusteringFinders.size() < numWorkers) {
+    auto finder = new STHelixTrackFinder();
+    finder -> fHitClusterArray = new TClonesArray("STHitCluster", 1000);
+    // Clustering reads the hits of this event from the table of this finder
+    delete finder -> fHitTable;
+    finder -> fHitTable = fHitTable;
+    fClusteringFinders.push_back(finder);
+  }
+  for (auto finder : fClusteringFinders)
+    finder -> fHitClusterArray -> Clear("C");
+
+  auto numTracks = fTrackArray -> GetEntriesFast();
+  fTrackClusterSlab.resize(numTracks);
+  fTrackClusterBegin.resize(numTracks);
+  fTrackClusterIndex.assign(numTracks + 1, 0);
+
+  // Clustering writes the cluster ID and FinalizeHits() the track ID of the hits.
+  // Tracks sharing hits with other tracks are therefore done serially in track order.
+  // Hits which are not in fHitTable are taken as shared.
+  Int_t numTotalHits = fHitTable -> GetNumHits();
+  fHitFirstTrack.assign(numTotalHits, -1);
+  fTrackSharesHits.assign(numTracks, 0);
+  for (auto iTrack = 0; iTrack < numTracks; iTrack++) {
+    auto track = (STHelixTrack *) fTrackArray -> At(iTrack);
+    for (auto hit : *track -> GetHitArray()) {
+      Int_t hitID = TableIndex(hit);
+      if (hitID < 0) {
+        fTrackSharesHits[iTrack] = 1;
+        continue;
+      }
+      Int_t firstTrack = fHitFirstTrack[hitID];
+      if (firstTrack < 0)
+        fHitFirstTrack[hitID] = iTrack;
+      else if (firstTrack != iTrack) {
+        fTrackSharesHits[firstTrack] = 1;
+        fTrackSharesHits[iTrack] = 1;
+      }
+    }
+  }
+
+  // Cluster each track into the slab of the worker, with the fitter of the worker
+  auto ClusterTrack = [this, vertex](Int_t iTrack, Int_t iWorker)
+  {
+    auto finder = fClusteringFinders[iWorker];
+    auto slab = finder -> fHitClusterArray;
+    auto track = (STHelixTrack *) fTrackArray -> At(iTrack);
 
+    fTrackClusterSlab[iTrack] = iWorker;
+    fTrackClusterBegin[iTrack] = slab -> GetEntriesFast();
+
+    track -> DetermineParticleCharge(vertex);
+    if (fClusteringOption == 0)
+      finder -> HitClustering(track, 24);
+    else if (fClusteringOption == 1)
+      finder -> HitClustering(track, 12);
+    else if (fClusteringOption == 2)
+      finder -> HitClustering2(track);
+
+    fTrackClusterIndex[iTrack + 1] = slab -> GetEntriesFast() - fTrackClusterBegin[iTrack];
+  };
+
+  fPool -> ParallelFor(numTracks, [this, &ClusterTrack](Int_t iTrack, Int_t iWorker)
+  {
+    if (!fTrackSharesHits[iTrack])
+      ClusterTrack(iTrack, iWorker);
+  });
+  for (auto iTrack = 0; iTrack < numTracks; iTrack++)
+    if (fTrackSharesHits[iTrack])
+      ClusterTrack(iTrack, 0);
+
+  for (auto iTrack = 0; iTrack < numTracks; iTrack++)
+    fTrackClusterIndex[iTrack + 1] += fTrackClusterIndex[iTrack];
+
+  // Clusters are copied in track order, so cluster IDs do not depend on thread scheduling
+  Int_t offset = fHitClusterArray -> GetEntriesFast();
+  fHitClusterArray -> ExpandCreateFast(offset + fTrackClusterIndex[numTracks]);
+
+  auto CopyTrackClusters = [this, offset](Int_t iTrack)
+  {
+    auto track = (STHelixTrack *) fTrackArray -> At(iTrack);
+    auto slab = fClusteringFinders[fTrackClusterSlab[iTrack]] -> fHitClusterArray;
+    Int_t begin = fTrackClusterBegin[iTrack];
+    Int_t clusterID = offset + fTrackClusterIndex[iTrack];
+    Int_t numClusters = fTrackClusterIndex[iTrack + 1] - fTrackClusterIndex[iTrack];
+
+    for (auto iCluster = 0; iCluster < numClusters; iCluster++) {
+      auto slabCluster = (STHitCluster *) slab -> UncheckedAt(begin + iCluster);
+      auto cluster = (STHitCluster *) fHitClusterArray -> UncheckedAt(clusterID + iCluster);
+      cluster -> SetCluster(slabCluster);
+      cluster -> SetClusterID(clusterID + iCluster);
+      // SetClusterID() also sets the flag returned by IsStable()
+      cluster -> SetIsStable(slabCluster -> IsStable());
+    }
+
+    // GetClusterID() is -1 for unstable clusters. GetHitID() of cluster is
+    // the ID given in NewCluster(), which is the index in the slab.
+    auto trackClusters = track -> GetClusterArray();
+    for (auto &cluster : *trackClusters)
+      cluster = (STHitCluster *) fHitClusterArray -> UncheckedAt(clusterID + cluster -> GetHitID() - begin);
+
+    track -> FinalizeHits();
+    track -> FinalizeClusters();
+  };
+
+  fPool -> ParallelFor(numTracks, [this, &CopyTrackClusters](Int_t iTrack, Int_t)
+  {
+    if (!fTrackSharesHits[iTrack])
+      CopyTrackClusters(iTrack);
+  });
+  for (auto iTrack = 0; iTrack < numTracks; iTrack++)
+    if (fTrackSharesHits[iTrack])
+      CopyTrackClusters(iTrack);
+}
+
+void
+STHelixTrackFinder::FindTracks()
+{
   while(1)
   {
     fCandHits -> clear();
@@ -38,8 +234,11 @@ STHelixTrackFinder::BuildTracks(TClonesArray *hitArray, TClonesArray *trackArray
     fBadHits -> clear();
 
     STHelixTrack *track = NewTrack();
-    if (track == nullptr)
+    if (track == nullptr) {
+      if (fFailedTrack != nullptr)
+        fTrackArray -> Remove(fFailedTrack);
       break;
+    }
 
     bool survive = TrackInitialization(track);
     survive = true;
@@ -80,28 +279,512 @@ STHelixTrackFinder::BuildTracks(TClonesArray *hitArray, TClonesArray *trackArray
         trackHit -> AddTrackCand(-1);
         fEventMap -> AddHit(trackHit);
       }
-      fTrackArray -> Remove(track);
+      fFailedTrack = track;
     }
   }
+}
+
+Int_t
+STHelixTrackFinder::CoreSector(Double_t x, Double_t y, Int_t &neighbor, bool &nearAxis)
+{
+  Double_t dx = x - fBeamX;
+  Double_t dy = y - fBeamY;
+  nearAxis = (dx*dx + dy*dy < fSectorMinRadius*fSectorMinRadius);
+
+  Double_t width = TMath::TwoPi() / fNumSectors;
+  Double_t phi = TMath::ATan2(dy, dx) + TMath::Pi();
+
+  Int_t sector = Int_t(phi / width);
+  if (sector >= fNumSectors)
+    sector = fNumSectors - 1;
+
+  Double_t overlap = fSectorOverlap * TMath::DegToRad();
+  if (overlap > .5 * width)
+    overlap = .5 * width;
+
+  Double_t dPhi = phi - sector * width;
+  neighbor = -1;
+  if (dPhi < overlap)
+    neighbor = (sector + fNumSectors - 1) % fNumSectors;
+  else if (width - dPhi < overlap)
+    neighbor = (sector + 1) % fNumSectors;
+
+  return sector;
+}
+
+bool
+STHelixTrackFinder::IsHitInSector(Int_t iHit, Int_t sector)
+{
+  Int_t neighbor = fHitNeighborSector[iHit];
+  return neighbor == kAllSectors || neighbor == sector || fHitCoreSector[iHit] == sector;
+}
+
+void
+STHelixTrackFinder::FindSectorTracks(STHitTable *hitTable, std::vector<Int_t> *hitIndices, TClonesArray *localHits, TClonesArray *localTracks)
+{
+  fTrackArray = localTracks;
+  fHitClusterArray = nullptr;
+  fEventMap -> Clear();
+  fFailedTrack = nullptr;
+  fCandHits -> clear();
+  fGoodHits -> clear();
+  fBadHits -> clear();
+
+  localHits -> Clear("C");
+  localTracks -> Clear("C");
+
+  // hit ID of the copy is the index in hitIndices
+  Int_t numHits = hitIndices -> size();
+  for (Int_t iHit = 0; iHit < numHits; iHit++) {
+    auto hit = (STHit *) localHits -> ConstructedAt(iHit);
+    hitTable -> MakeHit(hitIndices -> at(iHit), hit);
+    hit -> SetHitID(iHit);
+    hit -> GetTrackCandArray() -> clear();
+    fEventMap -> AddHit(hit);
+  }
+  fHitTable -> Fill(localHits);
+
+  FindTracks();
   fTrackArray -> Compress();
+}
 
-  TVector3 vertex = FindVertex(fTrackArray);
+void
+STHelixTrackFinder::FindTracksInSectors()
+{
+  if (fPool == nullptr)
+    fPool = STThreadPool::Instance();
+
+  if (fSectorFinders.size() != fNumSectors) {
+    for (auto finder : fSectorFinders) delete finder;
+    for (auto array : fSectorHitArrays) delete array;
+    for (auto array : fSectorTrackArrays) delete array;
+    fSectorFinders.clear();
+    fSectorHitArrays.clear();
+    fSectorTrackArrays.clear();
+
+    for (Int_t iSector = 0; iSector < fNumSectors; iSector++) {
+      fSectorFinders.push_back(new STHelixTrackFinder());
+      fSectorHitArrays.push_back(new TClonesArray("STHit", 1000));
+      fSectorTrackArrays.push_back(new TClonesArray("STHelixTrack", 50));
+    }
+    fSectorHitIndices.resize(fNumSectors);
+  }
 
-  auto numTracks = fTrackArray -> GetEntries();
-  for (auto iTrack = 0; iTrack < numTracks; iTrack++) {
+  for (auto finder : fSectorFinders) {
+    finder -> SetDefaultCutScale(fDefaultScale);
+    finder -> SetTrackWidthCutLimits(fTrackWCutLL, fTrackWCutHL);
+    finder -> SetTrackHeightCutLimits(fTrackHCutLL, fTrackHCutHL);
+    finder -> SetUseSinglePrecision(fUseSinglePrecision);
+    finder -> SetValidatePrecision(fValidatePrecision);
+  }
+
+  // Distribute hits to the sectors
+
+  Int_t numTotalHits = fHitTable -> GetNumHits();
+  auto hitX = fHitTable -> GetX();
+  auto hitY = fHitTable -> GetY();
+  fHitCoreSector.resize(numTotalHits);
+  fHitNeighborSector.resize(numTotalHits);
+  for (auto &indices : fSectorHitIndices)
+    indices.clear();
+
+  for (Int_t iHit = 0; iHit < numTotalHits; iHit++) {
+    Int_t neighbor;
+    bool nearAxis;
+    Int_t sector = CoreSector(hitX[iHit], hitY[iHit], neighbor, nearAxis);
+    fHitCoreSector[iHit] = sector;
+    fHitNeighborSector[iHit] = nearAxis ? kAllSectors : neighbor;
+
+    for (Int_t iSector = 0; iSector < fNumSectors; iSector++)
+      if (nearAxis || iSector == sector || iSector == neighbor)
+        fSectorHitIndices[iSector].push_back(iHit);
+  }
+
+  fPool -> ParallelFor(fNumSectors, [this](Int_t iSector, Int_t) {
+    fSectorFinders[iSector] -> FindSectorTracks(fHitTable, &fSectorHitIndices[iSector], fSectorHitArrays[iSector], fSectorTrackArrays[iSector]);
+  });
+
+  // Precision comparison of the sector finders, in sector order
+  for (auto finder : fSectorFinders) {
+    fNumPrecisionCorrelations += finder -> fNumPrecisionCorrelations;
+    fNumPrecisionDiffDecisions += finder -> fNumPrecisionDiffDecisions;
+    fMaxPrecisionDiffW = std::max(fMaxPrecisionDiffW, finder -> fMaxPrecisionDiffW);
+    fMaxPrecisionDiffH = std::max(fMaxPrecisionDiffH, finder -> fMaxPrecisionDiffH);
+    fMaxPrecisionDiffL = std::max(fMaxPrecisionDiffL, finder -> fMaxPrecisionDiffL);
+    finder -> fNumPrecisionCorrelations = 0;
+    finder -> fNumPrecisionDiffDecisions = 0;
+  }
+
+  // Tracks of all sectors with the original hit indices, in sector order
+
+  Int_t numLocalTracks = 0;
+  fLocalTrackSector.clear();
+  fHitTrackPairs.clear();
+
+  for (Int_t iSector = 0; iSector < fNumSectors; iSector++)
+  {
+    auto indices = &fSectorHitIndices[iSector];
+    auto localTracks = fSectorTrackArrays[iSector];
+    Int_t numSectorTracks = localTracks -> GetEntriesFast();
+
+    for (Int_t iTrack = 0; iTrack < numSectorTracks; iTrack++)
+    {
+      auto localHits = ((STHelixTrack *) localTracks -> At(iTrack)) -> GetHitArray();
+
+      if (fLocalTrackHits.size() <= numLocalTracks)
+        fLocalTrackHits.resize(numLocalTracks + 1);
+      fLocalTrackHits[numLocalTracks].clear();
+      for (auto localHit : *localHits) {
+        Int_t iHit = indices -> at(localHit -> GetHitID());
+        fLocalTrackHits[numLocalTracks].push_back(iHit);
+        fHitTrackPairs.push_back(std::make_pair(iHit, numLocalTracks));
+      }
+      fLocalTrackSector.push_back(iSector);
+      numLocalTracks++;
+    }
+  }
+
+  // Number of hits shared by each pair of tracks of different sectors
+
+  sort(fHitTrackPairs.begin(), fHitTrackPairs.end());
+  fTrackPairs.clear();
+  for (size_t iPair = 0; iPair < fHitTrackPairs.size();) {
+    size_t jPair = iPair;
+    while (jPair < fHitTrackPairs.size() && fHitTrackPairs[jPair].first == fHitTrackPairs[iPair].first)
+      jPair++;
+    // Hits near the beam axis are in all sectors, and do not tell which tracks are the same
+    bool nearAxis = fHitNeighborSector[fHitTrackPairs[iPair].first] == kAllSectors;
+    for (size_t i = iPair; i < jPair && !nearAxis; i++)
+      for (size_t j = i+1; j < jPair; j++)
+        if (fLocalTrackSector[fHitTrackPairs[i].second] != fLocalTrackSector[fHitTrackPairs[j].second])
+          fTrackPairs.push_back(std::make_pair(fHitTrackPairs[i].second, fHitTrackPairs[j].second));
+    iPair = jPair;
+  }
+  sort(fTrackPairs.begin(), fTrackPairs.end());
+
+  // Tracks sharing most of the hits which both sectors could see are the same track.
+  // Merged tracks take the lowest track of the group as representative.
+
+  fMergeParent.resize(numLocalTracks);
+  for (Int_t iTrack = 0; iTrack < numLocalTracks; iTrack++)
+    fMergeParent[iTrack] = iTrack;
+
+  auto findGroup = [this](Int_t iTrack) -> Int_t {
+    while (fMergeParent[iTrack] != iTrack)
+      iTrack = fMergeParent[iTrack] = fMergeParent[fMergeParent[iTrack]];
+    return iTrack;
+  };
+
+  for (size_t iPair = 0; iPair < fTrackPairs.size();)
+  {
+    size_t jPair = iPair;
+    while (jPair < fTrackPairs.size() && fTrackPairs[jPair] == fTrackPairs[iPair])
+      jPair++;
+
+    Int_t iTrack = fTrackPairs[iPair].first;
+    Int_t jTrack = fTrackPairs[iPair].second;
+    Int_t numShared = jPair - iPair;
+    iPair = jPair;
+
+    Int_t numVisibleI = 0;
+    for (auto iHit : fLocalTrackHits[iTrack])
+      if (fHitNeighborSector[iHit] != kAllSectors && IsHitInSector(iHit, fLocalTrackSector[jTrack]))
+        numVisibleI++;
+
+    Int_t numVisibleJ = 0;
+    for (auto iHit : fLocalTrackHits[jTrack])
+      if (fHitNeighborSector[iHit] != kAllSectors && IsHitInSector(iHit, fLocalTrackSector[iTrack]))
+        numVisibleJ++;
+
+    if (numShared < fSectorMergeRatio * std::min(numVisibleI, numVisibleJ))
+      continue;
+
+    Int_t iGroup = findGroup(iTrack);
+    Int_t jGroup = findGroup(jTrack);
+    if (iGroup < jGroup)
+      fMergeParent[jGroup] = iGroup;
+    else
+      fMergeParent[iGroup] = jGroup;
+  }
+
+  // Hits of each group, with a flag if a track of the hit's own sector has it
+
+  Int_t numKept = 0;
+  fLocalTrackKept.assign(numLocalTracks, -1);
+  for (Int_t iTrack = 0; iTrack < numLocalTracks; iTrack++)
+  {
+    Int_t iGroup = findGroup(iTrack);
+    if (iGroup == iTrack) {
+      if (fKeptHits.size() <= numKept)
+        fKeptHits.resize(numKept + 1);
+      fKeptHits[numKept].clear();
+      fLocalTrackKept[iTrack] = numKept++;
+    }
+
+    Int_t iKept = fLocalTrackKept[iGroup];
+    Int_t sector = fLocalTrackSector[iTrack];
+    for (auto iHit : fLocalTrackHits[iTrack])
+      fKeptHits[iKept].push_back(std::make_pair(iHit, fHitCoreSector[iHit] == sector ? 1 : 0));
+  }
+
+  for (Int_t iKept = 0; iKept < numKept; iKept++) {
+    auto keptHits = &fKeptHits[iKept];
+    sort(keptHits -> begin(), keptHits -> end());
+    // keep the last of each hit, which has the largest flag
+    Int_t numUnique = 0;
+    for (size_t i = 0; i < keptHits -> size(); i++) {
+      if (i+1 < keptHits -> size() && keptHits -> at(i+1).first == keptHits -> at(i).first)
+        continue;
+      keptHits -> at(numUnique++) = keptHits -> at(i);
+    }
+    keptHits -> resize(numUnique);
+  }
+
+  // Hit claimed by two kept tracks goes to the track found in the hit's own sector,
+  // otherwise to the track kept first
+
+  fHitClaim.assign(numTotalHits, -1);
+  fHitClaimInCore.assign(numTotalHits, 0);
+  for (Int_t iKept = 0; iKept < numKept; iKept++) {
+    for (auto keptHit : fKeptHits[iKept]) {
+      Int_t iHit = keptHit.first;
+      if (fHitClaim[iHit] == -1 || (keptHit.second && !fHitClaimInCore[iHit])) {
+        fHitClaim[iHit] = iKept;
+        fHitClaimInCore[iHit] = keptHit.second;
+      }
+    }
+  }
+
+  // Kept tracks with the original hits
+
+  for (Int_t iKept = 0; iKept < numKept; iKept++)
+  {
+    STHelixTrack *track = fFailedTrack;
+    fFailedTrack = nullptr;
+    if (track == nullptr) {
+      track = (STHelixTrack *) fTrackArray -> ConstructedAt(fTrackArray -> GetEntriesFast());
+      track -> Clear();
+    }
+    Int_t idx = fTrackArray -> IndexOf(track);
+    track -> SetTrackID(idx);
+
+    for (auto keptHit : fKeptHits[iKept])
+      if (fHitClaim[keptHit.first] == iKept)
+        track -> AddHit(fHitTable -> GetHit(keptHit.first));
+
+    bool survive = track -> GetNumHits() >= 4 && fFitter -> Fit(track);
+    if (survive && (track -> TrackLength() < 150 || track -> GetHelixRadius() < 25))
+      survive = false;
+
+    if (!survive) {
+      for (auto keptHit : fKeptHits[iKept])
+        if (fHitClaim[keptHit.first] == iKept)
+          fHitClaim[keptHit.first] = -1;
+      track -> Clear();
+      track -> SetTrackID(idx);
+      fFailedTrack = track;
+      continue;
+    }
+
+    auto trackHits = track -> GetHitArray();
+    for (auto trackHit : *trackHits)
+      trackHit -> AddTrackCand(idx);
+  }
+
+  // Hits given up by the finder of their own sector are not tried again
+
+  for (Int_t iSector = 0; iSector < fNumSectors; iSector++)
+  {
+    auto indices = &fSectorHitIndices[iSector];
+    auto localHits = fSectorHitArrays[iSector];
+    Int_t numLocalHits = indices -> size();
+
+    for (Int_t iLocal = 0; iLocal < numLocalHits; iLocal++)
+    {
+      Int_t iHit = indices -> at(iLocal);
+      if (fHitCoreSector[iHit] != iSector || fHitClaim[iHit] != -1)
+        continue;
+
+      auto localCands = ((STHit *) localHits -> At(iLocal)) -> GetTrackCandArray();
+      if (localCands -> size() == 0)
+        continue;
+
+      bool failed = true;
+      for (auto candID : *localCands)
+        if (candID != -1)
+          failed = false;
+
+      if (failed)
+        fHitTable -> GetHit(iHit) -> AddTrackCand(-1);
+    }
+  }
+
+  for (Int_t iHit = 0; iHit < numTotalHits; iHit++)
+    fEventMap -> AddHit(fHitTable -> GetHit(iHit));
+
+  // Extend tracks which reach the sector boundaries with hits of the other sectors
+
+  Int_t numTracks = fTrackArray -> GetEntriesFast();
+  for (Int_t iTrack = 0; iTrack < numTracks; iTrack++)
+  {
     auto track = (STHelixTrack *) fTrackArray -> At(iTrack);
-    track -> DetermineParticleCharge(vertex);
-    if (fClusteringOption == 0)
-      HitClustering(track, 24);
-    else if (fClusteringOption == 1)
-      HitClustering(track, 12);
-    else if (fClusteringOption == 2)
-      HitClustering2(track);
-    track -> FinalizeHits();
-    track -> FinalizeClusters();
+    if (track == fFailedTrack)
+      continue;
+
+    auto trackHits = track -> GetHitArray();
+
+    bool atBoundary = false;
+    for (auto trackHit : *trackHits) {
+      Int_t neighbor;
+      bool nearAxis;
+      CoreSector(trackHit -> GetX(), trackHit -> GetY(), neighbor, nearAxis);
+      if (neighbor != -1 || nearAxis) {
+        atBoundary = true;
+        break;
+      }
+    }
+    if (!atBoundary)
+      continue;
+
+    fCandHits -> clear();
+    fGoodHits -> clear();
+    fBadHits -> clear();
+
+    fFitter -> Fit(track);
+    TrackExtrapolation(track);
+
+    auto trackID = track -> GetTrackID();
+    for (auto trackHit : *trackHits) {
+      if (CheckHitOwner(trackHit) != trackID) {
+        trackHit -> AddTrackCand(trackID);
+        fEventMap -> AddHit(trackHit);
+      }
+    }
+  }
+
+  // Serial finder for the hits left
+
+  FindTracks();
+}
+
+void
+STHelixTrackFinder::RunSerialValidation()
+{
+  if (fValidationTrackArray == nullptr)
+    fValidationTrackArray = new TClonesArray("STHelixTrack", 100);
+  fValidationTrackArray -> Clear("C");
+
+  fTrackArray = fValidationTrackArray;
+  fHitClusterArray = nullptr;
+  fEventMap -> Clear();
+  fFailedTrack = nullptr;
+  fCandHits -> clear();
+  fGoodHits -> clear();
+  fBadHits -> clear();
+
+  Int_t numTotalHits = fHitTable -> GetNumHits();
+  for (Int_t iHit = 0; iHit < numTotalHits; iHit++)
+    fEventMap -> AddHit(fHitTable -> GetHit(iHit));
+
+  FindTracks();
+  fTrackArray -> Compress();
+
+  fSerialOwners.resize(numTotalHits);
+  for (Int_t iHit = 0; iHit < numTotalHits; iHit++) {
+    auto hit = fHitTable -> GetHit(iHit);
+    fSerialOwners[iHit] = CheckHitOwner(hit);
+    hit -> GetTrackCandArray() -> clear();
   }
 }
 
+bool
+STHelixTrackFinder::CompareWithSerial()
+{
+  Int_t numTotalHits = fHitTable -> GetNumHits();
+  auto owners = fHitTable -> GetOwner();
+  Int_t numSerialTracks = fValidationTrackArray -> GetEntriesFast();
+  Int_t numTracks = fTrackArray -> GetEntriesFast();
+
+  // (serial track, sector track) of each hit owned in both
+  std::vector<std::pair<Int_t, Int_t>> pairs;
+  for (Int_t iHit = 0; iHit < numTotalHits; iHit++) {
+    if (fSerialOwners[iHit] >= 0 && owners[iHit] >= 0)
+      pairs.push_back(std::make_pair(fSerialOwners[iHit], owners[iHit]));
+  }
+  sort(pairs.begin(), pairs.end());
+
+  std::vector<Int_t> match(numSerialTracks, -1);
+  std::vector<Int_t> numShared(numSerialTracks, 0);
+  for (size_t iPair = 0; iPair < pairs.size();) {
+    size_t jPair = iPair;
+    while (jPair < pairs.size() && pairs[jPair] == pairs[iPair])
+      jPair++;
+    Int_t serialID = pairs[iPair].first;
+    Int_t count = jPair - iPair;
+    if (count > numShared[serialID]) {
+      numShared[serialID] = count;
+      match[serialID] = pairs[iPair].second;
+    }
+    iPair = jPair;
+  }
+
+  Int_t numMatched = 0;
+  for (Int_t iSerial = 0; iSerial < numSerialTracks; iSerial++) {
+    if (match[iSerial] < 0)
+      continue;
+
+    auto serialTrack = (STHelixTrack *) fValidationTrackArray -> At(iSerial);
+    auto track = (STHelixTrack *) fTrackArray -> At(match[iSerial]);
+    if (numShared[iSerial] < fValidationMatchRatio * serialTrack -> GetNumHits() ||
+        numShared[iSerial] < fValidationMatchRatio * track -> GetNumHits()) {
+      match[iSerial] = -1;
+      continue;
+    }
+
+    numMatched++;
+    Double_t diff = TMath::Abs(track -> GetHelixRadius() - serialTrack -> GetHelixRadius()) / serialTrack -> GetHelixRadius();
+    if (diff > fMaxRelDiffRadius)
+      fMaxRelDiffRadius = diff;
+  }
+
+  Int_t numSameOwnerHits = 0;
+  for (Int_t iHit = 0; iHit < numTotalHits; iHit++) {
+    Int_t serialID = fSerialOwners[iHit];
+    if ((serialID < 0 && owners[iHit] < 0) || (serialID >= 0 && match[serialID] >= 0 && match[serialID] == owners[iHit]))
+      numSameOwnerHits++;
+  }
+
+  fNumMatchedTracks += numMatched;
+  fNumSameOwnerHits += numSameOwnerHits;
+  fNumValidatedEvents++;
+  fNumValidatedHits += numTotalHits;
+  fNumSerialTracks += numSerialTracks;
+  fNumSectorTracks += numTracks;
+
+  return numMatched >= fSectorMatchTolerance * numSerialTracks
+      && numSameOwnerHits >= fSectorOwnerTolerance * numTotalHits;
+}
+
+void
+STHelixTrackFinder::PrintSectorValidation()
+{
+  LOG(INFO) << "Helix tracks in sectors vs serial: " << fNumValidatedEvents << " events, "
+            << fNumSerialTracks << " serial tracks, " << fNumSectorTracks << " sector tracks, "
+            << fNumMatchedTracks << " matched, "
+            << fNumSameOwnerHits << " of " << fNumValidatedHits << " hits with the same owner, "
+            << "radius rel. diff max " << fMaxRelDiffRadius << ", "
+            << fNumFallbackEvents << " events by the serial finder" << FairLogger::endl;
+}
+
+void
+STHelixTrackFinder::PrintPrecisionValidation()
+{
+  LOG(INFO) << "Helix correlation float vs double: " << fNumPrecisionCorrelations << " correlations, "
+            << fNumPrecisionDiffDecisions << " with different decision, "
+            << "diff max w " << fMaxPrecisionDiffW << ", h " << fMaxPrecisionDiffH
+            << ", l " << fMaxPrecisionDiffL << " [mm]" << FairLogger::endl;
+}
+
 STHelixTrack *
 STHelixTrackFinder::NewTrack()
 {
@@ -109,8 +792,19 @@ STHelixTrackFinder::NewTrack()
   if (hit == nullptr)
     return nullptr;
 
-  Int_t idx = fTrackArray -> GetEntries();
-  STHelixTrack *track = new ((*fTrackArray)[idx]) STHelixTrack(idx);
+  // Failed track is reused in place, instead of being destroyed and constructed again.
+  STHelixTrack *track = fFailedTrack;
+  if (track != nullptr) {
+    fFailedTrack = nullptr;
+    Int_t idx = track -> GetTrackID();
+    track -> Clear();
+    track -> SetTrackID(idx);
+  }
+  else {
+    Int_t idx = fTrackArray -> GetEntriesFast();
+    track = (STHelixTrack *) fTrackArray -> ConstructedAt(idx);
+    track -> SetTrackID(idx);
+  }
   track -> AddHit(hit);
   fGoodHits -> push_back(hit);
 
@@ -121,7 +815,7 @@ STHitCluster *
 STHelixTrackFinder::NewCluster(STHit *hit)
 {
   Int_t idx = fHitClusterArray -> GetEntries();
-  STHitCluster *cluster = new ((*fHitClusterArray)[idx]) STHitCluster();
+  STHitCluster *cluster = (STHitCluster *) fHitClusterArray -> ConstructedAt(idx);
   cluster -> AddHit(hit);
   cluster -> SetClusterID(idx);
   return cluster;
@@ -146,7 +840,7 @@ STHelixTrackFinder::TrackInitialization(STHelixTrack *track)
 
       if (quality > 0) {
         fGoodHits -> push_back(candHit);
-        track -> AddHit(candHit);
+        fFitter -> AddHit(track, candHit);
 
         if (track -> GetNumHits() > 6) {
           if (track -> GetNumHits() > 15) {
@@ -156,7 +850,7 @@ STHelixTrackFinder::TrackInitialization(STHelixTrack *track)
             break;
           }
 
-          fFitter -> Fit(track);
+          fFitter -> FitIncremental(track);
 
           if (!(track -> GetNumHits() < 10 && track -> GetHelixRadius() < 30) && (track -> TrackLength() > fDefaultScale * track -> GetRMSW()))
             return true;
@@ -202,8 +896,8 @@ STHelixTrackFinder::TrackContinuum(STHelixTrack *track)
 
       if (quality > 0) {
         fGoodHits -> push_back(candHit);
-        track -> AddHit(candHit);
-        fFitter -> Fit(track);
+        fFitter -> AddHit(track, candHit);
+        fFitter -> FitIncremental(track);
       } else
         fBadHits -> push_back(candHit);
     }
@@ -296,8 +990,8 @@ STHelixTrackFinder::AutoBuildAtPosition(STHelixTrack *track, TVector3 p, bool &t
       quality = Correlate(track, candHit, rScale);
 
     if (quality > 0) {
-      track -> AddHit(candHit);
-      fFitter -> Fit(track);
+      fFitter -> AddHit(track, candHit);
+      fFitter -> FitIncremental(track);
       foundHit = true;
     } else
       fBadHits -> push_back(candHit);
@@ -379,10 +1073,10 @@ STHelixTrackFinder::ConfirmHits(STHelixTrack *track, bool &tailToHead)
     Double_t quality = Correlate(track, trackHit);
 
     if (quality <= 0) {
-      track -> Remove(trackHit);
+      fFitter -> RemoveHit(track, trackHit);
       trackHit -> RemoveTrackCand(trackHit -> GetTrackID());
       auto helicity = track -> Helicity();
-      fFitter -> Fit(track);
+      fFitter -> FitIncremental(track);
       if (helicity != track -> Helicity())
         tailToHead = !tailToHead;
     }
@@ -403,6 +1097,9 @@ STHelixTrackFinder::HitClustering2(STHelixTrack *track)
 {
   track -> SortHitsByTimeOrder();
 
+  // Clusters of the previous tracks are already checked
+  Int_t firstCluster = fHitClusterArray -> GetEntriesFast();
+
   auto trackHits = track -> GetHitArray();
   auto numHits = trackHits -> size();
 
@@ -448,14 +1145,18 @@ STHelixTrackFinder::HitClustering2(STHelixTrack *track)
       length = 1;
       track -> ExtrapolateToX(x0, alpha, q0);
       track -> ExtrapolateToX(x1, alpha, q1);
-      length = TMath::Abs(track -> Map(q0).Z() - track -> Map(q1).Z());
     } else {
       Double_t z0 = (layer)*12.;
       Double_t z1 = (layer+1)*12.;
       track -> ExtrapolateToZ(z0, alpha, q0);
       track -> ExtrapolateToZ(z1, alpha, q1);
-      length = TMath::Abs(track -> Map(q0).Z() - track -> Map(q1).Z());
     }
+    Double_t x[2] = {q0.X(), q1.X()};
+    Double_t y[2] = {q0.Y(), q1.Y()};
+    Double_t z[2] = {q0.Z(), q1.Z()};
+    Double_t w[2], h[2], l[2];
+    track -> MapBatch(2, x, y, z, w, h, l);
+    length = TMath::Abs(l[0] - l[1]);
     cluster -> SetLength(length);
   };
 
@@ -593,7 +1294,7 @@ STHelixTrackFinder::HitClustering2(STHelixTrack *track)
   }
 
   Int_t numCluster = fHitClusterArray -> GetEntries();
-  for (auto iCluster = 0; iCluster < numCluster; iCluster++)
+  for (auto iCluster = firstCluster; iCluster < numCluster; iCluster++)
   {
     auto cluster = (STHitCluster *) fHitClusterArray -> At(iCluster);
 
@@ -618,6 +1319,51 @@ STHelixTrackFinder::HitClustering2(STHelixTrack *track)
   return true;
 }
 
+void
+STHelixTrackFinder::MapTrackHits(STHelixTrack *track)
+{
+  auto trackHits = track -> GetHitArray();
+  Int_t numHits = trackHits -> size();
+
+  fMapX.resize(numHits);
+  fMapY.resize(numHits);
+  fMapZ.resize(numHits);
+  fMapW.resize(numHits);
+  fMapH.resize(numHits);
+  fMapL.resize(numHits);
+  fMapAlpha.resize(numHits);
+
+  auto hitX = fHitTable -> GetX();
+  auto hitY = fHitTable -> GetY();
+  auto hitZ = fHitTable -> GetZ();
+  for (Int_t iHit = 0; iHit < numHits; iHit++) {
+    auto hit = trackHits -> at(iHit);
+    Int_t idx = TableIndex(hit);
+    if (idx >= 0) {
+      fMapX[iHit] = hitX[idx];
+      fMapY[iHit] = hitY[idx];
+      fMapZ[iHit] = hitZ[idx];
+    } else {
+      fMapX[iHit] = hit -> GetX();
+      fMapY[iHit] = hit -> GetY();
+      fMapZ[iHit] = hit -> GetZ();
+    }
+  }
+
+  track -> MapBatch(numHits, fMapX.data(), fMapY.data(), fMapZ.data(),
+                    fMapW.data(), fMapH.data(), fMapL.data(), fMapAlpha.data());
+}
+
+Int_t
+STHelixTrackFinder::TableIndex(STHit *hit)
+{
+  Int_t idx = hit -> GetHitID();
+  if (idx < 0 || idx >= fHitTable -> GetNumHits() || fHitTable -> GetHit(idx) != hit)
+    return -1;
+
+  return idx;
+}
+
 bool
 STHelixTrackFinder::HitClustering(STHelixTrack *track, Double_t cut)
 {
@@ -626,6 +1372,10 @@ STHelixTrackFinder::HitClustering(STHelixTrack *track, Double_t cut)
   auto trackHits = track -> GetHitArray();
   auto numHits = trackHits -> size();
 
+  // Track is not changed until FitCluster(), so the hits are mapped at once
+  MapTrackHits(track);
+  auto lengthPerAlpha = track -> ExtrapolateToAlpha(1.);
+
   auto CheckMean = [](STHitCluster *cluster, STHit *hit) {
     auto pHit = cluster -> GetPosition();
     auto wHit = cluster -> GetCharge();
@@ -657,7 +1407,6 @@ STHelixTrackFinder::HitClustering(STHelixTrack *track, Double_t cut)
 
   auto lengthCut = cut / TMath::Cos(track -> DipAngle());
 
-  TVector3 q, m;
   bool isStableCluster = false;
   bool isStableState = false;
   auto addedLength = 0.;
@@ -669,12 +1418,12 @@ STHelixTrackFinder::HitClustering(STHelixTrack *track, Double_t cut)
   auto curCluster = NewCluster(curHit);
 
   auto curLength = 0;
-  auto preLength = track -> ExtrapolateByMap(curHit->GetPosition(),q,m);
+  auto preLength = fMapAlpha[0] * lengthPerAlpha;
 
   for (auto iHit = 1; iHit < numHits; iHit++)
   {
     curHit = trackHits -> at(iHit);
-    curLength = track -> ExtrapolateByMap(curHit -> GetPosition(), q, m);
+    curLength = fMapAlpha[iHit] * lengthPerAlpha;
     auto dLength = std::abs(curLength - preLength);
     preLength = curLength;
 
@@ -704,11 +1453,16 @@ STHelixTrackFinder::HitClustering(STHelixTrack *track, Double_t cut)
         endCluster = false;
       }
       else {
-        auto p0 = track -> Map(curCluster -> GetPosition());
-        auto pc = track -> Map(CheckMean(curCluster, curHit));
-        auto w0 = p0.X();
-        auto wc = pc.X();
-        auto h0 = p0.Y();
+        auto p0 = curCluster -> GetPosition();
+        auto pc = CheckMean(curCluster, curHit);
+        Double_t x[2] = {p0.X(), pc.X()};
+        Double_t y[2] = {p0.Y(), pc.Y()};
+        Double_t z[2] = {p0.Z(), pc.Z()};
+        Double_t w[2], h[2], l[2];
+        track -> MapBatch(2, x, y, z, w, h, l);
+        auto w0 = w[0];
+        auto wc = w[1];
+        auto h0 = h[0];
 
         if (abs(wc) < abs(w0)) {
           endCluster = false;
@@ -789,10 +1543,69 @@ STHelixTrackFinder::Correlate(STHelixTrack *track, STHit *hit, Double_t rScale)
   if (rmsHCut > fTrackHCutHL) rmsHCut = fTrackHCutHL;
   rmsHCut = scale * rmsHCut;
 
-  auto qHead = track -> Map(track -> PositionAtHead());
-  auto qTail = track -> Map(track -> PositionAtTail());
-  auto q = track -> Map(hit -> GetPosition());
+  // head, tail and hit
+  Double_t w[3], h[3], l[3];
+  if (fUseSinglePrecision)
+    MapCorrelation<Float_t>(track, hit, w, h, l);
+  else
+    MapCorrelation<Double_t>(track, hit, w, h, l);
 
+  Double_t quality = CorrelationQuality(track, w, h, l, rmsWCut, rmsHCut);
+
+  if (fUseSinglePrecision && fValidatePrecision)
+  {
+    Double_t wRef[3], hRef[3], lRef[3];
+    MapCorrelation<Double_t>(track, hit, wRef, hRef, lRef);
+    Double_t qualityRef = CorrelationQuality(track, wRef, hRef, lRef, rmsWCut, rmsHCut);
+
+    fNumPrecisionCorrelations++;
+    if ((quality > 0) != (qualityRef > 0))
+      fNumPrecisionDiffDecisions++;
+    for (Int_t i = 0; i < 3; i++) {
+      fMaxPrecisionDiffW = std::max(fMaxPrecisionDiffW, abs(w[i] - wRef[i]));
+      fMaxPrecisionDiffH = std::max(fMaxPrecisionDiffH, abs(h[i] - hRef[i]));
+      fMaxPrecisionDiffL = std::max(fMaxPrecisionDiffL, abs(l[i] - lRef[i]));
+    }
+  }
+
+  return quality;
+}
+
+template <typename T>
+void
+STHelixTrackFinder::MapCorrelation(STHelixTrack *track, STHit *hit, Double_t *w, Double_t *h, Double_t *l)
+{
+  Double_t xHit, yHit, zHit;
+  Int_t idx = TableIndex(hit);
+  if (idx >= 0) {
+    xHit = fHitTable -> GetX()[idx];
+    yHit = fHitTable -> GetY()[idx];
+    zHit = fHitTable -> GetZ()[idx];
+  } else {
+    xHit = hit -> GetX();
+    yHit = hit -> GetY();
+    zHit = hit -> GetZ();
+  }
+
+  auto pHead = track -> PositionAtHead();
+  auto pTail = track -> PositionAtTail();
+  T x[3] = {T(pHead.X()), T(pTail.X()), T(xHit)};
+  T y[3] = {T(pHead.Y()), T(pTail.Y()), T(yHit)};
+  T z[3] = {T(pHead.Z()), T(pTail.Z()), T(zHit)};
+  T wT[3], hT[3], lT[3];
+  track -> MapBatch(3, x, y, z, wT, hT, lT);
+
+  for (Int_t i = 0; i < 3; i++) {
+    w[i] = wT[i];
+    h[i] = hT[i];
+    l[i] = lT[i];
+  }
+}
+
+Double_t
+STHelixTrackFinder::CorrelationQuality(STHelixTrack *track, const Double_t *w, const Double_t *h, const Double_t *l,
+                                       Double_t rmsWCut, Double_t rmsHCut)
+{
   auto LengthAlphaCut = [track](Double_t dLength) {
     if (dLength > 0) {
       if (dLength > .5*track -> TrackLength()) {
@@ -804,17 +1617,17 @@ STHelixTrackFinder::Correlate(STHelixTrack *track, STHit *hit, Double_t rScale)
     return false;
   };
 
-  if (qHead.Z() > qTail.Z()) {
-    if (LengthAlphaCut(q.Z() - qHead.Z())) return 0;
-    if (LengthAlphaCut(qTail.Z() - q.Z())) return 0;
+  if (l[0] > l[1]) {
+    if (LengthAlphaCut(l[2] - l[0])) return 0;
+    if (LengthAlphaCut(l[1] - l[2])) return 0;
   } else {
-    if (LengthAlphaCut(q.Z() - qTail.Z())) return 0;
-    if (LengthAlphaCut(qHead.Z() - q.Z())) return 0;
+    if (LengthAlphaCut(l[2] - l[1])) return 0;
+    if (LengthAlphaCut(l[0] - l[2])) return 0;
   }
 
-  Double_t dr = abs(q.X());
+  Double_t dr = abs(w[2]);
   Double_t quality = 0;
-  if (dr < rmsWCut && abs(q.Y()) < rmsHCut)
+  if (dr < rmsWCut && abs(h[2]) < rmsHCut)
     quality = sqrt((dr-rmsWCut)*(dr-rmsWCut)) / rmsWCut;
 
   return quality;
@@ -828,15 +1641,42 @@ STHelixTrackFinder::CorrelateSimple(STHelixTrack *track, STHit *hit)
 
   Double_t quality = 0;
 
-  Int_t row = hit -> GetRow();
-  Int_t layer = hit -> GetLayer();
+  auto hitRow = fHitTable -> GetRow();
+  auto hitLayer = fHitTable -> GetLayer();
+  auto hitY = fHitTable -> GetY();
+
+  Int_t row, layer;
+  Double_t y;
+  Int_t idx = TableIndex(hit);
+  if (idx >= 0) {
+    row = hitRow[idx];
+    layer = hitLayer[idx];
+    y = hitY[idx];
+  } else {
+    row = hit -> GetRow();
+    layer = hit -> GetLayer();
+    y = hit -> GetY();
+  }
 
   auto trackHits = track -> GetHitArray();
   bool ycut = false;
   for (auto trackHit : *trackHits) {
-    if (row == trackHit -> GetRow() && layer == trackHit -> GetLayer())
+    Int_t trackRow, trackLayer;
+    Double_t trackY;
+    Int_t trackIdx = TableIndex(trackHit);
+    if (trackIdx >= 0) {
+      trackRow = hitRow[trackIdx];
+      trackLayer = hitLayer[trackIdx];
+      trackY = hitY[trackIdx];
+    } else {
+      trackRow = trackHit -> GetRow();
+      trackLayer = trackHit -> GetLayer();
+      trackY = trackHit -> GetY();
+    }
+
+    if (row == trackRow && layer == trackLayer)
       return 0;
-    if (abs(hit->GetY() - trackHit->GetY()) < 12)
+    if (abs(y - trackY) < 12)
       ycut = true;
   }
   if (ycut == false)
@@ -894,82 +1734,204 @@ STHelixTrackFinder::TangentOfMaxDipAngle(STHit *hit)
 TVector3
 STHelixTrackFinder::FindVertex(TClonesArray *tracks, Int_t nIterations)
 {
-  auto TestZ = [tracks](TVector3 &v)
-  {
-    Double_t s = 0;
-    Int_t numUsedTracks = 0;
-
-    v.SetX(0);
-    v.SetY(0);
-
-    auto numTracks = tracks -> GetEntries();
-    for (auto iTrack = 0; iTrack < numTracks; iTrack++) {
-      STHelixTrack *track = (STHelixTrack *) tracks -> At(iTrack);
+  fVertexTracks.clear();
+  auto numTracks = tracks -> GetEntriesFast();
+  for (auto iTrack = 0; iTrack < numTracks; iTrack++) {
+    auto track = (STHelixTrack *) tracks -> At(iTrack);
+    if (track == nullptr)
+      continue;
+    // Plane and bad tracks have no direction to extrapolate
+    if (track -> IsHelix() || track -> IsGenfitTrack() || track -> IsLine())
+      fVertexTracks.push_back(track);
+  }
 
-      TVector3 p;
-      bool extrapolated = track -> ExtrapolateToZ(v.Z(), p);
-      if (extrapolated == false)
-        continue;
+  TVector3 vertex(0, 0, 0);
 
-      v.SetX((numUsedTracks*v.X() + p.X())/(numUsedTracks+1));
-      v.SetY((numUsedTracks*v.Y() + p.Y())/(numUsedTracks+1));
+  Int_t numLines = fVertexTracks.size();
+  if (numLines == 0)
+    return vertex;
 
-      if (numUsedTracks != 0)
-        s = (double)numUsedTracks/(numUsedTracks+1)*s + (v-p).Mag()/numUsedTracks;
+  fVertexLines.resize(6 * numLines);
+  fVertexWeights.assign(numLines, 1);
+  fVertexResiduals.resize(numLines);
+  fVertexMedian.resize(numLines);
 
-      numUsedTracks++;
+  // Start from the median of the upstream (smaller z) ends of the tracks,
+  // so that the first weights are not biased by tracks not from the vertex
+  for (auto iLine = 0; iLine < numLines; iLine++) {
+    auto track = fVertexTracks[iLine];
+    if (track -> IsLine()) {
+      LineForVertex(track, &fVertexLines[6 * iLine]);
+      continue;
     }
+    Double_t alpha = track -> GetAlphaHead();
+    if (track -> PositionAtTail().Z() < track -> PositionAtHead().Z())
+      alpha = track -> GetAlphaTail();
+    LinearizeForVertex(track, alpha, &fVertexLines[6 * iLine]);
+  }
 
-    return s;
-  };
-
-  Double_t z0 = 500;
-  Double_t dz = 200;
-  Double_t s0 = 1.e8;
+  for (auto i = 0; i < 3; i++) {
+    for (auto iLine = 0; iLine < numLines; iLine++)
+      fVertexMedian[iLine] = fVertexLines[6 * iLine + i];
+    std::nth_element(fVertexMedian.begin(), fVertexMedian.begin() + numLines/2, fVertexMedian.end());
+    vertex[i] = fVertexMedian[numLines/2];
+  }
 
-  const Int_t numSamples = 9;
-  Int_t halfOfSamples = (numSamples)/2;
+  for (auto iIteration = 0; iIteration < nIterations; iIteration++)
+  {
+    // Linearize at the point of helix closest to the vertex in xz
+    for (auto iLine = 0; iLine < numLines; iLine++) {
+      auto track = fVertexTracks[iLine];
+      if (!track -> IsLine()) {
+        Double_t alpha = TMath::ATan2(vertex.Z() - track -> GetHelixCenterZ(), vertex.X() - track -> GetHelixCenterX());
+        Double_t alphaMid = .5 * (track -> GetAlphaHead() + track -> GetAlphaTail());
+        alpha += TMath::TwoPi() * TMath::Nint((alphaMid - alpha) / TMath::TwoPi());
+        LinearizeForVertex(track, alpha, &fVertexLines[6 * iLine]);
+      }
 
-  Double_t zArray[numSamples] = {0};
-  for (Int_t iSample = 0; iSample <= numSamples; iSample++)
-    zArray[iSample] = (iSample - halfOfSamples) * dz + z0;
+      fVertexResiduals[iLine] = DistanceToLine(&fVertexLines[6 * iLine], vertex);
+      fVertexMedian[iLine] = fVertexResiduals[iLine];
+    }
 
-  for (auto z : zArray) {
-    TVector3 v(0, 0, z);
-    Double_t s = TestZ(v);
+    // Tukey biweight with the scale from the median distance
+    std::nth_element(fVertexMedian.begin(), fVertexMedian.begin() + numLines/2, fVertexMedian.end());
+    Double_t scale = 1.4826 * fVertexMedian[numLines/2];
+    if (scale < fVertexMinScale)
+      scale = fVertexMinScale;
+    Double_t cut = 4.685 * scale;
 
-    if (s < s0) {
-      s0 = s;
-      z0 = z;
+    for (auto iLine = 0; iLine < numLines; iLine++) {
+      Double_t u = fVertexResiduals[iLine] / cut;
+      fVertexWeights[iLine] = u < 1 ? (1 - u*u) * (1 - u*u) : 0;
     }
+
+    if (SolveVertex(vertex) == false)
+      break;
   }
 
-  while (nIterations > 0) {
-    dz = dz/halfOfSamples;
-    for (Int_t iSample = 0; iSample <= numSamples; iSample++)
-      zArray[iSample] = (iSample - halfOfSamples) * dz + z0;
+  return vertex;
+}
 
-    for (auto z : zArray) {
-      TVector3 v(0, 0, z);
-      Double_t s = TestZ(v);
+void
+STHelixTrackFinder::LinearizeForVertex(STHelixTrack *track, Double_t alpha, Double_t *line)
+{
+  Double_t radius = track -> GetHelixRadius();
+  Double_t slope = track -> GetAlphaSlope();
+  Double_t cosA = TMath::Cos(alpha);
+  Double_t sinA = TMath::Sin(alpha);
+
+  line[0] = radius * cosA + track -> GetHelixCenterX();
+  line[1] = alpha * slope + track -> GetYInitial();
+  line[2] = radius * sinA + track -> GetHelixCenterZ();
+
+  Double_t dx = -radius * sinA;
+  Double_t dz = radius * cosA;
+  Double_t norm = 1. / sqrt(dx*dx + slope*slope + dz*dz);
+
+  line[3] = dx * norm;
+  line[4] = slope * norm;
+  line[5] = dz * norm;
+}
 
-      if (s < s0) {
-        s0 = s;
-        z0 = z;
-      }
-    }
+void
+STHelixTrackFinder::LineForVertex(STHelixTrack *track, Double_t *line)
+{
+  TVector3 mean = track -> GetMean();
+  TVector3 direction = track -> GetLineDirection().Unit();
+
+  line[0] = mean.X();
+  line[1] = mean.Y();
+  line[2] = mean.Z();
+  line[3] = direction.X();
+  line[4] = direction.Y();
+  line[5] = direction.Z();
+}
 
-    nIterations--;
+Double_t
+STHelixTrackFinder::DistanceToLine(const Double_t *line, const TVector3 &point)
+{
+  Double_t dx = point.X() - line[0];
+  Double_t dy = point.Y() - line[1];
+  Double_t dz = point.Z() - line[2];
+  Double_t t = dx*line[3] + dy*line[4] + dz*line[5];
+
+  return sqrt(TMath::Max(0., dx*dx + dy*dy + dz*dz - t*t));
+}
+
+bool
+STHelixTrackFinder::SolveVertex(TVector3 &vertex)
+{
+  // Minimize sum of w |(1 - d d^T)(v - p)|^2 over the lines (p, d): A v = b
+  Double_t a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+  Double_t b0 = 0, b1 = 0, b2 = 0;
+  Double_t weightSum = 0;
+
+  Int_t numLines = fVertexWeights.size();
+  for (auto iLine = 0; iLine < numLines; iLine++) {
+    Double_t w = fVertexWeights[iLine];
+    if (w <= 0)
+      continue;
+
+    const Double_t *p = &fVertexLines[6 * iLine];
+    const Double_t *d = p + 3;
+    Double_t m00 = w * (1 - d[0]*d[0]), m01 = -w * d[0]*d[1], m02 = -w * d[0]*d[2];
+    Double_t m11 = w * (1 - d[1]*d[1]), m12 = -w * d[1]*d[2], m22 = w * (1 - d[2]*d[2]);
+
+    a00 += m00; a01 += m01; a02 += m02;
+    a11 += m11; a12 += m12; a22 += m22;
+    b0 += m00*p[0] + m01*p[1] + m02*p[2];
+    b1 += m01*p[0] + m11*p[1] + m12*p[2];
+    b2 += m02*p[0] + m12*p[1] + m22*p[2];
+    weightSum += w;
   }
 
-  TVector3 v(0, 0, z0);
-  TestZ(v);
+  if (weightSum <= 0)
+    return false;
+
+  // Directions not fixed by the lines (one track, parallel tracks) stay at the last vertex
+  Double_t prior = 1.e-6 * weightSum;
+  a00 += prior; a11 += prior; a22 += prior;
+  b0 += prior * vertex.X();
+  b1 += prior * vertex.Y();
+  b2 += prior * vertex.Z();
+
+  Double_t c00 = a11*a22 - a12*a12;
+  Double_t c01 = a02*a12 - a01*a22;
+  Double_t c02 = a01*a12 - a02*a11;
+  Double_t c11 = a00*a22 - a02*a02;
+  Double_t c12 = a01*a02 - a00*a12;
+  Double_t c22 = a00*a11 - a01*a01;
+
+  Double_t det = a00*c00 + a01*c01 + a02*c02;
+  if (det <= 0)
+    return false;
+
+  vertex.SetXYZ((c00*b0 + c01*b1 + c02*b2) / det,
+                (c01*b0 + c11*b1 + c12*b2) / det,
+                (c02*b0 + c12*b1 + c22*b2) / det);
 
-  return v;
+  return true;
 }
 
+STHitTable *STHelixTrackFinder::GetHitTable() { return fHitTable; }
+
 void STHelixTrackFinder::SetClusteringOption(Int_t opt) { fClusteringOption = opt; }
 void STHelixTrackFinder::SetDefaultCutScale(Double_t scale) { fDefaultScale = scale; }
+void STHelixTrackFinder::SetNumSectors(Int_t numSectors) { fNumSectors = numSectors; }
+void STHelixTrackFinder::SetSectorOverlap(Double_t overlap) { fSectorOverlap = overlap; }
+void STHelixTrackFinder::SetBeamAxis(Double_t x, Double_t y)
+{
+  fBeamX = x;
+  fBeamY = y;
+}
+void STHelixTrackFinder::SetSectorTolerances(Double_t matchRatio, Double_t ownerRatio)
+{
+  fSectorMatchTolerance = matchRatio;
+  fSectorOwnerTolerance = ownerRatio;
+}
+void STHelixTrackFinder::SetValidateSectors(Bool_t val) { fValidateSectors = val; }
+void STHelixTrackFinder::SetUseSinglePrecision(Bool_t val) { fUseSinglePrecision = val; }
+void STHelixTrackFinder::SetValidatePrecision(Bool_t val) { fValidatePrecision = val; }
 void STHelixTrackFinder::SetTrackWidthCutLimits(Double_t lowLimit, Double_t highLimit)
 {
   fTrackWCutLL = lowLimit;
@@ -2,10 +2,12 @@
 #define STHELIXTRACKFINDER
 
 #include "STPadPlaneMap.hh"
+#include "STHitTable.hh"
 #include "STHelixTrack.hh"
 #include "STHelixTrackFitter.hh"
 #include "STHit.hh"
 #include "STHitCluster.hh"
+#include "STThreadPool.hh"
 #include "TClonesArray.h"
 #include <vector>
 
@@ -15,11 +17,33 @@ class STHelixTrackFinder
 {
   public:
     STHelixTrackFinder();
-    ~STHelixTrackFinder() {}
+    ~STHelixTrackFinder();
 
     void BuildTracks(TClonesArray *hitArray, TClonesArray *trackArray, TClonesArray *hitClusterArray);
 
-    TVector3 FindVertex(TClonesArray *tracks, Int_t nIterations = 1);
+    /**
+     * Hits of the last BuildTracks() in columns, with the owner track of each hit.
+     * Filled once per event from hitArray. Correlate(), CorrelateSimple() and
+     * the clustering read the hit positions, rows and layers from the columns,
+     * and the sector finding distributes and copies the hits with it.
+     */
+    STHitTable *GetHitTable();
+
+    /**
+     * Vertex of tracks by weighted least squares.
+     *
+     * Starting from the median of the upstream (smaller z) ends of the tracks
+     * (mean of the hits for line tracks),
+     * in each iteration every helix track (also after GENFIT) is replaced by its
+     * tangent line at the point closest to the vertex in xz, and every line track
+     * by its fitted line. The vertex is moved to the point
+     * which minimizes the weighted sum of squared distances to the lines (3x3
+     * linear system). Weights are Tukey biweight of the distance to the last
+     * vertex with the scale from the median distance, so that tracks not from
+     * the vertex do not pull it. Cost is linear in the number of tracks.
+     * Plane and bad tracks (kPlane, kBad) have no direction and are not used.
+     */
+    TVector3 FindVertex(TClonesArray *tracks, Int_t nIterations = 3);
 
     void SetClusteringOption(Int_t opt);
 
@@ -56,8 +80,126 @@ class STHelixTrackFinder
     */
     void SetTrackHeightCutLimits(Double_t lowLimit, Double_t highLimit);
 
+    /**
+     * Find tracks in numSectors azimuthal sectors around the beam axis in parallel.
+     * 0 or 1 for the serial finder (default).
+     *
+     * Each sector gets copies of the hits in the sector and within the overlap
+     * of its neighbor sectors (hits near the beam axis go to all sectors),
+     * and runs the serial finder on its own map and fitter on STThreadPool::Instance().
+     * Tracks are merged in sector order:
+     *  - tracks of two sectors sharing at least fSectorMergeRatio (0.5) of the hits
+     *    which both sectors could see are merged into one track with the hits of both,
+     *  - a hit claimed by two merged tracks goes to the track found in the hit's own sector,
+     *    otherwise to the track merged first,
+     *  - merged tracks are refitted with the original hits, and tracks with
+     *    hits near a sector boundary are extrapolated on the full event map,
+     *  - the serial finder runs on the hits left free to find the rest.
+     * The result does not depend on thread scheduling.
+     */
+    void SetNumSectors(Int_t numSectors);
+
+    /// Overlap of the neighbor sectors in degree. Default is 15.
+    void SetSectorOverlap(Double_t overlap);
+
+    /// Beam axis (x, y) [mm] around which the sectors are made. Default is (0, -213.3).
+    void SetBeamAxis(Double_t x, Double_t y);
+
+    /**
+     * With sectors, also run the serial finder on every event and compare
+     * the tracks (see PrintSectorValidation()). Tracks of the sector finder are
+     * given as output, unless the event is out of the tolerances of
+     * SetSectorTolerances(). Then the serial finder runs again for the output.
+     * For validation only, since tracks are found twice.
+     */
+    void SetValidateSectors(Bool_t val = kTRUE);
+
+    /**
+     * Tolerances of the sector finder with SetValidateSectors():
+     *  - matchRatio: least fraction of the serial tracks matched by a sector track (default 0.9),
+     *  - ownerRatio: least fraction of the hits with the same owner in both (default 0.9).
+     */
+    void SetSectorTolerances(Double_t matchRatio, Double_t ownerRatio);
+
+    /**
+     * Print comparison of the sector and serial tracks accumulated so far.
+     * A serial track is matched when one sector track shares at least
+     * fValidationMatchRatio (0.8) of the hits of both tracks. Events out of
+     * the tolerances are counted as fallback to the serial finder.
+     */
+    void PrintSectorValidation();
+
+    /**
+     * Map head, tail and hit of Correlate() in single precision
+     * (STHelixTrack::MapBatch<Float_t>). Track parameters, fits and
+     * the hit clustering of the found tracks stay in double precision.
+     */
+    void SetUseSinglePrecision(Bool_t val = kTRUE);
+
+    /**
+     * With single precision, also map in double precision in every Correlate()
+     * and compare (see PrintPrecisionValidation()). Single precision result is used.
+     */
+    void SetValidatePrecision(Bool_t val = kTRUE);
+
+    /// Print comparison of single and double precision Correlate() accumulated so far.
+    void PrintPrecisionValidation();
+
 
   private:
+    /**
+     * Build tracks from the free hits of fEventMap into fTrackArray
+     * until there is no more free hit. This is the serial finder.
+     */
+    void FindTracks();
+
+    /// Find tracks of sector in thread: make hits (hitIndices of hitTable) in localHits and run FindTracks().
+    void FindSectorTracks(STHitTable *hitTable, std::vector<Int_t> *hitIndices, TClonesArray *localHits, TClonesArray *localTracks);
+
+    /// Run sector finders in parallel, merge and complete the tracks into fTrackArray.
+    void FindTracksInSectors();
+
+    /**
+     * Core sector of hit at (x, y). neighbor is the other sector of which overlap
+     * contains the hit (-1 if none), nearAxis is true if the hit goes to all sectors.
+     */
+    Int_t CoreSector(Double_t x, Double_t y, Int_t &neighbor, bool &nearAxis);
+
+    /// true if hit iHit of fHitTable is given to sector
+    bool IsHitInSector(Int_t iHit, Int_t sector);
+
+    /// Fill line (point, unit direction) tangent to the helix at alpha
+    void LinearizeForVertex(STHelixTrack *track, Double_t alpha, Double_t *line);
+    /// Fill line (point, unit direction) of the line track: mean of the hits and fitted direction
+    void LineForVertex(STHelixTrack *track, Double_t *line);
+    Double_t DistanceToLine(const Double_t *line, const TVector3 &point);
+    /// Vertex from fVertexLines and fVertexWeights. Return false if not solvable.
+    bool SolveVertex(TVector3 &vertex);
+
+    /**
+     * Charge, hit clustering and finalization of the tracks in fTrackArray.
+     * Tracks are clustered in parallel on STThreadPool, each worker with its own
+     * fitter and cluster slab. Clusters are then copied into fHitClusterArray
+     * in track order, and cluster IDs and cluster pointers of tracks are remapped.
+     * Tracks sharing hits with other tracks are clustered and copied serially,
+     * as both steps write to the hits.
+     */
+    void FinalizeTracks(TVector3 vertex);
+
+    /// STHelixTrack::MapBatch() of the hits of track into fMapW, fMapH, fMapL and fMapAlpha
+    void MapTrackHits(STHelixTrack *track);
+
+    /**
+     * Index of hit in fHitTable, which is the hit ID if the table holds hit there.
+     * -1 for hits which are not in the table; their getters are read instead.
+     */
+    Int_t TableIndex(STHit *hit);
+
+    /// Run serial finder into fValidationTrackArray and keep the owner track of each hit.
+    void RunSerialValidation();
+    /// Compare owner tracks of hits with the serial ones. Return false if out of the tolerances.
+    bool CompareWithSerial();
+
     /** 
      * Create new track with free hit from event map
      * return nullptr if there no more free hit.
@@ -145,6 +287,14 @@ class STHelixTrackFinder
      */
     Double_t Correlate(STHelixTrack *track, STHit *hit, Double_t rScale = 1);
 
+    /// Map head, tail and hit to w, h and l in precision T for Correlate()
+    template <typename T>
+    void MapCorrelation(STHelixTrack *track, STHit *hit, Double_t *w, Double_t *h, Double_t *l);
+
+    /// Quality of Correlate() from the mapped head, tail and hit
+    Double_t CorrelationQuality(STHelixTrack *track, const Double_t *w, const Double_t *h, const Double_t *l,
+                                Double_t rmsWCut, Double_t rmsHCut);
+
     /**
      * Correlate hit-track by checking hit is right next to hits from track.
      */
@@ -160,7 +310,9 @@ class STHelixTrackFinder
   private:
     TClonesArray *fTrackArray = nullptr;       ///< STHelixTrack array
     TClonesArray *fHitClusterArray = nullptr;  ///< STHitCluster array
+    STHelixTrack *fFailedTrack = nullptr;      ///< Last track which failed, reused by NewTrack()
     STPadPlaneMap *fEventMap = nullptr;        ///< hit map to pad plane
+    STHitTable *fHitTable = nullptr;           ///< hits of the event in columns, shared with the clustering finders
     STHelixTrackFitter *fFitter = nullptr;     ///< Helix track fitter
 
     vhit_t fCandHits = nullptr;  ///< Candidate hits comming from fEventMap
@@ -175,8 +327,73 @@ class STHelixTrackFinder
     Double_t fTrackHCutLL = 2.;  //< Track height cut low limit
     Double_t fTrackHCutHL = 4.;  //< Track height cut high limit
 
-
-  ClassDef(STHelixTrackFinder, 2)
+    Int_t fNumSectors = 1;
+    Double_t fSectorOverlap = 15.;        ///< [deg]
+    Double_t fSectorMinRadius = 30.;      ///< hits closer to the beam axis [mm] go to all sectors
+    Double_t fBeamX = 0.;                 ///< x of the beam axis [mm]
+    Double_t fBeamY = -213.3;             ///< y of the beam axis [mm]
+    Double_t fSectorMergeRatio = 0.5;     ///< shared fraction of the visible hits to merge tracks of two sectors
+    static const Int_t kAllSectors = -2;  ///< neighbor sector of hits near the beam axis
+
+    STThreadPool *fPool = nullptr;                         //!
+    std::vector<STHelixTrackFinder *> fSectorFinders;      //!
+    std::vector<TClonesArray *> fSectorHitArrays;          //! copies of the hits of each sector
+    std::vector<TClonesArray *> fSectorTrackArrays;        //! tracks of each sector
+    std::vector<std::vector<Int_t>> fSectorHitIndices;     //! fHitTable index of the hits of each sector
+    std::vector<Int_t> fHitCoreSector;                     //! core sector of each hit of fHitTable
+    std::vector<Int_t> fHitNeighborSector;                 //! neighbor sector of each hit, kAllSectors near the beam axis
+    std::vector<Int_t> fLocalTrackSector;                  //! sector of each track of the sector finders
+    std::vector<std::vector<Int_t>> fLocalTrackHits;       //! fHitTable index of the hits of each track of the sector finders
+    std::vector<std::pair<Int_t, Int_t>> fHitTrackPairs;   //! (hit, track) of the sector finders
+    std::vector<std::pair<Int_t, Int_t>> fTrackPairs;      //! (track, track) of different sectors for each shared hit
+    std::vector<Int_t> fMergeParent;                       //! merged tracks, lowest track of the group is the root
+    std::vector<Int_t> fLocalTrackKept;                    //! kept track of each root track, -1 if not root
+    std::vector<Int_t> fHitClaim;                          //! kept track which owns each hit, -1 if none
+    std::vector<char> fHitClaimInCore;                     //! 1 if the claim is by a track of the hit's own sector
+    std::vector<std::vector<std::pair<Int_t, Int_t>>> fKeptHits; //! (fHitTable index, 1 if found in the hit's own sector) of each kept track
+
+    std::vector<STHelixTrackFinder *> fClusteringFinders;  //! fitter and cluster slab of each worker
+    std::vector<Int_t> fTrackClusterSlab;                  //! worker which clustered each track
+    std::vector<Int_t> fTrackClusterBegin;                 //! first cluster of each track in the slab
+    std::vector<Int_t> fTrackClusterIndex;                 //! first cluster of each track in the output
+    std::vector<Int_t> fHitFirstTrack;                     //! first track of each hit of fHitTable, -1 if none
+    std::vector<char> fTrackSharesHits;                    //! 1 if track shares hits with other tracks
+
+    Double_t fVertexMinScale = 2.;                         ///< lower limit of the distance scale in FindVertex() [mm]
+    std::vector<STHelixTrack *> fVertexTracks;             //!
+    std::vector<Double_t> fVertexLines;                    //! (point, direction) of each track
+    std::vector<Double_t> fVertexWeights;                  //!
+    std::vector<Double_t> fVertexResiduals;                //!
+    std::vector<Double_t> fVertexMedian;                   //!
+
+    std::vector<Double_t> fMapX, fMapY, fMapZ;             //! hit positions for MapTrackHits()
+    std::vector<Double_t> fMapW, fMapH, fMapL, fMapAlpha;  //! mapped hit positions of MapTrackHits()
+
+    Bool_t fValidateSectors = kFALSE;
+    Double_t fValidationMatchRatio = 0.8;
+    Double_t fSectorMatchTolerance = 0.9;                  ///< least fraction of the serial tracks matched
+    Double_t fSectorOwnerTolerance = 0.9;                  ///< least fraction of the hits with the same owner
+    TClonesArray *fValidationTrackArray = nullptr;         //! tracks of the serial finder
+    std::vector<Int_t> fSerialOwners;                      //! serial track of each hit, -1 if none
+    Long64_t fNumValidatedEvents = 0;                      //!
+    Long64_t fNumSerialTracks = 0;                         //! tracks found by the serial finder
+    Long64_t fNumSectorTracks = 0;                         //! tracks found with sectors
+    Long64_t fNumMatchedTracks = 0;                        //! serial tracks matched by a sector track
+    Long64_t fNumValidatedHits = 0;                        //!
+    Long64_t fNumSameOwnerHits = 0;                        //! hits in matched tracks, or in no track in both
+    Double_t fMaxRelDiffRadius = 0;                        //! max relative difference of helix radius of matched tracks
+    Long64_t fNumFallbackEvents = 0;                       //! events out of the tolerances, given by the serial finder
+
+    Bool_t fUseSinglePrecision = kFALSE;
+    Bool_t fValidatePrecision = kFALSE;
+    Long64_t fNumPrecisionCorrelations = 0;                //! Correlate() calls compared
+    Long64_t fNumPrecisionDiffDecisions = 0;               //! hit accepted in one precision only
+    Double_t fMaxPrecisionDiffW = 0;                       //! [mm]
+    Double_t fMaxPrecisionDiffH = 0;                       //! [mm]
+    Double_t fMaxPrecisionDiffL = 0;                       //! [mm]
+
+
+  ClassDef(STHelixTrackFinder, 10)
 };
 
 #endif
@@ -71,7 +71,8 @@ STClusterizerCurveTrack::AnalyzeTrack(TClonesArray *trackArray, TClonesArray *cl
       }
 
       cluster -> SetClusterID(index);
-      STHitCluster *in = new ((*clusterArray)[index]) STHitCluster(cluster);
+      STHitCluster *in = (STHitCluster *) clusterArray -> ConstructedAt(index);
+      *in = *cluster;
       in -> SetClusterID(index);
       track -> AddCluster(in);
 
@@ -187,7 +188,7 @@ STHitCluster*
 STClusterizerCurveTrack::NewCluster(STHit* hit, TClonesArray *array)
 {
   Int_t index = array -> GetEntriesFast();
-  STHitCluster* cluster = new ((*array)[index]) STHitCluster();
+  STHitCluster* cluster = (STHitCluster *) array -> ConstructedAt(index);
   cluster -> SetClusterID(index);
   cluster -> AddHit(hit);
 
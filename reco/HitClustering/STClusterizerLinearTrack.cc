@@ -69,7 +69,7 @@ STHitCluster*
 STClusterizerLinearTrack::NewCluster(STHit* hit, TClonesArray *array)
 {
   Int_t index = array -> GetEntriesFast();
-  STHitCluster* cluster = new ((*array)[index]) STHitCluster();
+  STHitCluster* cluster = (STHitCluster *) array -> ConstructedAt(index);
   cluster -> SetClusterID(index);
   cluster -> AddHit(hit);
 
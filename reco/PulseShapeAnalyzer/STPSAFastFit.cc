@@ -3,7 +3,8 @@
 
 // STL
 #include <cmath>
-#include <thread>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
 
 using namespace std;
@@ -38,16 +39,22 @@ STPSAFastFit::STPSAFastFit(Int_t shapingTime)
   Init();
 }
 
+STPSAFastFit::~STPSAFastFit()
+{
+  for (auto slab : fSlabs)
+    delete slab;
+}
+
 void
 STPSAFastFit::Init()
 {
-  fThreadHitArray = new TClonesArray*[NUMTHREAD];
-  for (Int_t iThread = 0; iThread < NUMTHREAD; iThread++)
-    fThreadHitArray[iThread] = new TClonesArray("STHit", 100);
+  fPool = STThreadPool::Instance();
+  for (auto slab : fSlabs)
+    delete slab;
+  fSlabs.resize(fPool -> GetNumThreads() + 1);
+  for (auto &slab : fSlabs)
+    slab = new TClonesArray("STHit", 1000);
 
-  fPadIndex = 0;
-  fNumPads = 0;
-  
   if (fWindowStartTb == 0)
     fWindowStartTb = 1;
 
@@ -56,154 +63,264 @@ STPSAFastFit::Init()
   fThresholdOneTbStep = fThresholdTbStep * fThreshold;
 }
 
-void
-STPSAFastFit::Analyze(STRawEvent *rawEvent, STEvent *event)
+void STPSAFastFit::SetNumThreads(Int_t numThreads) { fNumThreads = numThreads; }
+void STPSAFastFit::SetUseNewtonFit(Bool_t val) { fUseNewtonFit = val; }
+void STPSAFastFit::SetNumFitLanes(Int_t numLanes) { fNumFitLanes = numLanes; }
+void STPSAFastFit::SetUseSinglePrecision(Bool_t val) { fUseSinglePrecision = val; }
+void STPSAFastFit::SetValidatePrecision(Bool_t val) { fValidatePrecision = val; }
+
+Int_t
+STPSAFastFit::PadAnalyzer(STRawEvent *rawEvent)
 {
-  fNumPads = rawEvent -> GetNumPads();
-  fPadArray = rawEvent -> GetPads();
-  fPadIndex = 0;
+  if (fUseSinglePrecision && fValidatePrecision) {
+    AnalyzePads<Double_t>(rawEvent);
+    SetPrecisionReference();
+  }
 
-#ifdef DEBUG
-  LOG(INFO) << "Start to create threads!" << FairLogger::endl;
-#endif
+  if (fUseSinglePrecision)
+    AnalyzePads<Float_t>(rawEvent);
+  else
+    AnalyzePads<Double_t>(rawEvent);
 
-  std::thread thread[NUMTHREAD];
-  for (Int_t iThread = 0; iThread < NUMTHREAD; iThread++)
-    thread[iThread] = std::thread([this](TClonesArray *array) { this -> PadAnalyzer(array); }, fThreadHitArray[iThread]);
+  if (fUseSinglePrecision && fValidatePrecision)
+    ComparePrecisionReference();
 
-#ifdef DEBUG
-  LOG(INFO) << "Successfully created threads!" << FairLogger::endl;
-#endif
+  Int_t numHits = 0;
+  Int_t numPads = fPadHitCount.size();
+  for (Int_t iPad = 0; iPad < numPads; iPad++) {
+    fPadHitIndex[iPad] = numHits;
+    numHits += fPadHitCount[iPad];
+  }
 
-  for (Int_t iThread = 0; iThread < NUMTHREAD; iThread++) {
+  return numHits;
+}
 
-#ifdef DEBUG
-  LOG(INFO) << "Thread: " << iThread << " is not joinable!"  << FairLogger::endl;
-#endif
+template <typename T>
+void
+STPSAFastFit::AnalyzePads(STRawEvent *rawEvent)
+{
+  Int_t numPads = rawEvent -> GetNumPads();
+  std::vector<STPad> *padArray = rawEvent -> GetPads();
+
+  fPadSlab.resize(numPads);
+  fPadHitBegin.resize(numPads);
+  fPadHitCount.resize(numPads);
+  fPadHitIndex.resize(numPads);
 
-      thread[iThread].join();
+  for (auto slab : fSlabs)
+    slab -> Clear("C");
+
+  if (fUseNewtonFit && fNumFitLanes > 1)
+  {
+    // Quiet pads are dropped first, and the rest are fitted in blocks of lanes.
+    fPadTbFirst.resize(numPads);
+    fPool -> ParallelFor(numPads, [this, padArray](Int_t iPad, Int_t)
+    {
+      fPadSlab[iPad] = 0;
+      fPadHitBegin[iPad] = 0;
+      fPadHitCount[iPad] = 0;
+
+      STPad *pad = &(padArray -> at(iPad));
+      if (pad -> GetLayer() <= fLayerLowCut || pad -> GetLayer() >= fLayerHighCut
+          || PrescanPad(pad -> GetADC(), fPadTbFirst[iPad]) == kFALSE)
+        fPadTbFirst[iPad] = -1;
+    }, 4 * fPadChunkSize, fNumThreads);
+
+    fActivePads.clear();
+    for (Int_t iPad = 0; iPad < numPads; iPad++)
+      if (fPadTbFirst[iPad] >= 0)
+        fActivePads.push_back(iPad);
+
+    Int_t numActivePads = fActivePads.size();
+    Int_t numPadsInBlock = 4 * fNumFitLanes;
+    Int_t numBlocks = (numActivePads + numPadsInBlock - 1) / numPadsInBlock;
+    fPool -> ParallelFor(numBlocks, [this, padArray, numActivePads, numPadsInBlock](Int_t iBlock, Int_t iWorker)
+    {
+      Int_t begin = iBlock * numPadsInBlock;
+      Int_t num = numActivePads - begin < numPadsInBlock ? numActivePads - begin : numPadsInBlock;
+      FindPadHitsLanes<T>(padArray, &fActivePads[begin], num, iWorker);
+    }, 1, fNumThreads);
   }
+  else
+  {
+    fPool -> ParallelFor(numPads, [this, padArray](Int_t iPad, Int_t iWorker)
+    {
+      TClonesArray *slab = fSlabs[iWorker];
+      Int_t hitNum = slab -> GetEntriesFast();
 
-#ifdef DEBUG
-  LOG(INFO) << "Joining completed! Merging data!"  << FairLogger::endl;
-#endif
+      fPadSlab[iPad] = iWorker;
+      fPadHitBegin[iPad] = hitNum;
 
-  Int_t hitNum = 0;
-  for (Int_t iThread = 0; iThread < NUMTHREAD; iThread++) {
-    Int_t numHits = fThreadHitArray[iThread] -> GetEntriesFast();
+      STPad *pad = &(padArray -> at(iPad));
+      if (pad -> GetLayer() > fLayerLowCut && pad -> GetLayer() < fLayerHighCut)
+        FindPadHits<T>(pad, slab, hitNum);
 
-    for (Int_t iHit = 0; iHit < numHits; iHit++) {
-      STHit *hit = (STHit *) fThreadHitArray[iThread] -> At(iHit);
-      hit -> SetHitID(hitNum++);
+      fPadHitCount[iPad] = hitNum - fPadHitBegin[iPad];
+    }, fPadChunkSize, fNumThreads);
+  }
+}
 
-      Double_t x = hit -> GetZ();
-      Double_t y = hit -> GetY();
+void
+STPSAFastFit::SetPrecisionReference()
+{
+  Int_t numPads = fPadHitCount.size();
+  fRefHitBegin.resize(numPads);
+  fRefHitCount.resize(numPads);
+  fRefTb.clear();
+  fRefCharge.clear();
 
-      event -> AddHit(hit);
+  for (Int_t iPad = 0; iPad < numPads; iPad++)
+  {
+    fRefHitBegin[iPad] = fRefTb.size();
+    fRefHitCount[iPad] = fPadHitCount[iPad];
+
+    TClonesArray *slab = fSlabs[fPadSlab[iPad]];
+    Int_t end = fPadHitBegin[iPad] + fPadHitCount[iPad];
+    for (Int_t iHit = fPadHitBegin[iPad]; iHit < end; iHit++) {
+      STHit *hit = (STHit *) slab -> UncheckedAt(iHit);
+      fRefTb.push_back(hit -> GetTb());
+      fRefCharge.push_back(hit -> GetCharge());
     }
   }
+
+  for (auto slab : fSlabs)
+    slab -> Clear("C");
 }
 
 void
-STPSAFastFit::Analyze(STRawEvent *rawEvent, TClonesArray *hitArray)
+STPSAFastFit::ComparePrecisionReference()
 {
-  fNumPads = rawEvent -> GetNumPads();
-  fPadArray = rawEvent -> GetPads();
-  fPadIndex = 0;
+  Int_t numPads = fPadHitCount.size();
+  for (Int_t iPad = 0; iPad < numPads; iPad++)
+  {
+    if (fRefHitCount[iPad] == 0 && fPadHitCount[iPad] == 0)
+      continue;
 
-#ifdef DEBUG
-  LOG(INFO) << "Start to create threads!" << FairLogger::endl;
-#endif
+    fNumValidatedPads++;
+    if (fRefHitCount[iPad] != fPadHitCount[iPad]) {
+      fNumMismatchedPads++;
+      continue;
+    }
 
-  std::thread thread[NUMTHREAD];
-  for (Int_t iThread = 0; iThread < NUMTHREAD; iThread++)
-    thread[iThread] = std::thread([this](TClonesArray *array) { this -> PadAnalyzer(array); }, fThreadHitArray[iThread]);
+    TClonesArray *slab = fSlabs[fPadSlab[iPad]];
+    for (Int_t iHit = 0; iHit < fPadHitCount[iPad]; iHit++)
+    {
+      STHit *hit = (STHit *) slab -> UncheckedAt(fPadHitBegin[iPad] + iHit);
+      Double_t tbRef = fRefTb[fRefHitBegin[iPad] + iHit];
+      Double_t chargeRef = fRefCharge[fRefHitBegin[iPad] + iHit];
 
-#ifdef DEBUG
-  LOG(INFO) << "Successfully created threads!" << FairLogger::endl;
-#endif
+      Double_t diffTb = abs(hit -> GetTb() - tbRef);
+      Double_t relDiffCharge = chargeRef != 0 ? abs(hit -> GetCharge() - chargeRef) / chargeRef : 0;
 
-  for (Int_t iThread = 0; iThread < NUMTHREAD; iThread++) {
+      fNumValidatedHits++;
+      fSumDiffTb2 += diffTb * diffTb;
+      if (diffTb > fMaxDiffTb) fMaxDiffTb = diffTb;
+      if (relDiffCharge > fMaxRelDiffCharge) fMaxRelDiffCharge = relDiffCharge;
+    }
+  }
+}
 
-#ifdef DEBUG
-  LOG(INFO) << "Thread: " << iThread << " is not joinable!"  << FairLogger::endl;
-#endif
+void
+STPSAFastFit::PrintPrecisionValidation()
+{
+  Double_t rmsDiffTb = fNumValidatedHits > 0 ? sqrt(fSumDiffTb2 / fNumValidatedHits) : 0;
 
-      thread[iThread].join();
-  }
+  LOG(INFO) << "PSA float vs double: " << fNumValidatedPads << " pads, "
+            << fNumMismatchedPads << " with different number of hits, "
+            << fNumValidatedHits << " hits compared, "
+            << "tb diff max " << fMaxDiffTb << " rms " << rmsDiffTb << ", "
+            << "charge rel. diff max " << fMaxRelDiffCharge << FairLogger::endl;
+}
 
-#ifdef DEBUG
-  LOG(INFO) << "Joining completed! Merging data!"  << FairLogger::endl;
-#endif
+void
+STPSAFastFit::Analyze(STRawEvent *rawEvent, STEvent *event)
+{
+  PadAnalyzer(rawEvent);
 
   Int_t hitNum = 0;
-  for (Int_t iThread = 0; iThread < NUMTHREAD; iThread++) {
-    Int_t numHits = fThreadHitArray[iThread] -> GetEntriesFast();
-
-    for (Int_t iHit = 0; iHit < numHits; iHit++) {
-      STHit *hit = (STHit *) fThreadHitArray[iThread] -> At(iHit);
+  Int_t numPads = fPadHitCount.size();
+  for (Int_t iPad = 0; iPad < numPads; iPad++) {
+    TClonesArray *slab = fSlabs[fPadSlab[iPad]];
+    Int_t end = fPadHitBegin[iPad] + fPadHitCount[iPad];
+    for (Int_t iHit = fPadHitBegin[iPad]; iHit < end; iHit++) {
+      STHit *hit = (STHit *) slab -> At(iHit);
       hit -> SetHitID(hitNum++);
-
-      Double_t x = hit -> GetZ();
-      Double_t y = hit -> GetY();
-
-      new ((*hitArray)[hitArray->GetEntriesFast()]) STHit(hit);
+      event -> AddHit(hit);
     }
   }
 }
 
-void STPSAFastFit::PadAnalyzer(TClonesArray *hitArray)
+void
+STPSAFastFit::Analyze(STRawEvent *rawEvent, TClonesArray *hitArray)
 {
-  Int_t hitNum = 0;
-
-  hitArray -> Clear("C");
-
-  while (1) {
-    STPad *pad = nullptr;
-
-    {
-      std::lock_guard<std::mutex> lock(fMutex);
-      if (fPadIndex == fNumPads) {
+  Int_t numHits = PadAnalyzer(rawEvent);
 
-#ifdef DEBUG
-  LOG(INFO) << "Thread ended!" << FairLogger::endl;
-#endif
+  // Create all output objects first (recycled ones are reused), then fill them
+  // in parallel. Each pad writes to its own range, so the order is the pad order.
+  Int_t offset = hitArray -> GetEntriesFast();
+  hitArray -> ExpandCreateFast(offset + numHits);
 
-        return;
-      }
+  Int_t numPads = fPadHitCount.size();
+  fPool -> ParallelFor(numPads, [this, hitArray, offset](Int_t iPad, Int_t)
+  {
+    TClonesArray *slab = fSlabs[fPadSlab[iPad]];
+    Int_t hitNum = offset + fPadHitIndex[iPad];
+    Int_t end = fPadHitBegin[iPad] + fPadHitCount[iPad];
+    for (Int_t iHit = fPadHitBegin[iPad]; iHit < end; iHit++, hitNum++) {
+      STHit *hit = (STHit *) hitArray -> UncheckedAt(hitNum);
+      hit -> SetHit((STHit *) slab -> UncheckedAt(iHit));
+      hit -> SetHitID(hitNum);
+    }
+  }, 4 * fPadChunkSize, fNumThreads);
+}
 
-      pad = &(fPadArray -> at(fPadIndex++));
+void 
+STPSAFastFit::FindHits(STPad *pad, TClonesArray *hitArray, Int_t &hitNum)
+{
+  if (fUseSinglePrecision)
+    FindPadHits<Float_t>(pad, hitArray, hitNum);
+  else
+    FindPadHits<Double_t>(pad, hitArray, hitNum);
+}
 
-      if (pad -> GetLayer() <= fLayerLowCut || pad -> GetLayer() >= fLayerHighCut )
-        continue;
-    }
+void
+STPSAFastFit::FindHitsLanes(std::vector<STPad> *padArray, const Int_t *pads, Int_t numPads, Int_t iWorker)
+{
+  if (fUseSinglePrecision)
+    FindPadHitsLanes<Float_t>(padArray, pads, numPads, iWorker);
+  else
+    FindPadHitsLanes<Double_t>(padArray, pads, numPads, iWorker);
+}
 
-    FindHits(pad, hitArray, hitNum);
+template <typename T>
+void
+STPSAFastFit::CopyADC(const Double_t *adcSource, T *adc)
+{
+  if (fNumTbs == 512)
+    std::copy(adcSource, adcSource + 512, adc);
+  else {
+    std::copy(adcSource, adcSource + fNumTbs, adc);
+    std::fill(adc + fNumTbs, adc + 512, 0);
   }
-
-#ifdef DEBUG
-  LOG(INFO) << "Thread ended!" << FairLogger::endl;
-#endif
 }
 
+template <typename T>
 void 
-STPSAFastFit::FindHits(STPad *pad, TClonesArray *hitArray, Int_t &hitNum)
+STPSAFastFit::FindPadHits(STPad *pad, TClonesArray *hitArray, Int_t &hitNum)
 {
 #ifndef DEBUG_PSA_ITERATION
   Double_t *adcSource = pad -> GetADC();
-  Double_t adc[512] = {0};
-  memcpy(&adc, adcSource, sizeof(Double_t)*fNumTbs);
-
-  // Pad information
-  Int_t row   = pad -> GetRow();
-  Int_t layer = pad -> GetLayer();
-  Double_t xPos = (row   + 0.5) * fPadSizeX - fPadPlaneX/2.;
-  Double_t zPos = (layer + 0.5) * fPadSizeZ;
 
   // Found peak information
-  Int_t tbCurrent = fWindowStartTb;
+  Int_t tbCurrent;
   Int_t tbStart;
 
+  if (PrescanPad(adcSource, tbCurrent) == kFALSE)
+    return;
+
+  T adc[512];
+  CopyADC(adcSource, adc);
+
   // Fitted hit information
   Double_t yHit;
   Double_t tbHit;
@@ -246,16 +363,8 @@ STPSAFastFit::FindHits(STPad *pad, TClonesArray *hitArray, Int_t &hitNum)
 #endif
       yHit = tbHit * fTbToYConv;
 
-      STHit *hit = (STHit *) hitArray -> ConstructedAt(hitNum);
-      hit -> Clear();
       if (amplitude > 3500) amplitude = 3500;
-      hit -> SetHit(hitNum, xPos, yHit, zPos, amplitude);
-      hit -> SetRow(row);
-      hit -> SetLayer(layer);
-      hit -> SetTb(tbHit);
-      hit -> SetChi2(squareSum);
-      hit -> SetNDF(ndf);
-      hitNum++;
+      AddHit(pad, hitArray, hitNum, tbHit, amplitude, squareSum, ndf);
 
 #ifdef DEBUG_PEAKFINDING
       LOG(INFO) 
@@ -278,8 +387,283 @@ STPSAFastFit::FindHits(STPad *pad, TClonesArray *hitArray, Int_t &hitNum)
 #endif
 }
 
+void
+STPSAFastFit::AddHit(STPad *pad, TClonesArray *hitArray, Int_t &hitNum, Double_t tbHit, Double_t amplitude, Double_t squareSum, Int_t ndf)
+{
+  Int_t row   = pad -> GetRow();
+  Int_t layer = pad -> GetLayer();
+  Double_t xPos = (row   + 0.5) * fPadSizeX - fPadPlaneX/2.;
+  Double_t yHit = tbHit * fTbToYConv;
+  Double_t zPos = (layer + 0.5) * fPadSizeZ;
+
+  STHit *hit = (STHit *) hitArray -> ConstructedAt(hitNum);
+  hit -> Clear();
+  hit -> SetHit(hitNum, xPos, yHit, zPos, amplitude);
+  hit -> SetRow(row);
+  hit -> SetLayer(layer);
+  hit -> SetTb(tbHit);
+  hit -> SetChi2(squareSum);
+  hit -> SetNDF(ndf);
+  hitNum++;
+}
+
+namespace {
+  const Int_t kMaxFitLanes = 16;
+
+  struct STPSAFitHit { Double_t tb, amplitude, chi2; Int_t ndf; };
+
+  /// Pad and pulse fit state of one lane in STPSAFastFit::FindHitsLanes()
+  template <typename T>
+  struct STPSAFitLane
+  {
+    Int_t iPad = -1; // -1 if lane has no pad
+    T *adc = nullptr;
+
+    // same as local variables of FindHits()
+    Int_t tbCurrent, tbStart, ndf;
+    Double_t tbHitPre, amplitudePre;
+    std::vector<STPSAFitHit> hits;
+
+    // same as local variables of FitPulseNewton()
+    Bool_t isFitting = kFALSE;
+    Bool_t isFirst;
+    Int_t numIteration;
+    Double_t tbTrial, dTb;
+    Double_t tbCur, lsCur, ampCur, gradCur, curvCur;
+  };
+
+  /**
+   * Plain sum in double precision. In single precision, Kahan-compensated,
+   * for the sums which largely cancel in chi2 and in the gradient.
+   */
+  template <typename T>
+  struct STPSACompensatedSum
+  {
+    T sum = 0;
+    void Add(T x) { sum += x; }
+    Double_t Get() const { return sum; }
+  };
+
+  template <>
+  struct STPSACompensatedSum<Float_t>
+  {
+    Float_t sum = 0;
+    Float_t compensation = 0;
+    void Add(Float_t x) {
+      Float_t y = x - compensation;
+      Float_t t = sum + y;
+      compensation = (t - sum) - y;
+      sum = t;
+    }
+    Double_t Get() const { return sum; }
+  };
+}
+
+template <typename T>
+void
+STPSAFastFit::FindPadHitsLanes(std::vector<STPad> *padArray, const Int_t *pads, Int_t numPads, Int_t iWorker)
+{
+  TClonesArray *slab = fSlabs[iWorker];
+  Int_t numLanes = fNumFitLanes < kMaxFitLanes ? fNumFitLanes : kMaxFitLanes;
+
+  T adcBuffer[kMaxFitLanes][512];
+  STPSAFitLane<T> lanes[kMaxFitLanes];
+  for (Int_t iLane = 0; iLane < numLanes; iLane++)
+    lanes[iLane].adc = adcBuffer[iLane];
+
+  // SoA block given to LSFitPulseLanes()
+  Int_t laneIndex[kMaxFitLanes];
+  const T *laneAdc[kMaxFitLanes];
+  Double_t laneTb[kMaxFitLanes];
+  Int_t laneNDF[kMaxFitLanes];
+  Double_t laneChi2[kMaxFitLanes];
+  Double_t laneAmp[kMaxFitLanes];
+  Double_t laneGrad[kMaxFitLanes];
+  Double_t laneCurv[kMaxFitLanes];
+
+  Int_t nextPad = 0;
+
+  auto StartPad = [&](STPSAFitLane<T> &lane, Int_t iPad)
+  {
+    CopyADC(padArray -> at(iPad).GetADC(), lane.adc);
+
+    lane.iPad = iPad;
+    lane.tbCurrent = fPadTbFirst[iPad];
+    lane.ndf = fNDFTbs;
+    lane.tbHitPre = 0;
+    lane.amplitudePre = 0;
+    lane.hits.clear();
+  };
+
+  // Write hits of the finished pad to the slab at once, so that they are contiguous.
+  auto FlushPad = [&](STPSAFitLane<T> &lane)
+  {
+    Int_t iPad = lane.iPad;
+    Int_t hitNum = slab -> GetEntriesFast();
+
+    fPadSlab[iPad] = iWorker;
+    fPadHitBegin[iPad] = hitNum;
+    for (auto &hit : lane.hits)
+      AddHit(&(padArray -> at(iPad)), slab, hitNum, hit.tb, hit.amplitude, hit.chi2, hit.ndf);
+    fPadHitCount[iPad] = hitNum - fPadHitBegin[iPad];
+
+    lane.iPad = -1;
+  };
+
+  auto NextPeak = [&](STPSAFitLane<T> &lane) -> Bool_t
+  {
+    if (!FindPeak(lane.adc, lane.tbCurrent, lane.tbStart))
+      return kFALSE;
+    if (lane.tbStart > fTbStartCut - 1)
+      return kFALSE;
+
+    if (lane.adc[lane.tbCurrent] > 3500) // if peak value is larger than 3500(mostly saturated)
+    {
+      lane.ndf = lane.tbCurrent - lane.tbStart;
+      if (lane.ndf > fNDFTbs) lane.ndf = fNDFTbs;
+    }
+
+    lane.isFitting = kTRUE;
+    lane.isFirst = kTRUE;
+    lane.numIteration = 0;
+    lane.tbTrial = lane.tbStart + 1;
+    return kTRUE;
+  };
+
+  // 0: next trial is set, 1: converged, -1: out of bound
+  auto SetTrial = [&](STPSAFitLane<T> &lane) -> Int_t
+  {
+    lane.tbTrial = lane.tbCur + lane.dTb;
+    if (lane.tbTrial < 0 || lane.tbTrial > fTbStartCut)
+      return -1;
+    return 0;
+  };
+
+  auto ProposeStep = [&](STPSAFitLane<T> &lane) -> Int_t
+  {
+    if (lane.numIteration >= fIterMax || lane.curvCur <= 0)
+      return 1;
+
+    lane.dTb = - lane.gradCur / lane.curvCur;
+    if (lane.dTb > 1) lane.dTb = 1;
+    if (lane.dTb < -1) lane.dTb = -1;
+    return SetTrial(lane);
+  };
+
+  while (1)
+  {
+    // Give every lane a peak to fit, from its own pad or from the next pad.
+    for (Int_t iLane = 0; iLane < numLanes; iLane++)
+    {
+      STPSAFitLane<T> &lane = lanes[iLane];
+      while (!lane.isFitting)
+      {
+        if (lane.iPad < 0) {
+          if (nextPad >= numPads)
+            break;
+          StartPad(lane, pads[nextPad++]);
+        }
+
+        if (!NextPeak(lane))
+          FlushPad(lane);
+      }
+    }
+
+    Int_t numFitting = 0;
+    for (Int_t iLane = 0; iLane < numLanes; iLane++) {
+      if (!lanes[iLane].isFitting)
+        continue;
+      laneIndex[numFitting] = iLane;
+      laneAdc[numFitting] = lanes[iLane].adc;
+      laneTb[numFitting] = lanes[iLane].tbTrial;
+      laneNDF[numFitting] = lanes[iLane].ndf;
+      numFitting++;
+    }
+
+    if (numFitting == 0)
+      break;
+
+    LSFitPulseLanes(numFitting, laneAdc, laneTb, laneNDF, laneChi2, laneAmp, laneGrad, laneCurv);
+
+    // Same steps as FitPulseNewton(), one evaluation at a time.
+    for (Int_t iFit = 0; iFit < numFitting; iFit++)
+    {
+      STPSAFitLane<T> &lane = lanes[laneIndex[iFit]];
+      lane.numIteration++;
+
+      Int_t status;
+      if (lane.isFirst || laneChi2[iFit] <= lane.lsCur)
+      {
+        lane.tbCur = lane.tbTrial;
+        lane.lsCur = laneChi2[iFit];
+        lane.ampCur = laneAmp[iFit];
+        lane.gradCur = laneGrad[iFit];
+        lane.curvCur = laneCurv[iFit];
+
+        if (!lane.isFirst && (abs(lane.dTb) < fNewtonTbTolerance || lane.numIteration >= fIterMax))
+          status = 1;
+        else
+          status = ProposeStep(lane);
+        lane.isFirst = kFALSE;
+      }
+      else if (abs(lane.dTb) < fNewtonTbTolerance || lane.numIteration >= fIterMax)
+        status = 1;
+      else {
+        lane.dTb = lane.dTb / 2;
+        status = SetTrial(lane);
+      }
+
+      if (status == 0)
+        continue;
+
+      lane.isFitting = kFALSE;
+      if (status < 0)
+        continue;
+
+      Double_t tbHit = lane.tbCur;
+      Double_t amplitude = lane.ampCur;
+      if (TestPulse(lane.adc, lane.tbHitPre, lane.amplitudePre, tbHit, amplitude))
+      {
+        if (amplitude > 3500) amplitude = 3500;
+        lane.hits.push_back({tbHit, amplitude, lane.lsCur, lane.ndf});
+
+        lane.tbHitPre = tbHit;
+        lane.amplitudePre = amplitude;
+
+        lane.tbCurrent = Int_t(tbHit) + 9;
+      }
+    }
+  }
+}
+
 Bool_t
-STPSAFastFit::FindPeak(Double_t *adc, 
+STPSAFastFit::PrescanPad(Double_t *adc, Int_t &tbFirst)
+{
+  Int_t tbEnd = fWindowEndTb < fNumTbs ? fWindowEndTb : fNumTbs;
+
+  // Count rising steps above threshold in one pass without branches.
+  Int_t numRising = 0;
+  for (Int_t tb = fWindowStartTb; tb < tbEnd; tb++)
+    numRising += (adc[tb] - adc[tb - 1] > fThresholdOneTbStep) & (adc[tb] > fThreshold);
+
+  // FindPeak() needs at least fNumAscending of them to find a peak.
+  if (numRising < fNumAscending || numRising == 0)
+    return kFALSE;
+
+  // Start from the rising edge which contains the first rising step above threshold.
+  // FindPeak() resets its counters on every step before that, so the result is the same.
+  tbFirst = fWindowStartTb;
+  while (!(adc[tbFirst] - adc[tbFirst - 1] > fThresholdOneTbStep && adc[tbFirst] > fThreshold))
+    tbFirst++;
+  while (tbFirst > fWindowStartTb && adc[tbFirst - 1] - adc[tbFirst - 2] > fThresholdOneTbStep)
+    tbFirst--;
+
+  return kTRUE;
+}
+
+template <typename T>
+Bool_t
+STPSAFastFit::FindPeak(T *adc, 
                           Int_t &tbCurrent, 
                           Int_t &tbStart)
 {
@@ -341,8 +725,9 @@ STPSAFastFit::FindPeak(Double_t *adc,
 }
 
 #ifdef DEBUG_PSA_ITERATION
+template <typename T>
 Bool_t
-STPSAFastFit::FitPulse(Double_t *adc, 
+STPSAFastFit::FitPulse(T *adc, 
                           Int_t tbStart,
                           Int_t tbPeak,
                        Double_t &tbHit, 
@@ -351,8 +736,9 @@ STPSAFastFit::FitPulse(Double_t *adc,
                           Int_t &ndf,
                           Int_t &option)
 #else
+template <typename T>
 Bool_t
-STPSAFastFit::FitPulse(Double_t *adc, 
+STPSAFastFit::FitPulse(T *adc, 
                           Int_t tbStart,
                           Int_t tbPeak,
                        Double_t &tbHit, 
@@ -373,6 +759,11 @@ STPSAFastFit::FitPulse(Double_t *adc,
     if (ndf > fNDFTbs) ndf = fNDFTbs;
   }
 
+#ifndef DEBUG_PSA_ITERATION
+  if (fUseNewtonFit)
+    return FitPulseNewton(adc, tbStart, ndf, tbHit, amplitude, squareSum);
+#endif
+
   Double_t alpha   = fAlpha   / (adcPeak * adcPeak); // Weight of time-bucket step
   Double_t betaCut = fBetaCut * (adcPeak * adcPeak); // Effective cut for beta
 
@@ -550,60 +941,306 @@ STPSAFastFit::FitPulse(Double_t *adc,
 }
 #endif
 
-void 
-STPSAFastFit::LSFitPulse(Double_t *buffer, Double_t tbStart, Int_t ndf, Double_t &chi2, Double_t &amplitude)
+template <typename T>
+Bool_t
+STPSAFastFit::FitPulseNewton(T *adc, 
+                                Int_t tbStart,
+                                Int_t ndf,
+                             Double_t &tbHit, 
+                             Double_t &amplitude,
+                             Double_t &squareSum)
 {
-  Double_t refy = 0;
-  Double_t ref2 = 0;
+  Double_t tbCur = tbStart + 1; // same starting point as the step search
+  Double_t lsCur, ampCur, gradCur, curvCur;
+  LSFitPulse(adc, tbCur, ndf, lsCur, ampCur, gradCur, curvCur);
 
-  for (Int_t iTbPulse = 0; iTbPulse < ndf; iTbPulse++) {
-    Int_t tb = tbStart + iTbPulse;
-    Double_t y = buffer[tb];
+  Int_t numIteration = 1;
+  while (numIteration < fIterMax && curvCur > 0)
+  {
+    Double_t dTb = - gradCur / curvCur;
+    if (dTb > 1) dTb = 1;
+    if (dTb < -1) dTb = -1;
 
-    Double_t ref = Pulse(tb + 0.5, 1, tbStart);
-    refy += ref * y;
-    ref2 += ref * ref;
-#ifdef DEBUG_FIT
-    LOG(INFO) << "LSFit-" << iTbPulse
-              << " tbStart:" << tbStart
-              << " y:" << y 
-              << " ref:" << ref 
-              << " refy:" << refy 
-              << " ref2:" << ref2 << FairLogger::endl;
+    // The pulse is linear between data points, so the Newton step can overshoot
+    // across a kink. Halve the step until least-squares does not increase.
+    Double_t tbNext, lsNext, ampNext, gradNext, curvNext;
+    while (1)
+    {
+      tbNext = tbCur + dTb;
+      if (tbNext < 0 || tbNext > fTbStartCut)
+      {
+#if defined(DEBUG_WHERE) || defined(DEBUG_PSA_ITERATION)
+        LOG(INFO) << " Out of bound while fitting" << FairLogger::endl;
 #endif
+        return kFALSE;
+      }
+
+      LSFitPulse(adc, tbNext, ndf, lsNext, ampNext, gradNext, curvNext);
+      numIteration++;
+
+      if (lsNext <= lsCur || abs(dTb) < fNewtonTbTolerance || numIteration >= fIterMax)
+        break;
+
+      dTb = dTb / 2;
+    }
+
+    if (lsNext > lsCur)
+      break;
+
+    tbCur = tbNext;
+    lsCur = lsNext;
+    ampCur = ampNext;
+    gradCur = gradNext;
+    curvCur = curvNext;
+
+    if (abs(dTb) < fNewtonTbTolerance)
+      break;
   }
 
+  tbHit = tbCur;
+  amplitude = ampCur;
+  squareSum = lsCur;
+
+#ifdef DEBUG_WHERE
+  LOG(INFO) << " Pulse is fitted! (" << numIteration << " evaluations)" << FairLogger::endl;
+#endif
+
+  return kTRUE;
+}
+
+template <typename T>
+void 
+STPSAFastFit::LSFitPulse(T *buffer, Double_t tbStart, Int_t ndf, Double_t &chi2, Double_t &amplitude)
+{
+  Double_t gradient, curvature;
+  LSFitPulse(buffer, tbStart, ndf, chi2, amplitude, gradient, curvature);
+}
+
+template <typename T>
+void 
+STPSAFastFit::LSFitPulse(T *buffer, Double_t tbStart, Int_t ndf, Double_t &chi2, Double_t &amplitude, Double_t &gradient, Double_t &curvature)
+{
+  // ndf of the pulser data in use (117 ns: 8, 232 ns: 12), others are fitted by the generic kernel.
+  switch (ndf) {
+    case 8:  LSFitPulseKernel<T, 8>(buffer, tbStart, ndf, chi2, amplitude, gradient, curvature); break;
+    case 12: LSFitPulseKernel<T, 12>(buffer, tbStart, ndf, chi2, amplitude, gradient, curvature); break;
+    default: LSFitPulseKernel<T, 0>(buffer, tbStart, ndf, chi2, amplitude, gradient, curvature);
+  }
+}
+
+template <typename T, Int_t NDF>
+void 
+STPSAFastFit::LSFitPulseKernel(T *buffer, Double_t tbStart, Int_t ndf, Double_t &chi2, Double_t &amplitude, Double_t &gradient, Double_t &curvature)
+{
+  const Int_t numBatch = NDF > 0 ? NDF : 32;
+  const Int_t numSamples = NDF > 0 ? NDF : ndf;
+  T ref[numBatch];  // pulse of unit amplitude
+  T dref[numBatch]; // d(ref)/d(tbStart)
+
+  Int_t tbFirst = tbStart;
+  T tbOffset = tbFirst + 0.5 - tbStart;
+
+  STPSACompensatedSum<T> yySum;
+  STPSACompensatedSum<T> refySum;
+  STPSACompensatedSum<T> drefySum;
+  T ref2Sum = 0;
+  T refdrefSum = 0;
+  T dref2Sum = 0;
+
+  for (Int_t iFirst = 0; iFirst < numSamples; iFirst += numBatch)
+  {
+    Int_t n = numSamples - iFirst < numBatch ? numSamples - iFirst : numBatch;
+    if (NDF > 0)
+      PulseBatch<numBatch>(tbOffset, ref, dref);
+    else
+      PulseBatch(tbOffset + iFirst, n, ref, dref);
+
+    const T *y = buffer + tbFirst + iFirst;
+    for (Int_t k = 0; k < n; k++) {
+      yySum.Add(y[k] * y[k]);
+      refySum.Add(ref[k] * y[k]);
+      drefySum.Add(dref[k] * y[k]);
+      ref2Sum    += ref[k] * ref[k];
+      refdrefSum += ref[k] * dref[k];
+      dref2Sum   += dref[k] * dref[k];
+    }
+  }
+
+  Double_t yy = yySum.Get();
+  Double_t refy = refySum.Get();
+  Double_t drefy = drefySum.Get();
+  Double_t ref2 = ref2Sum;
+  Double_t refdref = refdrefSum;
+  Double_t dref2 = dref2Sum;
+
   if (ref2 == 0)
   {
     chi2 = 1.e10;
+    amplitude = 0;
+    gradient = 0;
+    curvature = 0;
     return;
   }
 
+  // With amplitude = refy/ref2,
+  //   chi2      = sum (y - amplitude*ref)^2 = yy - refy*refy/ref2
+  //   gradient  = d(chi2)/d(tbStart)         = -2*amplitude*(drefy - amplitude*refdref)
+  //   curvature = Gauss-Newton d2(chi2)/d(tbStart)2 with amplitude profiled out
   amplitude = refy / ref2;
+  chi2 = yy - amplitude * refy;
+  if (chi2 < 0)
+    chi2 = 0;
+  gradient = -2 * amplitude * (drefy - amplitude * refdref);
+  curvature = 2 * amplitude * amplitude * (dref2 - refdref * refdref / ref2);
 
-  chi2 = 0;
-  for (Int_t iTbPulse = 0; iTbPulse < ndf; iTbPulse++) {
-    Int_t tb = tbStart + iTbPulse;
-    Double_t val = buffer[tb];
-    Double_t ref = Pulse(tb + 0.5, amplitude, tbStart);
-    chi2 += (val - ref) * (val - ref);
-#ifdef DEBUG_FIT
-    LOG(INFO) << " tbStart:" << tbStart
-              << " tb:" << tb 
-              << " val:" << val 
-              << " ref:" << ref 
-              << " diff:" << val - ref << FairLogger::endl;
-#endif
-  }
 #ifdef DEBUG_FIT
   LOG(INFO) << "==> tbStart:" << tbStart
             << " chi2:" << chi2 
-            << " amp:" << amplitude << FairLogger::endl;
+            << " amp:" << amplitude
+            << " gradient:" << gradient << FairLogger::endl;
 #endif
 }
 
+template <typename T>
+void 
+STPSAFastFit::LSFitPulseLanes(Int_t numLanes, const T **buffer, const Double_t *tbStart, const Int_t *ndf,
+                              Double_t *chi2, Double_t *amplitude, Double_t *gradient, Double_t *curvature)
+{
+  Bool_t isSameNDF = kTRUE;
+  for (Int_t iLane = 1; iLane < numLanes; iLane++)
+    if (ndf[iLane] != ndf[0])
+      isSameNDF = kFALSE;
+
+  if (isSameNDF && ndf[0] == 8)
+    LSFitPulseLanesKernel<T, 8>(numLanes, buffer, tbStart, ndf, chi2, amplitude, gradient, curvature);
+  else if (isSameNDF && ndf[0] == 12)
+    LSFitPulseLanesKernel<T, 12>(numLanes, buffer, tbStart, ndf, chi2, amplitude, gradient, curvature);
+  else
+    LSFitPulseLanesKernel<T, 0>(numLanes, buffer, tbStart, ndf, chi2, amplitude, gradient, curvature);
+}
+
+template <typename T, Int_t NDF>
+void 
+STPSAFastFit::LSFitPulseLanesKernel(Int_t numLanes, const T **buffer, const Double_t *tbStart, const Int_t *ndf,
+                                    Double_t *chi2, Double_t *amplitude, Double_t *gradient, Double_t *curvature)
+{
+  Int_t tbFirst[kMaxFitLanes];
+  T tbOffset[kMaxFitLanes];
+
+  STPSACompensatedSum<T> yy[kMaxFitLanes];
+  STPSACompensatedSum<T> refy[kMaxFitLanes];
+  STPSACompensatedSum<T> drefy[kMaxFitLanes];
+  T ref2[kMaxFitLanes];
+  T refdref[kMaxFitLanes];
+  T dref2[kMaxFitLanes];
+
+  Int_t maxNDF = NDF;
+  for (Int_t iLane = 0; iLane < numLanes; iLane++) {
+    tbFirst[iLane] = tbStart[iLane];
+    tbOffset[iLane] = tbFirst[iLane] + 0.5 - tbStart[iLane];
+    ref2[iLane] = refdref[iLane] = dref2[iLane] = 0;
+    if (NDF == 0 && ndf[iLane] > maxNDF)
+      maxNDF = ndf[iLane];
+  }
+
+  T tbSample[kMaxFitLanes];
+  T ref[kMaxFitLanes];
+  T dref[kMaxFitLanes];
+
+  // Sample by sample over all lanes. Samples beyond ndf of the lane are masked to 0,
+  // so each lane has the same sums, in the same order, as LSFitPulse().
+  // With NDF > 0, all lanes have ndf = NDF and nothing is masked.
+  for (Int_t iTbPulse = 0; iTbPulse < maxNDF; iTbPulse++)
+  {
+    for (Int_t iLane = 0; iLane < numLanes; iLane++)
+      tbSample[iLane] = tbOffset[iLane] + iTbPulse;
+
+    PulseLanes(tbSample, numLanes, ref, dref);
+
+    for (Int_t iLane = 0; iLane < numLanes; iLane++) {
+      T mask = (NDF > 0 || iTbPulse < ndf[iLane]) ? 1 : 0;
+      T y = mask * buffer[iLane][tbFirst[iLane] + iTbPulse];
+      T r = mask * ref[iLane];
+      T dr = mask * dref[iLane];
+
+      yy[iLane].Add(y * y);
+      refy[iLane].Add(r * y);
+      drefy[iLane].Add(dr * y);
+      ref2[iLane]    += r * r;
+      refdref[iLane] += r * dr;
+      dref2[iLane]   += dr * dr;
+    }
+  }
+
+  for (Int_t iLane = 0; iLane < numLanes; iLane++)
+  {
+    Double_t yyLane = yy[iLane].Get();
+    Double_t refyLane = refy[iLane].Get();
+    Double_t drefyLane = drefy[iLane].Get();
+    Double_t ref2Lane = ref2[iLane];
+    Double_t refdrefLane = refdref[iLane];
+    Double_t dref2Lane = dref2[iLane];
+
+    if (ref2Lane == 0)
+    {
+      chi2[iLane] = 1.e10;
+      amplitude[iLane] = 0;
+      gradient[iLane] = 0;
+      curvature[iLane] = 0;
+      continue;
+    }
+
+    Double_t amp = refyLane / ref2Lane;
+    amplitude[iLane] = amp;
+    chi2[iLane] = yyLane - amp * refyLane;
+    if (chi2[iLane] < 0)
+      chi2[iLane] = 0;
+    gradient[iLane] = -2 * amp * (drefyLane - amp * refdrefLane);
+    curvature[iLane] = 2 * amp * amp * (dref2Lane - refdrefLane * refdrefLane / ref2Lane);
+  }
+}
+
+template <typename T>
+void
+STPSAFastFit::SubtractPulse(T *adc, Int_t tbFirst, Int_t numTbs, Double_t amplitude, Double_t tbHit)
+{
+  // Pulse is 0 before tbHit, so nothing is lost by starting from 0.
+  if (tbFirst < 0) {
+    numTbs += tbFirst;
+    tbFirst = 0;
+  }
+
+  // fNumTbsCorrection + 1 unless the pulse is at the end of the time-buckets
+  if (numTbs == 51)
+    SubtractPulseKernel<T, 51>(adc, tbFirst, numTbs, amplitude, tbHit);
+  else
+    SubtractPulseKernel<T, 0>(adc, tbFirst, numTbs, amplitude, tbHit);
+}
+
+template <typename T, Int_t N>
+void
+STPSAFastFit::SubtractPulseKernel(T *adc, Int_t tbFirst, Int_t numTbs, Double_t amplitude, Double_t tbHit)
+{
+  T pulse[N > 0 ? N : 512];
+  T dpulse[N > 0 ? N : 512];
+
+  // Same as adc[tb] -= Pulse(tb, amplitude, tbHit) for each tb, from the table of PulseBatch().
+  T tbOffset = tbFirst - tbHit;
+  if (N > 0)
+    PulseBatch<(N > 0 ? N : 1)>(tbOffset, pulse, dpulse);
+  else
+    PulseBatch(tbOffset, numTbs, pulse, dpulse);
+
+  const Int_t n = N > 0 ? N : numTbs;
+  const T amp = amplitude;
+  T *y = adc + tbFirst;
+  for (Int_t k = 0; k < n; k++)
+    y[k] -= amp * pulse[k];
+}
+
+template <typename T>
 Bool_t
-STPSAFastFit::TestPulse(Double_t *adc, 
+STPSAFastFit::TestPulse(T *adc, 
                         Double_t tbHitPre,
                         Double_t amplitudePre, 
                         Double_t tbHit, 
@@ -638,18 +1275,12 @@ STPSAFastFit::TestPulse(Double_t *adc,
       << Pulse(tbHit + 9, amplitudePre, tbHitPre) / 2.5 << FairLogger::endl;
 #endif
 
-    for (Int_t iTbPulse = -1; iTbPulse < numTbsCorrection; iTbPulse++) {
-      Int_t tb = Int_t(tbHit) + iTbPulse;
-      adc[tb] -= Pulse(tb, amplitude, tbHit);
-    }
+    SubtractPulse(adc, Int_t(tbHit) - 1, numTbsCorrection + 1, amplitude, tbHit);
 
     return kFALSE;
   }
 
-  for (Int_t iTbPulse = -1; iTbPulse < numTbsCorrection; iTbPulse++) {
-    Int_t tb = Int_t(tbHit) + iTbPulse;
-    adc[tb] -= Pulse(tb, amplitude, tbHit);
-  }
+  SubtractPulse(adc, Int_t(tbHit) - 1, numTbsCorrection + 1, amplitude, tbHit);
 
 #ifdef DEBUG_WHERE
     LOG(INFO) << " Fit is valid!" << FairLogger::endl;
@@ -657,3 +1288,23 @@ STPSAFastFit::TestPulse(Double_t *adc,
 
   return kTRUE;
 }
+
+// Kernels of both precisions, so that they can be called from outside with double or float adc.
+#define STPSAFASTFIT_INSTANTIATE(T) \
+  template Bool_t STPSAFastFit::FindPeak<T>(T *, Int_t &, Int_t &); \
+  template Bool_t STPSAFastFit::FitPulseNewton<T>(T *, Int_t, Int_t, Double_t &, Double_t &, Double_t &); \
+  template void STPSAFastFit::LSFitPulse<T>(T *, Double_t, Int_t, Double_t &, Double_t &); \
+  template void STPSAFastFit::LSFitPulse<T>(T *, Double_t, Int_t, Double_t &, Double_t &, Double_t &, Double_t &); \
+  template void STPSAFastFit::LSFitPulseLanes<T>(Int_t, const T **, const Double_t *, const Int_t *, Double_t *, Double_t *, Double_t *, Double_t *); \
+  template Bool_t STPSAFastFit::TestPulse<T>(T *, Double_t, Double_t, Double_t, Double_t);
+
+STPSAFASTFIT_INSTANTIATE(Double_t)
+STPSAFASTFIT_INSTANTIATE(Float_t)
+
+#ifdef DEBUG_PSA_ITERATION
+template Bool_t STPSAFastFit::FitPulse<Double_t>(Double_t *, Int_t, Int_t, Double_t &, Double_t &, Double_t &, Int_t &, Int_t &);
+template Bool_t STPSAFastFit::FitPulse<Float_t>(Float_t *, Int_t, Int_t, Double_t &, Double_t &, Double_t &, Int_t &, Int_t &);
+#else
+template Bool_t STPSAFastFit::FitPulse<Double_t>(Double_t *, Int_t, Int_t, Double_t &, Double_t &, Double_t &, Int_t &);
+template Bool_t STPSAFastFit::FitPulse<Float_t>(Float_t *, Int_t, Int_t, Double_t &, Double_t &, Double_t &, Int_t &);
+#endif
@@ -10,14 +10,14 @@
 #include "STPSA.hh"
 #include "STPulse.hh"
 #include "STGlobal.hh"
+#include "STThreadPool.hh"
 
 // ROOT classes
 #include "TSpectrum.h"
 #include "TClonesArray.h"
 
 // STL
-#include <mutex>
-#include <condition_variable>
+#include <vector>
 
 class STPSAFastFit : public STPSA, public STPulse
 {
@@ -25,12 +25,61 @@ class STPSAFastFit : public STPSA, public STPulse
     STPSAFastFit();
     STPSAFastFit(TString pulseData);
     STPSAFastFit(Int_t shapingTime);
+    ~STPSAFastFit();
 
     void Init();
 
     void Analyze(STRawEvent *rawEvent, STEvent *event);
     void Analyze(STRawEvent *rawEvent, TClonesArray *hitArray);
-    void PadAnalyzer(TClonesArray *hitArray);
+
+    /// Maximum number of threads used for one event (0 for all threads of STThreadPool::Instance()).
+    void SetNumThreads(Int_t numThreads);
+
+    /**
+     * Fit tbStart with Gauss-Newton steps (FitPulseNewton()) instead of the
+     * heuristic step search of FitPulse(). Default is true.
+     */
+    void SetUseNewtonFit(Bool_t val = kTRUE);
+
+    /**
+     * Number of pulses fitted together by FindHitsLanes() (at most 16).
+     * 0 or 1 to fit pads one by one with FindHits(). Default is 8.
+     * Only used with the Newton fit.
+     */
+    void SetNumFitLanes(Int_t numLanes);
+
+    /**
+     * Run the peak finding and the fit on float copies of the adc, with float
+     * pulse tables (STPulse::PulseBatch()) and float least-squares sums.
+     * Sums with large cancellation (y*y, ref*y, dref*y) are Kahan-compensated.
+     * Fitted parameters are kept in double. Default is false.
+     */
+    void SetUseSinglePrecision(Bool_t val = kTRUE);
+
+    /**
+     * With single precision, also run the double precision path on every
+     * event and compare the hits pad by pad (see PrintPrecisionValidation()).
+     * Hits of the single precision path are given as output. For validation
+     * only, since each event is analyzed twice.
+     */
+    void SetValidatePrecision(Bool_t val = kTRUE);
+
+    /** Print differences between the single and double precision hits accumulated so far. */
+    void PrintPrecisionValidation();
+
+    /**
+     * Run FindHits() over all pads of the event on the thread pool.
+     *
+     * Pads are handed out in chunks of fPadChunkSize through an atomic counter
+     * (no lock). Each worker writes hits into its own slab, and the hit range
+     * of each pad is recorded, so that the hits can be put together in pad
+     * order afterwards regardless of which worker took which pad.
+     * With fit lanes (SetNumFitLanes()), quiet pads are dropped by
+     * PrescanPad() first and the others are given to FindHitsLanes()
+     * in blocks.
+     * Returns the total number of hits.
+     */
+    Int_t PadAnalyzer(STRawEvent *rawEvent);
 
     /** 
      * Find hits from the pad, pass hits to hitArray
@@ -42,48 +91,151 @@ class STPSAFastFit : public STPSA, public STPulse
      */
     void FindHits(STPad *pad, TClonesArray *hitArray, Int_t &hitNum);
 
+    /**
+     * Same as FindHits() for numPads pads, but the pulses of up to
+     * fNumFitLanes pads are fitted in lockstep. Each lane follows its own
+     * pad through FindPeak(), FitPulseNewton() steps and TestPulse(); the
+     * least-squares of all lanes are evaluated together by LSFitPulseLanes().
+     * When a lane finishes its pad, the hits are written to the slab of
+     * iWorker and the lane takes the next pad. Hits are the same as FindHits().
+     */
+    void FindHitsLanes(std::vector<STPad> *padArray, const Int_t *pads, Int_t numPads, Int_t iWorker);
+
+    /** Create hit in hitArray at hitNum and increase hitNum */
+    void AddHit(STPad *pad, TClonesArray *hitArray, Int_t &hitNum,
+                Double_t tbHit, Double_t amplitude, Double_t squareSum, Int_t ndf);
+
+    /**
+     * Quick pass over adc of the pad before FindHits() copies it.
+     * Counts rising steps above threshold in a loop without branches, and
+     * returns false if there are fewer than FindPeak() needs for one peak
+     * (quiet pad). Otherwise tbFirst is set to the start of the first
+     * rising edge, where FindPeak() can start instead of fWindowStartTb.
+     */
+    Bool_t PrescanPad(Double_t *adc, Int_t &tbFirst);
+
     /**
      * Find the first peak from adc time-bucket starting from input tbCurrent
      * tbCurrent and tbStart becomes time-bucket of the peak and starting point
      */
-    Bool_t FindPeak(Double_t *adc, Int_t &tbCurrent, Int_t &tbStart);
+    template <typename T>
+    Bool_t FindPeak(T *adc, Int_t &tbCurrent, Int_t &tbStart);
 
     /**
      * Perform least square fitting with the the pulse around tbStart ~ tbPeak.
      * This process is Iteration based process using method LSFitPuse();
      */
 #ifdef DEBUG_PSA_ITERATION
-    Bool_t FitPulse(Double_t *adc, Int_t tbStart, Int_t tbPeak,
+    template <typename T>
+    Bool_t FitPulse(T *adc, Int_t tbStart, Int_t tbPeak,
                     Double_t &tbHit, Double_t &amplitude, 
                     Double_t &squareSum, Int_t &ndf, Int_t &option);
 #else
-    Bool_t FitPulse(Double_t *adc, Int_t tbStart, Int_t tbPeak,
+    template <typename T>
+    Bool_t FitPulse(T *adc, Int_t tbStart, Int_t tbPeak,
                     Double_t &tbHit, Double_t &amplitude, 
                     Double_t &squareSum, Int_t &ndf);
 #endif
 
+    /**
+     * Fit tbStart with Gauss-Newton steps, using the analytic gradient and
+     * curvature of least-squares from LSFitPulse(). Amplitude is solved in
+     * closed form for each tbStart. A step which does not decrease
+     * least-squares is halved. Stops when the step is below
+     * fNewtonTbTolerance or after fIterMax evaluations.
+     */
+    template <typename T>
+    Bool_t FitPulseNewton(T *adc, Int_t tbStart, Int_t ndf,
+                          Double_t &tbHit, Double_t &amplitude, Double_t &squareSum);
+
     /**
      * Perform least square fitting with the fixed parameter tbStart and ndf.
      * This process is analytic. The amplitude is choosen imidiatly.
      */
-    void LSFitPulse(Double_t *buffer, Double_t tbStart, 
+    template <typename T>
+    void LSFitPulse(T *buffer, Double_t tbStart, 
                     Int_t ndf, Double_t &chi2, Double_t &amplitude);
 
+    /**
+     * Same as above, but also gives the first derivative (gradient) and the
+     * Gauss-Newton second derivative (curvature) of chi2 with respect to
+     * tbStart, amplitude kept at its best value. The pulse samples and their
+     * derivatives are taken with STPulse::PulseBatch(), and all sums are
+     * accumulated in one sweep over the samples.
+     * Sums are in the precision of buffer (see SetUseSinglePrecision()).
+     */
+    template <typename T>
+    void LSFitPulse(T *buffer, Double_t tbStart, Int_t ndf,
+                    Double_t &chi2, Double_t &amplitude, Double_t &gradient, Double_t &curvature);
+
+    /**
+     * LSFitPulse() of numLanes independent pulses, in structure-of-arrays
+     * form. Loops run over the lanes for each sample, so that the compiler
+     * can vectorize across lanes. Results are the same as LSFitPulse().
+     */
+    template <typename T>
+    void LSFitPulseLanes(Int_t numLanes, const T **buffer, const Double_t *tbStart, const Int_t *ndf,
+                         Double_t *chi2, Double_t *amplitude, Double_t *gradient, Double_t *curvature);
+
     /**
      * Test pulse with previous pulse and currently found pulse.
      * Returns true is current pulse is distinguished to be real pulse
      */
-    Bool_t TestPulse(Double_t *adc, Double_t tbHitPre, Double_t amplitudePre, 
+    template <typename T>
+    Bool_t TestPulse(T *adc, Double_t tbHitPre, Double_t amplitudePre, 
                      Double_t tbHit, Double_t amplitude);
 
   private:
-    TClonesArray **fThreadHitArray; ///< TClonesArray object for thread
+    /// Body of PadAnalyzer() with adc buffers of type T
+    template <typename T> void AnalyzePads(STRawEvent *rawEvent);
+    /// FindHits() with adc buffer of type T
+    template <typename T> void FindPadHits(STPad *pad, TClonesArray *hitArray, Int_t &hitNum);
+    /// FindHitsLanes() with adc buffers of type T
+    template <typename T> void FindPadHitsLanes(std::vector<STPad> *padArray, const Int_t *pads, Int_t numPads, Int_t iWorker);
 
-    Int_t fPadIndex;
-    Int_t fNumPads;
-    std::vector<STPad> *fPadArray;
+    /**
+     * Kernels with trip counts fixed at compile time, so that the loops can be
+     * unrolled and vectorized. NDF (N) = 0 is the generic kernel for any ndf (n).
+     * LSFitPulse(), LSFitPulseLanes() and TestPulse() choose the kernel at run
+     * time; ndf 8 and 12 (117 ns and 232 ns pulser data) and the full
+     * subtraction range of fNumTbsCorrection + 1 have their own kernel.
+     */
+    template <typename T, Int_t NDF>
+    void LSFitPulseKernel(T *buffer, Double_t tbStart, Int_t ndf,
+                          Double_t &chi2, Double_t &amplitude, Double_t &gradient, Double_t &curvature);
+    template <typename T, Int_t NDF>
+    void LSFitPulseLanesKernel(Int_t numLanes, const T **buffer, const Double_t *tbStart, const Int_t *ndf,
+                               Double_t *chi2, Double_t *amplitude, Double_t *gradient, Double_t *curvature);
+    template <typename T, Int_t N>
+    void SubtractPulseKernel(T *adc, Int_t tbFirst, Int_t numTbs, Double_t amplitude, Double_t tbHit);
 
-    std::mutex fMutex;
+    /// Subtract pulse of (amplitude, tbHit) from adc[tbFirst, tbFirst + numTbs)
+    template <typename T>
+    void SubtractPulse(T *adc, Int_t tbFirst, Int_t numTbs, Double_t amplitude, Double_t tbHit);
+
+    /// Copy adc of the pad into a buffer of 512 time-buckets, zero after fNumTbs
+    template <typename T>
+    void CopyADC(const Double_t *adcSource, T *adc);
+
+    /// Keep tb and charge of the hits of each pad from the double precision path
+    void SetPrecisionReference();
+    /// Compare hits of each pad with the ones kept by SetPrecisionReference()
+    void ComparePrecisionReference();
+
+    STThreadPool *fPool = nullptr; //!
+    Int_t fNumThreads = 0;
+    Int_t fPadChunkSize = 8;
+
+    std::vector<TClonesArray *> fSlabs; //! hit slab of each worker, recycled every event
+
+    std::vector<Int_t> fPadSlab;     //! slab index of each pad
+    std::vector<Int_t> fPadHitBegin; //! first hit of each pad in its slab
+    std::vector<Int_t> fPadHitCount; //! number of hits of each pad
+    std::vector<Int_t> fPadHitIndex; //! index of first hit of each pad in output
+    std::vector<Int_t> fPadTbFirst;  //! start of peak search of each pad, -1 for quiet pads
+    std::vector<Int_t> fActivePads;  //! pads which are not quiet
+
+    Int_t fNumFitLanes = 8;
 
     Int_t fTbStartCut;
 
@@ -131,7 +283,28 @@ class STPSAFastFit : public STPSA, public STPulse
      */
     Double_t fBetaCut = 1.e-3; 
 
-  ClassDef(STPSAFastFit, 2)
+    /** Use FitPulseNewton() instead of the step search */
+    Bool_t fUseNewtonFit = kTRUE;
+
+    /** FitPulseNewton() stops when the step of tbStart is smaller than this */
+    Double_t fNewtonTbTolerance = 0.01;
+
+    Bool_t fUseSinglePrecision = kFALSE;
+    Bool_t fValidatePrecision = kFALSE;
+
+    std::vector<Int_t> fRefHitBegin;  //! first hit of each pad in fRefTb and fRefCharge
+    std::vector<Int_t> fRefHitCount;  //! number of hits of each pad from double path
+    std::vector<Double_t> fRefTb;     //! tb of hits from double path
+    std::vector<Double_t> fRefCharge; //! charge of hits from double path
+
+    Long64_t fNumValidatedPads = 0;   //! pads compared
+    Long64_t fNumMismatchedPads = 0;  //! pads with different number of hits
+    Long64_t fNumValidatedHits = 0;   //! hits compared in pads with the same number of hits
+    Double_t fMaxDiffTb = 0;          //! maximum |tb(float) - tb(double)|
+    Double_t fSumDiffTb2 = 0;         //! sum of (tb(float) - tb(double))^2
+    Double_t fMaxRelDiffCharge = 0;   //! maximum |charge(float) - charge(double)|/charge(double)
+
+  ClassDef(STPSAFastFit, 6)
 };
 
 #endif
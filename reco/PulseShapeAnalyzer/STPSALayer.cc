@@ -16,14 +16,16 @@
 // STL
 #include <cmath>
 #include <cstdlib>
-
-// ROOT
-#include "RVersion.h"
+#include <algorithm>
 
 //#define DEBUG
 
 ClassImp(STPSALayer)
 
+// Limits of FindPeaks(): time buckets of STPad, and local maxima kept before sorting
+static const Int_t kMaxPeakTbs = 512;
+static const Int_t kMaxPeakCandidates = 256;
+
 STPSALayer::STPSALayer()
 {
 
@@ -31,8 +33,6 @@ STPSALayer::STPSALayer()
   fLogger -> Info(MESSAGE_ORIGIN, "Start Initializing!");
 #endif
 
-  fPeakFinder = new TSpectrum();
-
   fNumFiredPads = 0;
   fArrayIdx = 0;
 
@@ -44,25 +44,20 @@ STPSALayer::STPSALayer()
   fNumSidePads = 4;
   fNumSideTbs = 4;
   fPeakStorageSize = 50;
+  fPeakThresholdRatio = 0.05;
+  fPeakMinDistance = 5;
 
   fMinPoints = 4;
   fPercPeakMin = 10;
   fPercPeakMax = 90;
 
-  fPadIdxArray = new Int_t[fPadLayers*fPadRows];
-  fNumPeaks = new Int_t*[fPadRows];
-  fPeaks = new STPeak**[fPadRows];
-  for (Int_t iRow = 0; iRow < fPadRows; iRow++) {
-    fNumPeaks[iRow] = new Int_t[fPadLayers];
-    fPeaks[iRow] = new STPeak*[fPadLayers];
-    for (Int_t iLayer = 0; iLayer < fPadLayers; iLayer++) {
-      fPadIdxArray[iLayer*fPadRows + iRow] = -1;
-      fNumPeaks[iRow][iLayer] = 0;
-      fPeaks[iRow][iLayer] = new STPeak[fPeakStorageSize];
-      for (Int_t iPeak = 0; iPeak < fPeakStorageSize; iPeak++)
-        fPeaks[iRow][iLayer][iPeak].Reset();
-    }
-  }
+  fPadIdxArray.assign(fPadLayers*fPadRows, -1);
+  fNumPeaks.assign(fPadLayers*fPadRows, 0);
+  fPeaks.resize(fPadLayers*fPadRows*fPeakStorageSize);
+  fFiredArrayIdx.reserve(fPadLayers*fPadRows);
+
+  if (fNumTbs > kMaxPeakTbs)
+    fLogger -> Warning(MESSAGE_ORIGIN, Form("Number of time buckets %d is more than %d. Peaks are searched only in the first %d time buckets!", fNumTbs, kMaxPeakTbs, kMaxPeakTbs));
 
 #ifdef DEBUG
   fLogger -> Info(MESSAGE_ORIGIN, "Initialize completed!");
@@ -90,97 +85,81 @@ STPSALayer::Analyze(STRawEvent *rawEvent, STEvent *event)
 
   Int_t padIdxCheck = GetUnusedPadIdx(); 
   if (padIdxCheck == -1) return;
-  STPad pad = fPadArray -> at(padIdxCheck);
+  STPad *pad = &(fPadArray -> at(padIdxCheck));
   Int_t totalPads = fNumFiredPads;
 
 #ifndef DEBUG
   STProcessManager manager("STPSALayer", totalPads);
 #endif
 
-  whileStart:
   while (fNumFiredPads) {
 
+    Int_t row = pad -> GetRow();
+    Int_t layer = pad -> GetLayer();
+
 #ifdef DEBUG
-    fLogger -> Info(MESSAGE_ORIGIN, Form("Start with pad row: %d, layer: %d, numPeaks: %d, rest pads: %d", pad.GetRow(), pad.GetLayer(), fNumPeaks[pad.GetRow()][pad.GetLayer()], fNumFiredPads));
+    fLogger -> Info(MESSAGE_ORIGIN, Form("Start with pad row: %d, layer: %d, numPeaks: %d, rest pads: %d", row, layer, fNumPeaks[GetArrayIdx(row, layer)], fNumFiredPads));
 #endif
 
-    Int_t row = pad.GetRow();
-    Int_t layer = pad.GetLayer();
-
-    Int_t numPeaks = fNumPeaks[row][layer];
+    Int_t numPeaks = fNumPeaks[GetArrayIdx(row, layer)];
     if (!numPeaks) {
 
 #ifdef DEBUG
-      fLogger -> Info(MESSAGE_ORIGIN, Form("No peak in pad row: %d, layer: %d!", pad.GetRow(), pad.GetLayer()));
+      fLogger -> Info(MESSAGE_ORIGIN, Form("No peak in pad row: %d, layer: %d!", row, layer));
 #endif
 
       Int_t padIdx = GetUnusedPadIdx();
       if (padIdx == -1) break;
-      else pad = fPadArray -> at(padIdx);
+      pad = &(fPadArray -> at(padIdx));
 
-      goto whileStart;
+      continue;
     }
 
-    Int_t peakTb = fPeaks[row][layer][0].tb;
-    Double_t peakValue = fPeaks[row][layer][0].value;
-
-    if (fIgnoreLeft) {
-      Int_t iPeak = 0;
-      while (1) { 
-        peakTb = fPeaks[row][layer][iPeak].tb;
-        peakValue = fPeaks[row][layer][iPeak].value;
-
-        if (TMath::Abs(fPrevLeftPeak.tb - peakTb) < fNumSideTbs && peakValue >= fPrevLeftPeak.value)
+    STPeak *peaks = GetPeaks(row, layer);
+    Int_t peakTb = peaks[0].tb;
+    Double_t peakValue = peaks[0].value;
+
+    // Coming from the side pad, take the peak which made us move here.
+    if (fIgnoreLeft || fIgnoreRight) {
+      STPeak &prevPeak = (fIgnoreLeft ? fPrevLeftPeak : fPrevRightPeak);
+      for (Int_t iPeak = 0; iPeak < numPeaks; iPeak++) {
+        if (TMath::Abs(prevPeak.tb - peaks[iPeak].tb) < fNumSideTbs && peaks[iPeak].value >= prevPeak.value) {
+          peakTb = peaks[iPeak].tb;
+          peakValue = peaks[iPeak].value;
           break;
-        else {
-          iPeak++;
-          continue;
-        }
-      }
-    } else if (fIgnoreRight) {
-      Int_t iPeak = 0;
-      while (1) { 
-        peakTb = fPeaks[row][layer][iPeak].tb;
-        peakValue = fPeaks[row][layer][iPeak].value;
-
-        if (TMath::Abs(fPrevRightPeak.tb - peakTb) < fNumSideTbs && peakValue >= fPrevRightPeak.value)
-          break;
-        else {
-          iPeak++;
-          continue;
         }
       }
     }
 
+    // Move to the side pad if it has higher peak near peakTb.
+    Bool_t isMoved = kFALSE;
+
     if (!(row == 0)) {
 
 #ifdef DEBUG
       fLogger -> Info(MESSAGE_ORIGIN, Form("Checking left pad row: %d, layer: %d!", row - 1, layer));
 #endif
 
-      Int_t leftNumPeaks = fNumPeaks[row - 1][layer];
-      if (leftNumPeaks) {
-        for (Int_t iPeak = 0; iPeak < leftNumPeaks; iPeak++) {
-          Int_t leftPeakTb = fPeaks[row - 1][layer][iPeak].tb;
-          Double_t leftPeakValue = fPeaks[row - 1][layer][iPeak].value;
-
-          if (TMath::Abs(leftPeakTb - peakTb) < fNumSideTbs && peakValue < leftPeakValue) {
+      Int_t leftIdx = GetArrayIdx(row - 1, layer);
+      STPeak *leftPeaks = GetPeaks(row - 1, layer);
+      for (Int_t iPeak = 0; iPeak < fNumPeaks[leftIdx]; iPeak++) {
+        if (TMath::Abs(leftPeaks[iPeak].tb - peakTb) < fNumSideTbs && peakValue < leftPeaks[iPeak].value) {
 
 #ifdef DEBUG
-            fLogger -> Info(MESSAGE_ORIGIN, Form("peakTb: %d, peakValue: %f, left tb: %d, peakValue: %f!", peakTb, peakValue, leftPeakTb, leftPeakValue));
+          fLogger -> Info(MESSAGE_ORIGIN, Form("peakTb: %d, peakValue: %f, left tb: %d, peakValue: %f!", peakTb, peakValue, leftPeaks[iPeak].tb, leftPeaks[iPeak].value));
 #endif
 
-            pad = fPadArray -> at(fPadIdxArray[GetArrayIdx(row - 1, layer)]);
-            fPrevRightPeak.index = fPeaks[row - 1][layer][iPeak].index;
-            fPrevRightPeak.tb = leftPeakTb;
-            fPrevRightPeak.value = leftPeakValue;
-            fIgnoreRight = kTRUE;
-
-            goto whileStart;
-          }
+          pad = &(fPadArray -> at(fPadIdxArray[leftIdx]));
+          fPrevRightPeak = leftPeaks[iPeak];
+          fIgnoreRight = kTRUE;
+          isMoved = kTRUE;
+          break;
         }
       }
     }
+
+    if (isMoved)
+      continue;
     
     fPrevRightPeak.Reset();
     fIgnoreLeft = kFALSE;
@@ -191,46 +170,43 @@ STPSALayer::Analyze(STRawEvent *rawEvent, STEvent *event)
       fLogger -> Info(MESSAGE_ORIGIN, Form("Checking right pad row: %d, layer: %d!", row + 1, layer));
 #endif
 
-      Int_t rightNumPeaks = fNumPeaks[row + 1][layer];
-      if (rightNumPeaks) {
-        for (Int_t iPeak = 0; iPeak < rightNumPeaks; iPeak++) {
-          Int_t rightPeakTb = fPeaks[row + 1][layer][iPeak].tb;
-          Double_t rightPeakValue = fPeaks[row + 1][layer][iPeak].value;
-
-          if (TMath::Abs(rightPeakTb - peakTb) < fNumSideTbs && peakValue < rightPeakValue) {
+      Int_t rightIdx = GetArrayIdx(row + 1, layer);
+      STPeak *rightPeaks = GetPeaks(row + 1, layer);
+      for (Int_t iPeak = 0; iPeak < fNumPeaks[rightIdx]; iPeak++) {
+        if (TMath::Abs(rightPeaks[iPeak].tb - peakTb) < fNumSideTbs && peakValue < rightPeaks[iPeak].value) {
 
 #ifdef DEBUG
-            fLogger -> Info(MESSAGE_ORIGIN, Form("peakTb: %d, peakValue: %f, right tb: %d, peakValue: %f!", peakTb, peakValue, rightPeakTb, rightPeakValue));
+          fLogger -> Info(MESSAGE_ORIGIN, Form("peakTb: %d, peakValue: %f, right tb: %d, peakValue: %f!", peakTb, peakValue, rightPeaks[iPeak].tb, rightPeaks[iPeak].value));
 #endif
 
-            pad = fPadArray -> at(fPadIdxArray[GetArrayIdx(row + 1, layer)]);
-            fPrevLeftPeak.index = fPeaks[row + 1][layer][iPeak].index;
-            fPrevLeftPeak.tb = rightPeakTb;
-            fPrevLeftPeak.value = rightPeakValue;
-            fIgnoreLeft = kTRUE;
-
-            goto whileStart;
-          }
+          pad = &(fPadArray -> at(fPadIdxArray[rightIdx]));
+          fPrevLeftPeak = rightPeaks[iPeak];
+          fIgnoreLeft = kTRUE;
+          isMoved = kTRUE;
+          break;
         }
       }
     }
 
+    if (isMoved)
+      continue;
+
     fPrevLeftPeak.Reset();
     fIgnoreRight = kFALSE;
 
     if (peakValue < fThreshold) {
 
 #ifdef DEBUG
-      fLogger -> Info(MESSAGE_ORIGIN, Form("Peak isn't bigger than threshold: %f in pad row: %d, layer: %d!", peakValue, pad.GetRow(), pad.GetLayer()));
+      fLogger -> Info(MESSAGE_ORIGIN, Form("Peak isn't bigger than threshold: %f in pad row: %d, layer: %d!", peakValue, row, layer));
 #endif
 
       DeletePeakInfo(row, layer, 0);
 
       Int_t padIdx = GetUnusedPadIdx();
       if (padIdx == -1) break;
-      else pad = fPadArray -> at(padIdx);
+      pad = &(fPadArray -> at(padIdx));
 
-      goto whileStart;
+      continue;
     }
 
     Double_t weightedRowSum = 0;
@@ -243,18 +219,18 @@ STPSALayer::Analyze(STRawEvent *rawEvent, STEvent *event)
     numRight = (numRight + 1 > fPadRows ? fPadRows - 1 : numRight);
 
     for (Int_t iRow = numLeft; iRow < numRight + 1; iRow++) {
-      Int_t sideNumPeaks = fNumPeaks[iRow][layer];
+      Int_t sideIdx = GetArrayIdx(iRow, layer);
+      STPeak *sidePeaks = GetPeaks(iRow, layer);
 
 #ifdef DEBUG
-      fLogger -> Info(MESSAGE_ORIGIN, Form("iRow: %d, layer: %d, sideNumPeaks: %d!", iRow, layer, sideNumPeaks));
+      fLogger -> Info(MESSAGE_ORIGIN, Form("iRow: %d, layer: %d, sideNumPeaks: %d!", iRow, layer, fNumPeaks[sideIdx]));
 #endif
 
-      if (!sideNumPeaks)
-        continue;
-
-      for (Int_t iPeak = 0; iPeak < sideNumPeaks; iPeak++) {
-        Int_t sidePeakTb = fPeaks[iRow][layer][iPeak].tb;
-        Int_t sidePeakValue = fPeaks[iRow][layer][iPeak].value;
+      // Deleted peak is replaced by the next one, so iPeak is not increased then.
+      Int_t iPeak = 0;
+      while (iPeak < fNumPeaks[sideIdx]) {
+        Int_t sidePeakTb = sidePeaks[iPeak].tb;
+        Double_t sidePeakValue = sidePeaks[iPeak].value;
 
         if (TMath::Abs(sidePeakTb - peakTb) < fNumSideTbs) {
           weightedRowSum += sidePeakValue*iRow;
@@ -262,6 +238,8 @@ STPSALayer::Analyze(STRawEvent *rawEvent, STEvent *event)
 
           DeletePeakInfo(iRow, layer, iPeak);
         }
+        else
+          iPeak++;
       }
     }
 
@@ -272,11 +250,12 @@ STPSALayer::Analyze(STRawEvent *rawEvent, STEvent *event)
     Double_t selectedValues[10] = {0};
 
 #ifdef DEBUG
-    fLogger -> Info(MESSAGE_ORIGIN, Form("Start finding the hit time of pad row: %d, layer: %d from peakTb: %d", pad.GetRow(), pad.GetLayer(), peakTb));
+    fLogger -> Info(MESSAGE_ORIGIN, Form("Start finding the hit time of pad row: %d, layer: %d from peakTb: %d", row, layer, peakTb));
 #endif
 
-    for (Int_t iTb = peakTb; iTb > peakTb - 10; iTb--) {
-      Double_t adc = pad.GetADC(iTb);
+    Double_t *padADC = pad -> GetADC();
+    for (Int_t iTb = peakTb; iTb > peakTb - 10 && iTb >= 0; iTb--) {
+      Double_t adc = padADC[iTb];
 
       if (adc < peakValue*fPercPeakMin/100. || adc > peakValue*fPercPeakMax/100.)
         continue;
@@ -298,9 +277,9 @@ STPSALayer::Analyze(STRawEvent *rawEvent, STEvent *event)
 
       Int_t padIdx = GetUnusedPadIdx();
       if (padIdx == -1) break;
-      else pad = fPadArray -> at(padIdx);
+      pad = &(fPadArray -> at(padIdx));
 
-      goto whileStart;
+      continue;
     }
 
     Double_t fitConst = 0;
@@ -316,14 +295,13 @@ STPSALayer::Analyze(STRawEvent *rawEvent, STEvent *event)
 
     Double_t zPos = CalculateZ(layer);
 
-    STHit *hit = new STHit(hitNum, xPos, yPos, zPos, peakValue);
-    hit -> SetRow(pad.GetRow());
-    hit -> SetLayer(pad.GetLayer());
-    hit -> SetTb(hitTime);
-    hit -> SetChi2(chi2);
-    hit -> SetNDF(selectedPoints);
-    event -> AddHit(hit);
-    delete hit;
+    STHit hit(hitNum, xPos, yPos, zPos, peakValue);
+    hit.SetRow(row);
+    hit.SetLayer(layer);
+    hit.SetTb(hitTime);
+    hit.SetChi2(chi2);
+    hit.SetNDF(selectedPoints);
+    event -> AddHit(&hit);
 
     hitNum++;
 
@@ -356,15 +334,12 @@ STPSALayer::Reset()
 
   fPadArray = NULL;
 
-  for (Int_t iRow = 0; iRow < fPadRows; iRow++) {
-    for (Int_t iLayer = 0; iLayer < fPadLayers; iLayer++) {
-      fPadIdxArray[iLayer*fPadRows + iRow] = -1;
-      fNumPeaks[iRow][iLayer] = 0;
-
-      for (Int_t iPeak = 0; iPeak < fPeakStorageSize; iPeak++)
-        fPeaks[iRow][iLayer][iPeak].Reset();
-    }
+  // Peaks beyond fNumPeaks are never read, so only the counters are cleared.
+  for (auto arrayIdx : fFiredArrayIdx) {
+    fPadIdxArray[arrayIdx] = -1;
+    fNumPeaks[arrayIdx] = 0;
   }
+  fFiredArrayIdx.clear();
 }
 
 Int_t
@@ -373,27 +348,29 @@ STPSALayer::GetArrayIdx(Int_t row, Int_t layer)
   return (layer*fPadRows + row);
 }
 
+STPeak *
+STPSALayer::GetPeaks(Int_t row, Int_t layer)
+{
+  return &fPeaks[GetArrayIdx(row, layer)*fPeakStorageSize];
+}
+
 Int_t
 STPSALayer::GetUnusedPadIdx()
 {
-  Int_t row = fArrayIdx%fPadRows;
-  Int_t layer = fArrayIdx/fPadRows;
+  Int_t numArrayIdx = fPadLayers*fPadRows;
 
-  if (fNumPeaks[row][layer]) {
+  for (; fArrayIdx < numArrayIdx; fArrayIdx++) {
+    if (fNumPeaks[fArrayIdx]) {
 
 #ifdef DEBUG
-    fLogger -> Info(MESSAGE_ORIGIN, Form("Unused fArrayIdx: %d, pad row: %d, layer: %d, fPadIdxArray: %d!", fArrayIdx, row, layer, fPadIdxArray[fArrayIdx]));
+      fLogger -> Info(MESSAGE_ORIGIN, Form("Unused fArrayIdx: %d, pad row: %d, layer: %d, fPadIdxArray: %d!", fArrayIdx, fArrayIdx%fPadRows, fArrayIdx/fPadRows, fPadIdxArray[fArrayIdx]));
 #endif
 
-    return fPadIdxArray[fArrayIdx];
-  } else {
-    fArrayIdx++;
-
-    if (fArrayIdx > 12096)
-      return -1;
-    
-    return GetUnusedPadIdx();
+      return fPadIdxArray[fArrayIdx];
+    }
   }
+
+  return -1;
 }
 
 void
@@ -404,9 +381,8 @@ STPSALayer::PreAnalyze()
 #endif
   
   Int_t numPads = fPadArray -> size();
-  Int_t hitNum = 0;
   for (Int_t iPad = 0; iPad < numPads; iPad++) {
-    STPad pad = fPadArray -> at(iPad);
+    STPad &pad = fPadArray -> at(iPad);
 
     Int_t row = pad.GetRow();
     Int_t layer = pad.GetLayer();
@@ -417,66 +393,108 @@ STPSALayer::PreAnalyze()
       std::exit(0);
     }
 
-    Double_t *adc = pad.GetADC();
+    Int_t numPeaks = FindPeaks(pad.GetADC(), iPad, GetPeaks(row, layer));
+    if (numPeaks == 0)
+      continue;
 
-#if ROOT_VERSION_CODE < ROOT_VERSION(6,0,0)
-    Float_t floatADC[512] = {0};
-    Float_t dummy[512] = {0};
-    for (Int_t iTb = 0; iTb < fNumTbs; iTb++)
-      floatADC[iTb] = adc[iTb];
+    Int_t arrayIdx = GetArrayIdx(row, layer);
+    fNumFiredPads++;
+    fPadIdxArray[arrayIdx] = iPad;
+    fNumPeaks[arrayIdx] = numPeaks;
+    fFiredArrayIdx.push_back(arrayIdx);
 
-    Int_t numPeaks = fPeakFinder -> SearchHighRes(floatADC, dummy, fNumTbs, 4.7, 5, kFALSE, 3, kTRUE, 3);
-#else
-    Double_t dummy[512] = {0};
+#ifdef DEBUG
+    for (Int_t iPeak = 0; iPeak < numPeaks; iPeak++)
+      fLogger -> Info(MESSAGE_ORIGIN, Form("row: %d, layer: %d, tb: %d, adc: %f", row, layer, GetPeaks(row, layer)[iPeak].tb, GetPeaks(row, layer)[iPeak].value));
+#endif
+  }
 
-    Int_t numPeaks = fPeakFinder -> SearchHighRes(adc, dummy, fNumTbs, 4.7, 5, kFALSE, 3, kTRUE, 3);
+#ifdef DEBUG
+  fLogger -> Info(MESSAGE_ORIGIN, "Pre-analyze completed!!");
 #endif
+}
 
-    if (numPeaks == 0)
-      continue;
+Int_t
+STPSALayer::FindPeaks(Double_t *adc, Int_t iPad, STPeak *peaks)
+{
+  Int_t numTbs = (fNumTbs < kMaxPeakTbs ? fNumTbs : kMaxPeakTbs);
+  if (numTbs < 3)
+    return 0;
+
+  Double_t smooth[kMaxPeakTbs];
+  smooth[0] = adc[0];
+  smooth[numTbs - 1] = adc[numTbs - 1];
+
+  Double_t maxValue = 0;
+  for (Int_t iTb = 1; iTb < numTbs - 1; iTb++) {
+    smooth[iTb] = (adc[iTb - 1] + adc[iTb] + adc[iTb + 1])/3.;
+    if (smooth[iTb] > maxValue)
+      maxValue = smooth[iTb];
+  }
 
-    fNumFiredPads++;
-    fPadIdxArray[layer*fPadRows + row] = iPad;
-    fNumPeaks[row][layer] = numPeaks;
+  if (maxValue <= 0)
+    return 0;
 
-    for (Int_t iPeak = 0; iPeak < numPeaks; iPeak++) {
-      Int_t peakTb = (Int_t)ceil((fPeakFinder -> GetPositionX())[iPeak]);
-      Double_t peakAdc = adc[peakTb];
+  Double_t cut = fPeakThresholdRatio*maxValue;
 
-      fPeaks[row][layer][iPeak].index = iPad;
-      fPeaks[row][layer][iPeak].tb = peakTb;
-      fPeaks[row][layer][iPeak].value = peakAdc;
+  // Local maxima in time order. Of two maxima closer than fPeakMinDistance, the higher one is kept.
+  STPeak candidates[kMaxPeakCandidates];
+  Int_t numCandidates = 0;
+  for (Int_t iTb = 1; iTb < numTbs - 1; iTb++) {
+    if (!(smooth[iTb] > smooth[iTb - 1] && smooth[iTb] >= smooth[iTb + 1] && smooth[iTb] >= cut))
+      continue;
 
-#ifdef DEBUG
-      fLogger -> Info(MESSAGE_ORIGIN, Form("row: %d, layer: %d, tb: %d, adc: %f", pad.GetRow(), pad.GetLayer(), peakTb, peakAdc));
-#endif
+    Int_t peakTb = iTb;
+    if (adc[iTb - 1] > adc[peakTb]) peakTb = iTb - 1;
+    if (adc[iTb + 1] > adc[peakTb]) peakTb = iTb + 1;
 
+    if (numCandidates > 0 && peakTb - candidates[numCandidates - 1].tb < fPeakMinDistance) {
+      if (adc[peakTb] > candidates[numCandidates - 1].value) {
+        candidates[numCandidates - 1].tb = peakTb;
+        candidates[numCandidates - 1].value = adc[peakTb];
+      }
+      continue;
     }
+
+    if (numCandidates == kMaxPeakCandidates) {
+      fLogger -> Warning(MESSAGE_ORIGIN, Form("More than %d peak candidates in pad %d. Candidates after time bucket %d are dropped!", kMaxPeakCandidates, iPad, iTb));
+      break;
+    }
+
+    candidates[numCandidates].index = iPad;
+    candidates[numCandidates].tb = peakTb;
+    candidates[numCandidates].value = adc[peakTb];
+    numCandidates++;
   }
 
-#ifdef DEBUG
-  fLogger -> Info(MESSAGE_ORIGIN, "Pre-analyze completed!!");
-#endif
+  std::sort(candidates, candidates + numCandidates, [](const STPeak &a, const STPeak &b) { return a.value > b.value; });
+
+  Int_t numPeaks = (numCandidates < fPeakStorageSize ? numCandidates : fPeakStorageSize);
+  for (Int_t iPeak = 0; iPeak < numPeaks; iPeak++)
+    peaks[iPeak] = candidates[iPeak];
+
+  return numPeaks;
 }
 
 void
 STPSALayer::DeletePeakInfo(Int_t row, Int_t layer, Int_t peakNum)
 {
-  if (fNumPeaks[row][layer]) {
+  Int_t arrayIdx = GetArrayIdx(row, layer);
+
+  if (fNumPeaks[arrayIdx]) {
 
 #ifdef DEBUG
     fLogger -> Info(MESSAGE_ORIGIN, Form("Delete peak info - row: %d, layer: %d, peakNum: %d!", row, layer, peakNum));
 #endif
 
-    for (Int_t iPeak = peakNum; iPeak < fNumPeaks[row][layer]; iPeak++) {
-      fPeaks[row][layer][iPeak].tb = fPeaks[row][layer][iPeak + 1].tb;
-      fPeaks[row][layer][iPeak].value = fPeaks[row][layer][iPeak + 1].value;
-    }
+    STPeak *peaks = GetPeaks(row, layer);
+    for (Int_t iPeak = peakNum; iPeak < fNumPeaks[arrayIdx] - 1; iPeak++)
+      peaks[iPeak] = peaks[iPeak + 1];
 
-    fNumPeaks[row][layer]--;
+    fNumPeaks[arrayIdx]--;
   }
 
-  if (!fNumPeaks[row][layer]) {
+  if (!fNumPeaks[arrayIdx]) {
 
 #ifdef DEBUG
     fLogger -> Info(MESSAGE_ORIGIN, Form("Delete pad row: %d, layer: %d!", row, layer));
@@ -1,7 +1,7 @@
 //-----------------------------------------------------------
 // Description:
-//   This version uses TSpectrum class in ROOT to find
-//   peaks in pads and in one layer averages certain number
+//   This version finds peaks in pads with a local maximum
+//   search and in one layer averages certain number
 //   pads around the pad having the highest peak.
 //
 // Environment:
@@ -17,9 +17,6 @@
 // SpiRITROOT classes
 #include "STPSA.hh"
 
-// ROOT classes
-#include "TSpectrum.h"
-
 // STL
 #include <vector>
 
@@ -43,27 +40,46 @@ class STPSALayer : public STPSA
 
     void Analyze(STRawEvent *rawEvent, STEvent *event);
 
+    /**
+     * Find peaks of adc and fill peaks (at most fPeakStorageSize) in order of
+     * decreasing height. Returns the number of peaks.
+     *
+     * Local maxima of the 3-point moving average above fPeakThresholdRatio of
+     * the highest one are taken, and of the maxima closer than fPeakMinDistance
+     * only the higher one is kept. This replaces TSpectrum::SearchHighRes
+     * (sigma 4.7, threshold 5%, average window 3) without deconvolution.
+     * Only the first 512 time buckets are searched, and at most 256 local
+     * maxima are kept; a warning is logged when the limit is reached.
+     * Public for the test (test/testPSALayerPeaks.C).
+     */
+    Int_t FindPeaks(Double_t *adc, Int_t iPad, STPeak *peaks);
+
   private:
+    /// Clear only the peak store entries written in the last event
     void Reset();
     Int_t GetArrayIdx(Int_t row, Int_t layer);
     Int_t GetUnusedPadIdx();
     void PreAnalyze();
     void DeletePeakInfo(Int_t row, Int_t layer, Int_t peakNum);
 
-    TSpectrum *fPeakFinder;                    ///< TSpectrum object
+    STPeak *GetPeaks(Int_t row, Int_t layer);
 
     std::vector<STPad> *fPadArray;             ///< Pad array pointer in STRawEvent
 
     Int_t fNumFiredPads;                       ///< The number of total fired pads
-    Int_t *fPadIdxArray;                       ///< Array of pad index in fPadArray
+    std::vector<Int_t> fPadIdxArray;           ///< Pad index in fPadArray of each (row, layer), -1 if not fired
     Int_t fArrayIdx;                           ///< Row index to point unused pad
 
     Int_t fNumSidePads;                        ///< The number of pads to average side of the pad having the highest peak
     Int_t fNumSideTbs;                         ///< The number of tbs to search peak near the maximum peak
-    Int_t **fNumPeaks;                         ///< The number of peaks in the fired pad
+    std::vector<Int_t> fNumPeaks;              ///< The number of peaks in the fired pad, index from GetArrayIdx()
 
     Int_t fPeakStorageSize;                    ///< Maximum number of peaks in a pad
-    STPeak ***fPeaks;                          ///< Peak container pointer
+    std::vector<STPeak> fPeaks;                ///< Peak store, fPeakStorageSize peaks for each (row, layer)
+    std::vector<Int_t> fFiredArrayIdx;         ///< (row, layer) written in this event, for Reset()
+    Double_t fPeakThresholdRatio;              ///< Minimum height of peak relative to the highest one in the pad
+    Int_t fPeakMinDistance;                    ///< Minimum distance of two peaks in time bucket
+
     Bool_t fIgnoreLeft;
     STPeak fPrevLeftPeak;
     Bool_t fIgnoreRight;
@@ -73,7 +89,7 @@ class STPSALayer : public STPSA
     Int_t fPercPeakMin;                        ///< Minimum percentage of peak for determinig the hit time
     Int_t fPercPeakMax;                        ///< Maximum percentage of peak for determinig the hit time
 
-  ClassDef(STPSALayer, 1)
+  ClassDef(STPSALayer, 2)
 };
 
 #endif
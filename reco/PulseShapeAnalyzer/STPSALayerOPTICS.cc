@@ -8,9 +8,51 @@
 
 // ROOT
 #include "RVersion.h"
+#include "TStopwatch.h"
 
 ClassImp(STPSALayerOPTICS)
 
+OPTICSLayer::OPTICSLayer(Int_t numRows, Int_t numTbs)
+: layer(0), numRows(numRows), numTbs(numTbs)
+{
+  OPTICSPointStatus empty;
+  empty.SetStatus(OPTICSPointStatus::kQueue, -1, 0);
+  status.assign(numRows * numTbs, empty);
+  isRowFilled.assign(numRows, kFALSE);
+
+  peakFinder = new TSpectrum();
+}
+
+OPTICSLayer::~OPTICSLayer()
+{
+  delete peakFinder;
+}
+
+void
+OPTICSLayer::Reset()
+{
+  for (auto row : filledRows)
+  {
+    for (Int_t iTb = 0; iTb < numTbs; iTb++)
+      At(row, iTb).SetStatus(OPTICSPointStatus::kQueue, -1, 0);
+    isRowFilled[row] = kFALSE;
+  }
+  filledRows.clear();
+
+  peakPointArray.clear();
+  orderingList.clear();
+}
+
+void
+OPTICSLayer::FillRow(Int_t row)
+{
+  if (isRowFilled[row])
+    return;
+
+  isRowFilled[row] = kTRUE;
+  filledRows.push_back(row);
+}
+
 STPSALayerOPTICS::STPSALayerOPTICS()
 {
   fMinPointsForFit = 4;
@@ -59,9 +101,13 @@ STPSALayerOPTICS::STPSALayerOPTICS()
 
 STPSALayerOPTICS::~STPSALayerOPTICS()
 {
+  for (auto data : fLayers)
+    delete data;
 }
 
 void STPSALayerOPTICS::SetThresholdADC(Double_t val) { fThresholdADC = val; }
+void STPSALayerOPTICS::SetClusterLayersInParallel(Bool_t val) { fClusterLayersInParallel = val; }
+void STPSALayerOPTICS::SetNumThreads(Int_t numThreads) { fNumThreads = numThreads; }
 void STPSALayerOPTICS::SetThresholdEps(Double_t val) 
 {
   fThresholdEps = val; 
@@ -99,32 +145,84 @@ STPSALayerOPTICS::Eps(Double_t row1,
 void
 STPSALayerOPTICS::Analyze(STRawEvent *rawEvent, STEvent *event)
 {
-  for(Int_t iLayer=0; iLayer<fPadLayers; iLayer++)
+  TStopwatch timer;
+
+  SetPadIndex(rawEvent);
+
+  fLayerClusters.resize(fPadLayers);
+  for (auto &clusterArray : fLayerClusters)
+    clusterArray.clear();
+
+  if (fClusterLayersInParallel)
   {
+    if (fPool == nullptr)
+      fPool = STThreadPool::Instance();
+
+    while (fLayers.size() < fPool -> GetNumThreads() + 1)
+      fLayers.push_back(new OPTICSLayer(fPadRows, fNumTbs));
+
+    fPool -> ParallelFor(fPadLayers, [this](Int_t iLayer, Int_t iWorker)
+    {
+      OPTICSLayer *data = fLayers[iWorker];
+      data -> layer = iLayer;
+      ClusterLayer(*data, fLayerClusters[iLayer]);
+    }, 1, fNumThreads);
+  }
+  else
+  {
+    if (fLayers.empty())
+      fLayers.push_back(new OPTICSLayer(fPadRows, fNumTbs));
+
+    for(Int_t iLayer=0; iLayer<fPadLayers; iLayer++)
+    {
 #ifdef DEBUG_PLOT
-    if(iLayer != 10) continue;
+      if(iLayer != 10) continue;
 #endif
-    Reset();
+      fLayers[0] -> layer = iLayer;
+      ClusterLayer(*fLayers[0], fLayerClusters[iLayer]);
+    }
+  }
 
-    fCurrentLayer = iLayer; 
-#ifdef DEBUG_TIME
-    TStopwatch timer;
-    timer.Start();
-#endif
-    SetLayer(rawEvent);
-#ifdef DEBUG_TIME
-    timer.Stop();
-    std::cout << "[TIME] SetLayer()     " << iLayer << " " << timer.RealTime() << std::endl;
-#endif
-#ifdef DEBUG_TIME
-    timer.Start();
-#endif
-    AnalyzeLayer(event);
-#ifdef DEBUG_TIME
-    timer.Stop();
-    std::cout << "[TIME] AnalyzeLayer() " << iLayer << " " << timer.RealTime() << std::endl;
-    std::cout << std::endl;
+  for (auto &clusterArray : fLayerClusters)
+    for (auto &cluster : clusterArray)
+      event -> AddCluster(&cluster);
+
+  event -> SetIsClustered(kTRUE);
+
+  if (fLogger -> IsLogNeeded(DEBUG))
+    fLogger -> Debug(MESSAGE_ORIGIN, Form("STPSALayerOPTICS::Analyze() %f s", timer.RealTime()));
+}
+
+void
+STPSALayerOPTICS::SetPadIndex(STRawEvent *rawEvent)
+{
+  fPadIndex.assign(fPadRows * fPadLayers, nullptr);
+
+  std::vector<STPad> *padArray = rawEvent -> GetPads();
+  for (auto &pad : *padArray)
+  {
+    Int_t row = pad.GetRow();
+    Int_t layer = pad.GetLayer();
+    if (row < 0 || row >= fPadRows || layer < 0 || layer >= fPadLayers)
+      continue;
+
+    STPad *&padInIndex = fPadIndex[layer * fPadRows + row];
+    if (padInIndex == nullptr) // first pad, same as STRawEvent::GetPad()
+      padInIndex = &pad;
+  }
+}
+
+void
+STPSALayerOPTICS::ClusterLayer(OPTICSLayer &data, std::vector<STHitCluster> &clusterArray)
+{
+  clusterArray.clear();
+  data.Reset();
+#ifdef DEBUG_PLOT
+  fIdxGraphCluster = 0;
 #endif
+
+  SetLayer(data);
+  AnalyzeLayer(data, clusterArray);
 #ifdef DEBUG_PLOT
     /*
     fCvsFrameXY -> cd();
@@ -149,44 +247,17 @@ STPSALayerOPTICS::Analyze(STRawEvent *rawEvent, STEvent *event)
     fGraphClusterXY -> Set(0);
     */
 #endif
-  }
-  event -> SetIsClustered(kTRUE);
-}
-
-void 
-STPSALayerOPTICS::Reset()
-{
-  fCountClusters = 0;
-#ifdef DEBUG_PLOT
-  fIdxGraphCluster = 0;
-#endif
-
-  fPeakPointArray.clear();
-
-  for(Int_t iRow=0; iRow<fPadRows; iRow++) {
-    for(Int_t iTb=0; iTb<fNumTbs; iTb++) {
-      fStatus[iRow][iTb].SetStatus(OPTICSPointStatus::kQueue, -1, 0);
-    }
-  }
-
-  fPeakFinder = new TSpectrum();
 }
 
 void
-STPSALayerOPTICS::SetLayer(STRawEvent* rawEvent)
+STPSALayerOPTICS::SetLayer(OPTICSLayer &data)
 {
   for(Int_t iRow=0; iRow<fPadRows; iRow++)
   {
-#ifdef DEBUG_TIME
-    TStopwatch timer;
-    timer.Start();
-#endif
-    STPad* pad = rawEvent -> GetPad(iRow,fCurrentLayer);
+    STPad* pad = fPadIndex[data.layer * fPadRows + iRow];
     if(!pad) continue;
-#ifdef DEBUG_TIME
-    timer.Stop();
-    std::cout << "[TIME]   Get Pad:   " << iRow << " " << timer.RealTime() << std::endl;
-#endif
+
+    data.FillRow(iRow);
 
     Double_t *adcDouble = pad -> GetADC(); 
     Float_t adcFloat[512] = {0};
@@ -195,46 +266,36 @@ STPSALayerOPTICS::SetLayer(STRawEvent* rawEvent)
     {
       Double_t adc = adcDouble[iTb];
       adcFloat[iTb] = adc;
-      fStatus[iRow][iTb].adc = adc;
+      data.At(iRow, iTb).adc = adc;
 #ifdef DEBUG_PLOT
       fHistDataSet -> Fill(iRow, iTb, adc);
 #endif
     }
 
-#ifdef DEBUG_TIME
-    timer.Start();
-#endif
-
 #if ROOT_VERSION_CODE < ROOT_VERSION(6,0,0)
     Float_t dummy[512]    = {0};
-    Int_t nPeaks = fPeakFinder -> SearchHighRes(adcFloat, dummy, fNumTbs, 4.7, 5, kFALSE, 3, kTRUE, 3);
+    Int_t nPeaks = data.peakFinder -> SearchHighRes(adcFloat, dummy, fNumTbs, 4.7, 5, kFALSE, 3, kTRUE, 3);
 #else
     Double_t dummy[512]    = {0};
-    Int_t nPeaks = fPeakFinder -> SearchHighRes(adcDouble, dummy, fNumTbs, 4.7, 5, kFALSE, 3, kTRUE, 3);
-#endif
-
-#ifdef DEBUG_TIME
-    timer.Stop();
-    std::cout << "[TIME]   Find Peak: " << iRow << " " << timer.RealTime() << std::endl;
+    Int_t nPeaks = data.peakFinder -> SearchHighRes(adcDouble, dummy, fNumTbs, 4.7, 5, kFALSE, 3, kTRUE, 3);
 #endif
 
-#ifdef DEBUG_TIME
-    timer.Start();
-#endif
     for(Int_t iPeak=0; iPeak<nPeaks; iPeak++) 
     {
-      Int_t tbPeakTemp = (Int_t) ceil((fPeakFinder->GetPositionX())[iPeak]);
-      Double_t adcTemp = fStatus[iRow][tbPeakTemp].adc;
+      Int_t tbPeakTemp = (Int_t) ceil((data.peakFinder->GetPositionX())[iPeak]);
+      if(tbPeakTemp<0 || tbPeakTemp>=fNumTbs)
+        continue;
+      Double_t adcTemp = data.At(iRow, tbPeakTemp).adc;
       Int_t tbPeak = tbPeakTemp;
 
       for(Int_t i=1; i<3; i++)
       {
         Int_t tbTemp = tbPeak + i;
 
-        if(tbTemp<0 && tbTemp>=fNumTbs) 
+        if(tbTemp<0 || tbTemp>=fNumTbs) 
           break;
 
-        if(adcTemp < fStatus[iRow][tbTemp].adc)
+        if(adcTemp < data.At(iRow, tbTemp).adc)
           tbPeak = tbTemp;
       }
 
@@ -242,23 +303,23 @@ STPSALayerOPTICS::SetLayer(STRawEvent* rawEvent)
       {
         Int_t tbTemp = tbPeak - i;
 
-        if(tbTemp<0 && tbTemp>=fNumTbs) 
+        if(tbTemp<0 || tbTemp>=fNumTbs) 
           break;
 
-        if(adcTemp < fStatus[iRow][tbTemp].adc)
+        if(adcTemp < data.At(iRow, tbTemp).adc)
           tbPeak = tbTemp;
       }
 
-      Double_t adcPeak = fStatus[iRow][tbPeak].adc;
+      Double_t adcPeak = data.At(iRow, tbPeak).adc;
       if(adcPeak < fThresholdADC) continue;
 
       Double_t tbArray[10] = {0};
       Double_t adcArray[10] = {0};
 
       Int_t countPoints = 0;
-      for(Int_t iTb=tbPeak; iTb>tbPeak-10; iTb--) 
+      for(Int_t iTb=tbPeak; iTb>tbPeak-10 && iTb>=0; iTb--) 
       {
-        Double_t adc = fStatus[iRow][iTb].adc;
+        Double_t adc = data.At(iRow, iTb).adc;
 
         if (adc < adcPeak*fPercPeakMin/100. || adc > adcPeak*fPercPeakMax/100.)
           continue;
@@ -285,61 +346,44 @@ STPSALayerOPTICS::SetLayer(STRawEvent* rawEvent)
 
       OPTICSPoint point;
       point.Set(iRow, tbPeak, -1, adcPeak, yHit);
-      fPeakPointArray.push_back(point);
+      data.peakPointArray.push_back(point);
 
 #ifdef DEBUG_PLOT
       //fGraphCluster -> SetPoint(fIdxGraphCluster++, iRow+.5, tbPeak+.5);
 #endif
     }
-#ifdef DEBUG_TIME
-    timer.Stop();
-    std::cout << "[TIME]   Ana Peak:  " << iRow << " " << timer.RealTime() << std::endl;
-#endif
   }
 }
 
 void 
-STPSALayerOPTICS::AnalyzeLayer(STEvent* event)
+STPSALayerOPTICS::AnalyzeLayer(OPTICSLayer &data, std::vector<STHitCluster> &clusterArray)
 {
-  Int_t nPeaks = fPeakPointArray.size();
+  Int_t nPeaks = data.peakPointArray.size();
   OPTICSSortADC sortADC;
-  std::sort(fPeakPointArray.begin(), fPeakPointArray.end(), sortADC);
+  std::sort(data.peakPointArray.begin(), data.peakPointArray.end(), sortADC);
 
   for(Int_t iPeak=0; iPeak<nPeaks; iPeak++)
   {
-    OPTICSPoint point = fPeakPointArray[iPeak];
+    OPTICSPoint point = data.peakPointArray[iPeak];
     Int_t rowPeak = point.row;
     Int_t tbPeak  = point.tb;
-    fStatus[rowPeak][tbPeak].idxPeak = iPeak;
+    data.At(rowPeak, tbPeak).idxPeak = iPeak;
 #ifdef DEBUG_PLOT
-    std::cout << "Peak: " << iPeak << " " << fStatus[rowPeak][tbPeak].adc << std::endl;
+    std::cout << "Peak: " << iPeak << " " << data.At(rowPeak, tbPeak).adc << std::endl;
 #endif
   }
 
   for(Int_t iPeak=0; iPeak<nPeaks; iPeak++)
   {
-    OPTICSPoint point = fPeakPointArray[iPeak];
+    OPTICSPoint point = data.peakPointArray[iPeak];
     Int_t rowPeak = point.row;
     Int_t tbPeak  = point.tb;
 
-    if(fStatus[rowPeak][tbPeak].status != OPTICSPointStatus::kQueue)
+    if(data.At(rowPeak, tbPeak).status != OPTICSPointStatus::kQueue)
       continue;
 
-    if(rowPeak<fPadRows/4 && rowPeak>fPadRows*3/4)
-      SetSearchRangeFromPeak(3,6);
-    else
-      SetSearchRangeFromPeak(2,4);
-
-#ifdef DEBUG_TIME
-    TStopwatch timer;
-    timer.Start();
-#endif
-    RunOPTICS(rowPeak, tbPeak);
-#ifdef DEBUG_TIME
-    timer.Stop();
-    std::cout << "[TIME]   RunOPTICS() " << iPeak << " " << timer.RealTime() << std::endl;
-#endif
-    event -> AddCluster(GetCurrentCluster());
+    RunOPTICS(data, rowPeak, tbPeak, fRowHalfRange, fTbHalfRange);
+    AddCurrentCluster(data, clusterArray);
 
 #ifdef DEBUG_PLOT
     fCvsFrame -> cd();
@@ -373,36 +417,43 @@ STPSALayerOPTICS::AnalyzeLayer(STEvent* event)
     fHistEps -> Reset();
     //fHistEpsAll -> Reset();
 #endif
-
-    fCountClusters++;
   }
 }
 
 void
-STPSALayerOPTICS::RunOPTICS(Int_t rowCenter, Int_t tbCenter)
+STPSALayerOPTICS::RunOPTICS(OPTICSLayer &data, Int_t rowCenter, Int_t tbCenter, Int_t rowHalfRange, Int_t tbHalfRange)
 {
-  ResetCluster();
-  Int_t idxPeakCenter = fStatus[rowCenter][tbCenter].idxPeak;
-  AddPeakToCluster(fPeakPointArray[idxPeakCenter]);
+  ResetCluster(data);
+  Int_t idxPeakCenter = data.At(rowCenter, tbCenter).idxPeak;
+  AddPeakToCluster(data, data.peakPointArray[idxPeakCenter]);
 
-  fStatus[rowCenter][tbCenter].status = OPTICSPointStatus::kCore;
+  data.At(rowCenter, tbCenter).status = OPTICSPointStatus::kCore;
 
-  Double_t adcCenter = fStatus[rowCenter][tbCenter].adc;
+  Double_t adcCenter = data.At(rowCenter, tbCenter).adc;
 
 #ifdef DEBUG_PLOT
-      std::cout << "Step Peak: " << "-" << " " << rowCenter << " " << tbCenter << " " << fStatus[rowCenter][tbCenter].adc << " " << 0 << std::endl;
+      std::cout << "Step Peak: " << "-" << " " << rowCenter << " " << tbCenter << " " << adcCenter << " " << 0 << std::endl;
 #endif
 
   Int_t rowStart = rowCenter;
   Int_t tbStart = tbCenter;
 
-  Int_t rowBoundLow  = rowCenter - fRowHalfRange;
-  Int_t rowBoundHigh = rowCenter + fRowHalfRange;
-  Int_t tbBoundLow   = tbCenter  - fTbHalfRange;
-  Int_t tbBoundHigh  = tbCenter  + fTbHalfRange;
+  Int_t rowBoundLow  = rowCenter - rowHalfRange;
+  Int_t rowBoundHigh = rowCenter + rowHalfRange;
+  Int_t tbBoundLow   = tbCenter  - tbHalfRange;
+  Int_t tbBoundHigh  = tbCenter  + tbHalfRange;
+
+  if (rowBoundLow < 0) rowBoundLow = 0;
+  if (rowBoundHigh >= fPadRows) rowBoundHigh = fPadRows - 1;
+  if (tbBoundLow < 0) tbBoundLow = 0;
+  if (tbBoundHigh >= fNumTbs) tbBoundHigh = fNumTbs - 1;
 
-  OPTICSSortEps sortEps;
-  std::vector<OPTICSPoint> orderingList;
+  // Points are kept in a heap, so taking the point of smallest epsilon
+  // does not need sorting the whole list in every step.
+  OPTICSHeapEps heapEps;
+  std::vector<OPTICSPoint> &orderingList = data.orderingList;
+  orderingList.clear();
+  Int_t countPoints = 0;
 
   Double_t epsMax = 0;
   Double_t epsMin = 0;
@@ -425,39 +476,38 @@ STPSALayerOPTICS::RunOPTICS(Int_t rowCenter, Int_t tbCenter)
 
       if(!inLoop) break;
 
-      Int_t status = fStatus[rowCand][tbCand].status;
-      if(status != OPTICSPointStatus::kQueue) 
-        continue;
-
       if(rowCand < rowBoundLow || rowCand > rowBoundHigh || 
          tbCand  < tbBoundLow  || tbCand  > tbBoundHigh)
         continue;
-      if(rowCand < 0 || rowCand > fPadRows || tbCand < 0 || tbCand > fNumTbs)
+
+      OPTICSPointStatus &statusCand = data.At(rowCand, tbCand);
+      if(statusCand.status != OPTICSPointStatus::kQueue) 
         continue;
 
-      Double_t adcCand = fStatus[rowCand][tbCand].adc;
+      Double_t adcCand = statusCand.adc;
       Double_t eps = Eps(rowCenter, tbCenter, adcCenter, rowCand, tbCand, adcCand);
 
       if(eps<fThresholdEps)
       {
         OPTICSPoint point;
         point.Set(rowCand, tbCand, eps);
+        point.order = countPoints++;
         orderingList.push_back(point);
+        std::push_heap(orderingList.begin(), orderingList.end(), heapEps);
 
-        fStatus[rowCand][tbCand].status = OPTICSPointStatus::kCore;
+        statusCand.status = OPTICSPointStatus::kCore;
+        data.FillRow(rowCand);
       }
     }
     Int_t nSortedPoints = orderingList.size();
     if(nSortedPoints==0) break;
 
-    std::sort(orderingList.begin(), orderingList.end(), sortEps);
-
-    rowCenter = orderingList[0].row;
-    tbCenter  = orderingList[0].tb;
-    adcCenter = fStatus[rowCenter][tbCenter].adc;
+    rowCenter = orderingList.front().row;
+    tbCenter  = orderingList.front().tb;
+    adcCenter = data.At(rowCenter, tbCenter).adc;
 
     epsOld = epsNew;
-    epsNew = orderingList[0].eps;
+    epsNew = orderingList.front().eps;
 
     if(epsOld < epsNew) {
       epsMax = epsNew;
@@ -469,58 +519,55 @@ STPSALayerOPTICS::RunOPTICS(Int_t rowCenter, Int_t tbCenter)
     if(epsMin < epsMax)
       break;
 
-    Int_t idxPeakCand = fStatus[rowCenter][tbCenter].idxPeak;
+    Int_t idxPeakCand = data.At(rowCenter, tbCenter).idxPeak;
     if(idxPeakCand != -1 && rowCenter != rowStart)
     {
-      AddPeakToCluster(fPeakPointArray[idxPeakCand]);
-      fStatus[rowCenter][tbCenter].idxPeak = -1;
+      AddPeakToCluster(data, data.peakPointArray[idxPeakCand]);
+      data.At(rowCenter, tbCenter).idxPeak = -1;
 #ifdef DEBUG_PLOT
-      std::cout << "Step Peak: " << countStep << " " << rowCenter << " " << tbCenter << " " << fStatus[rowCenter][tbCenter].adc << " " << epsNew << std::endl;
+      std::cout << "Step Peak: " << countStep << " " << rowCenter << " " << tbCenter << " " << adcCenter << " " << epsNew << std::endl;
 #endif
     }
 
-    orderingList.erase(orderingList.begin());
+    std::pop_heap(orderingList.begin(), orderingList.end(), heapEps);
+    orderingList.pop_back();
 
     countStep++;
   }
 
-  Int_t nLeftOvers = orderingList.size();
-  for(Int_t i=0; i<nLeftOvers; i++)
-  {
-    OPTICSPoint point = orderingList.back();
-    fStatus[point.row][point.tb].status = OPTICSPointStatus::kQueue;
-    orderingList.pop_back();
-  }
+  for (auto &point : orderingList)
+    data.At(point.row, point.tb).status = OPTICSPointStatus::kQueue;
+  orderingList.clear();
 }
 
 void 
-STPSALayerOPTICS::ResetCluster()
+STPSALayerOPTICS::ResetCluster(OPTICSLayer &data)
 {
-  fNPointsInCluster = 0;
-  fPosCluster.SetXYZ(0,0,CalculateZ(fCurrentLayer));
-  fSigmaCluster.SetXYZ(0,0,fPadSizeZ/2.);
-  fChargeCluster = 0;
+  data.nPointsInCluster = 0;
+  data.posCluster.SetXYZ(0,0,CalculateZ(data.layer));
+  data.sigmaCluster.SetXYZ(0,0,fPadSizeZ/2.);
+  data.chargeCluster = 0;
 }
 
 void  
-STPSALayerOPTICS::AddPeakToCluster(OPTICSPoint point)
+STPSALayerOPTICS::AddPeakToCluster(OPTICSLayer &data, OPTICSPoint point)
 {
 #ifdef DEBUG_PLOT
-  fGraphClusterPeaks -> SetPoint(fNPointsInCluster, point.row+.5, point.tb+.5);
+  fGraphClusterPeaks -> SetPoint(data.nPointsInCluster, point.row+.5, point.tb+.5);
 #endif
   Double_t x = CalculateX(point.row);
   Double_t y = point.y;
   Double_t charge = point.adc;
 
-  Double_t chargeSum  = fChargeCluster + charge;
+  Double_t chargeSum  = data.chargeCluster + charge;
 
-  Double_t xNew  = fPosCluster.X() * fChargeCluster / chargeSum + charge * x / chargeSum;
-  Double_t yNew  = fPosCluster.Y() * fChargeCluster / chargeSum + charge * y / chargeSum;
+  Double_t xNew  = data.posCluster.X() * data.chargeCluster / chargeSum + charge * x / chargeSum;
+  Double_t yNew  = data.posCluster.Y() * data.chargeCluster / chargeSum + charge * y / chargeSum;
 
   Double_t xSigmaNew;
   Double_t ySigmaNew;
 
-  if(fNPointsInCluster == 0) 
+  if(data.nPointsInCluster == 0) 
   {
     xSigmaNew = 0;
     ySigmaNew = 0;
@@ -530,49 +577,44 @@ STPSALayerOPTICS::AddPeakToCluster(OPTICSPoint point)
     Double_t xDiff = xNew - x;
     Double_t yDiff = yNew - y;
 
-    xSigmaNew = sqrt( fSigmaCluster.X() * fSigmaCluster.X() * fNPointsInCluster / chargeSum + charge * xDiff * xDiff / fNPointsInCluster );
-    ySigmaNew = sqrt( fSigmaCluster.Y() * fSigmaCluster.Y() * fNPointsInCluster / chargeSum + charge * yDiff * yDiff / fNPointsInCluster );
+    xSigmaNew = sqrt( data.sigmaCluster.X() * data.sigmaCluster.X() * data.nPointsInCluster / chargeSum + charge * xDiff * xDiff / data.nPointsInCluster );
+    ySigmaNew = sqrt( data.sigmaCluster.Y() * data.sigmaCluster.Y() * data.nPointsInCluster / chargeSum + charge * yDiff * yDiff / data.nPointsInCluster );
   }
 
-  //std::cout << "[DEBUG]   adding:  " << x << " " << y << " " << charge << std::endl;
-
-  fPosCluster.SetX(xNew);
-  fPosCluster.SetY(yNew);
-
-  fSigmaCluster.SetX(xSigmaNew);
-  fSigmaCluster.SetY(ySigmaNew);
+  data.posCluster.SetX(xNew);
+  data.posCluster.SetY(yNew);
 
-  fChargeCluster += charge;
+  data.sigmaCluster.SetX(xSigmaNew);
+  data.sigmaCluster.SetY(ySigmaNew);
 
-  //std::cout << "[DEBUG]   result:  " << fPosCluster.X() << " " << fPosCluster.Y() << " " << fChargeCluster << std::endl;
+  data.chargeCluster += charge;
 
-  fNPointsInCluster++;
+  data.nPointsInCluster++;
 }
 
-STHitCluster*
-STPSALayerOPTICS::GetCurrentCluster()
+void
+STPSALayerOPTICS::AddCurrentCluster(OPTICSLayer &data, std::vector<STHitCluster> &clusterArray)
 {
-  if (fNPointsInCluster == 1)
+  if (data.nPointsInCluster == 1)
   {
-    fSigmaCluster.SetX(fPadSizeX/2.);
-    fSigmaCluster.SetY(0); // TODO : How to set sigma in tb?
+    data.sigmaCluster.SetX(fPadSizeX/2.);
+    data.sigmaCluster.SetY(0); // TODO : How to set sigma in tb?
   }
-  STHitCluster* cluster = new STHitCluster();
-  cluster -> SetPosition(fPosCluster);
-  cluster -> SetPosSigma(fSigmaCluster);
-  cluster -> SetCharge(fChargeCluster);
+
+  clusterArray.push_back(STHitCluster());
+  STHitCluster &cluster = clusterArray.back();
+  cluster.SetPosition(data.posCluster);
+  cluster.SetPosSigma(data.sigmaCluster);
+  cluster.SetCharge(data.chargeCluster);
 
 #ifdef DEBUG_PLOT
   std::cout << "[DEBUG] cluster! " 
-            << fCountClusters  << " " 
-            << fNPointsInCluster << " : " 
-            << fPosCluster.X() << " " 
-            << fPosCluster.Y() << " " 
-            << fPosCluster.Z() << std::endl;
-  //fGraphClusterXY -> SetPoint(fCountClusters, fPosCluster.X(), fPosCluster.Y());
+            << clusterArray.size() - 1 << " " 
+            << data.nPointsInCluster << " : " 
+            << data.posCluster.X() << " " 
+            << data.posCluster.Y() << " " 
+            << data.posCluster.Z() << std::endl;
 #endif
-
-  return cluster;
 }
 
 Bool_t
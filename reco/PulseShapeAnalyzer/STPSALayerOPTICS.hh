@@ -2,13 +2,11 @@
 #define STPSALAYEROPTICS
 
 #include "STPSA.hh"
+#include "STThreadPool.hh"
 #include "TSpectrum.h"
 #include <vector>
 
 //#define DEBUG_PLOT
-//#define DEBUG_TIME
-
-#include "TStopwatch.h"
 
 #include "TCanvas.h"
 #include "TH1D.h"
@@ -29,6 +27,7 @@ class OPTICSPoint
     Double_t eps;
     Double_t adc;
     Double_t y;
+    Int_t    order; //!< Number of the point in the ordering list, for points of the same epsilon
 
     void Set(Int_t _row, Int_t _tb, Double_t _eps = -1, Double_t _adc = -1, Double_t _y = -1)
     {
@@ -37,6 +36,7 @@ class OPTICSPoint
       eps = _eps;
       adc = _adc;
       y = _y;
+      order = 0;
     }
 
     OPTICSPoint &operator=(OPTICSPoint right)
@@ -46,6 +46,7 @@ class OPTICSPoint
       eps = right.eps; 
       adc = right.adc; 
       y = right.y;
+      order = right.order;
       return *this; 
     }
 };
@@ -53,13 +54,20 @@ class OPTICSPoint
 
 
 /**
- * @brief Sorting order of epsilon in OPTICS
+ * @brief Heap order of the OPTICS ordering list. Smallest epsilon on top.
+ *
+ * Of the points with the same epsilon, the one added first to the list is
+ * on top, as the list sorted by epsilon with the order of addition kept.
  */
-class OPTICSSortEps
+class OPTICSHeapEps
 {
   public :
-    Bool_t operator() (OPTICSPoint sample1, OPTICSPoint sample2) 
-    { return (sample1.eps < sample2.eps); }
+    Bool_t operator() (const OPTICSPoint &sample1, const OPTICSPoint &sample2) const
+    {
+      if (sample1.eps != sample2.eps)
+        return (sample1.eps > sample2.eps);
+      return (sample1.order > sample2.order);
+    }
 };
 
 
@@ -109,6 +117,45 @@ class OPTICSPointStatus
 
 
 
+/**
+ * @brief Working data of one layer in STPSALayerOPTICS.
+ *
+ * Status of the bins is kept in a (row, tb) grid of one layer, so that the
+ * neighbors of a bin are found by index. Only the rows which are filled in
+ * SetLayer() are cleared for the next layer. One per worker thread.
+ */
+class OPTICSLayer
+{
+  public :
+    OPTICSLayer(Int_t numRows, Int_t numTbs);
+    ~OPTICSLayer();
+
+    void Reset();
+    void FillRow(Int_t row);
+
+    OPTICSPointStatus &At(Int_t row, Int_t tb) { return status[row * numTbs + tb]; }
+
+    Int_t layer;
+    Int_t numRows;
+    Int_t numTbs;
+
+    std::vector<OPTICSPointStatus> status; //!< Status of all bins. [row * numTbs + tb]
+    std::vector<Bool_t> isRowFilled;
+    std::vector<Int_t> filledRows;
+
+    std::vector<OPTICSPoint> peakPointArray; //!< Array of OPTICSPoint for peak points.
+    std::vector<OPTICSPoint> orderingList;   //!< Heap of OPTICSHeapEps
+
+    TSpectrum *peakFinder;
+
+    Int_t nPointsInCluster;
+    TVector3 posCluster;
+    TVector3 sigmaCluster;
+    Double_t chargeCluster;
+};
+
+
+
 /**
  * @brief OPTICSPoint status
  */
@@ -124,6 +171,15 @@ class STPSALayerOPTICS : public STPSA
     void SetThresholdADC(Double_t val);
     void SetThresholdEps(Double_t val);
 
+    /**
+     * Cluster the layers in parallel using STThreadPool::Instance().
+     * Clusters are added to the event in the order of the layers as in the serial run.
+     * Default is false.
+     */
+    void SetClusterLayersInParallel(Bool_t val = kTRUE);
+    /// Maximum number of threads used for one event (0 for all threads of the pool).
+    void SetNumThreads(Int_t numThreads);
+
     /**
      * @brief Epsilon model. Return epsilon value of current model.
      *
@@ -142,32 +198,20 @@ class STPSALayerOPTICS : public STPSA
                  Double_t adcNb);
 
   private :
-    void Reset();
-    void SetLayer(STRawEvent* rawEvent);
-    void AnalyzeLayer(STEvent* event);
-    void RunOPTICS(Int_t rowCenter, Int_t tbCenter);
+    void SetPadIndex(STRawEvent* rawEvent);
+    void ClusterLayer(OPTICSLayer &data, std::vector<STHitCluster> &clusterArray);
+    void SetLayer(OPTICSLayer &data);
+    void AnalyzeLayer(OPTICSLayer &data, std::vector<STHitCluster> &clusterArray);
+    void RunOPTICS(OPTICSLayer &data, Int_t rowCenter, Int_t tbCenter, Int_t rowHalfRange, Int_t tbHalfRange);
     Bool_t GetNbBin(Int_t rBox, Int_t index, Int_t row0, Int_t tb0, Int_t &row, Int_t &tb);
 
-    FairLogger* fLogger;
-
-    Int_t fCurrentLayer; 
-
-    TSpectrum* fPeakFinder; //!< TSpectrum 
-
     Int_t fMinPointsForFit;
     Double_t fPercPeakMin;
     Double_t fPercPeakMax;
 
-    Int_t fCountClusters; //!< Counting number of clusters(groups).
-
-    void ResetCluster();
-    void AddPeakToCluster(OPTICSPoint point);
-    STHitCluster* GetCurrentCluster();
-
-    Int_t fNPointsInCluster;
-    TVector3 fPosCluster;
-    TVector3 fSigmaCluster;
-    Double_t fChargeCluster;
+    void ResetCluster(OPTICSLayer &data);
+    void AddPeakToCluster(OPTICSLayer &data, OPTICSPoint point);
+    void AddCurrentCluster(OPTICSLayer &data, std::vector<STHitCluster> &clusterArray);
 
     Int_t fRowHalfRange; //!< half range in row direction when finding neighbors
     Int_t fTbHalfRange;  //!< half range in row direction when finding neighbors
@@ -176,8 +220,13 @@ class STPSALayerOPTICS : public STPSA
     Double_t fThresholdADC; //!< Adc threshold
     Double_t fThresholdEps; //!< Epsilon threshold
 
-    vector<OPTICSPoint> fPeakPointArray; //!< Array of OPTICSPoint for peak points.
-    OPTICSPointStatus fStatus[108][512]; //!< Status of all bins.
+    Bool_t fClusterLayersInParallel = kFALSE;
+    Int_t fNumThreads = 0;
+    STThreadPool *fPool = nullptr; //!
+
+    std::vector<STPad *> fPadIndex;     //!< Pad of (row, layer) in current event. [layer * fPadRows + row]
+    std::vector<OPTICSLayer *> fLayers; //!< Working data. One per worker.
+    std::vector<std::vector<STHitCluster>> fLayerClusters; //!< Clusters found in each layer
 
 #ifdef DEBUG_PLOT
     TCanvas* fCvsFrame;
@@ -197,7 +246,7 @@ class STPSALayerOPTICS : public STPSA
     TGraph* fGraphClusterXY;
 #endif
 
-  ClassDef(STPSALayerOPTICS, 1)
+  ClassDef(STPSALayerOPTICS, 2)
 };
 
 #endif
@@ -3,6 +3,7 @@
 #include <fstream>
 #include <iostream>
 #include <fstream>
+#include <iomanip>
 #include <string>
 #include <sstream>
 using namespace std;
@@ -34,103 +35,110 @@ STPulse::STPulse(Int_t shapingTime)
 
 void STPulse::Initialize(TString fileName)
 {
-  TString spiritroot = gSystem -> Getenv("VMCWORKDIR");
+  auto pulseTemplate = STPulseTemplate::Get(fileName);
+  if (pulseTemplate == nullptr) {
+    cout << "*** Error occured while initializing the pulse: " << fileName << endl;
+    return;
+  }
 
-  fileName = spiritroot + "/parameters/" + fileName;
+  SetTemplate(pulseTemplate);
+}
+
+void
+STPulse::SetTemplate(std::shared_ptr<const STPulseTemplate> pulseTemplate)
+{
+  fTemplate = pulseTemplate;
+
+  fShapingTime     = fTemplate -> fShapingTime;
+  fNumDataPoints   = fTemplate -> fNumDataPoints;
+  fStepSize        = fTemplate -> fStepSize;
+  fNumAscending    = fTemplate -> fNumAscending;
+  fNDFTbs          = fTemplate -> fNDFTbs;
+  fTbAtThreshold   = fTemplate -> fTbAtThreshold;
+  fTbAtTail        = fTemplate -> fTbAtTail;
+  fTbAtMax         = fTemplate -> fTbAtMax;
+  fThresholdTbStep = fTemplate -> fThresholdTbStep;
+
+  fPulseData   = fTemplate -> fPulseData;
+  fTableValue  = fTemplate -> fTableValue.data();
+  fTableDiff   = fTemplate -> fTableDiff.data();
+  fInvStepSize = fTemplate -> fInvStepSize;
+
+  fTableValueF = fTemplate -> fTableValueF.data();
+  fTableDiffF  = fTemplate -> fTableDiffF.data();
+}
 
-  ifstream file(fileName);
-  string line;
+void
+STPulse::Detach()
+{
+  if (fOwnTemplate != nullptr || fTemplate == nullptr)
+    return;
 
-  while (getline(file, line) && line.find("#") == 0) {}
-  istringstream ss(line);
-  ss >> fShapingTime >> fNumDataPoints >> fStepSize >> fNumAscending >> fNDFTbs;
+  fOwnTemplate = std::make_shared<STPulseTemplate>(*fTemplate);
+  fTemplate = fOwnTemplate;
 
-  if (fNumDataPoints < 20 || fStepSize > 1)
-  {
-    cout << "*** Error occured while initializing the pulse!" << endl;
-    cout << "*** Check file: " << fileName << endl;
+  fPulseData  = fOwnTemplate -> fPulseData;
+  fTableValue = fOwnTemplate -> fTableValue.data();
+  fTableDiff  = fOwnTemplate -> fTableDiff.data();
+  fTableValueF = fOwnTemplate -> fTableValueF.data();
+  fTableDiffF  = fOwnTemplate -> fTableDiffF.data();
+}
+
+void
+STPulse::UpdateTable()
+{
+  Detach();
+  if (fOwnTemplate == nullptr)
     return;
-  }
 
-  fPulseData = new STSamplePoint[fNumDataPoints];
+  fOwnTemplate -> fStepSize = fStepSize;
+  fOwnTemplate -> UpdateTable();
 
-  Double_t max = 0;
-  for (Int_t iData = 0; iData < fNumDataPoints; iData++)
-  {
-    getline(file, line);
-    if (line.find("#") == 0) {
-      iData--;
-      continue;
-    }
-
-    fPulseData[iData].Init(line);
-    Double_t value = fPulseData[iData].fValue;
-
-    if (value > max) {
-      max = value;
-      fTbAtMax = iData * fStepSize;
-    }
-  }
+  fTableValue  = fOwnTemplate -> fTableValue.data();
+  fTableDiff   = fOwnTemplate -> fTableDiff.data();
+  fInvStepSize = fOwnTemplate -> fInvStepSize;
+  fTableValueF = fOwnTemplate -> fTableValueF.data();
+  fTableDiffF  = fOwnTemplate -> fTableDiffF.data();
+}
 
-  Double_t c = 1/max;
-  Double_t valuePre = 0, valueCur = 0;
-  fTbAtThreshold = 0;
-  fTbAtTail = 0;
-
-  for (Int_t iData = 0; iData < fNumDataPoints; iData++)
-  {
-    fPulseData[iData].fValue = c * fPulseData[iData].fValue;
-
-    valuePre = valueCur;
-    valueCur = fPulseData[iData].fValue;
-
-    if (fTbAtThreshold == 0 && valueCur > fThresholdRatio)
-    {
-      fTbAtThreshold = iData * fStepSize;
-      Int_t next = iData + 1/fStepSize;
-      fThresholdTbStep = fPulseData[next].fValue - fPulseData[iData].fValue;
-    }
-
-    if (fTbAtTail == 0 && valueCur < valuePre && valueCur < 0.1)
-      fTbAtTail = iData * fStepSize;
-  }
+void
+STPulse::PulseBatch(Double_t tbOffset, Int_t n, Double_t *value, Double_t *derivative)
+{
+  Interpolate<Double_t>([tbOffset](Int_t k) { return tbOffset + k; }, n, value, derivative);
+}
 
-  file.close();
+void
+STPulse::PulseLanes(const Double_t *tbOffset, Int_t n, Double_t *value, Double_t *derivative)
+{
+  Interpolate<Double_t>([tbOffset](Int_t k) { return tbOffset[k]; }, n, value, derivative);
+}
+
+void
+STPulse::PulseBatch(Float_t tbOffset, Int_t n, Float_t *value, Float_t *derivative)
+{
+  Interpolate<Float_t>([tbOffset](Int_t k) { return tbOffset + k; }, n, value, derivative);
+}
+
+void
+STPulse::PulseLanes(const Float_t *tbOffset, Int_t n, Float_t *value, Float_t *derivative)
+{
+  Interpolate<Float_t>([tbOffset](Int_t k) { return tbOffset[k]; }, n, value, derivative);
 }
 
 Double_t 
 STPulse::Pulse(Double_t x, Double_t amp, Double_t tb0)
 {
+  Double_t value, derivative;
   Double_t tb = x - tb0;
-  if (tb < 0) 
-    return 0;
-
-  Int_t tbInStep = tb / fStepSize;
-
-  if (tbInStep > fNumDataPoints - 2) 
-    return 0;
+  Interpolate<Double_t>([tb](Int_t) { return tb; }, 1, &value, &derivative);
 
-  Double_t r = (tb / fStepSize) - tbInStep;
-  Double_t val = r * fPulseData[tbInStep + 1].fValue + (1 - r) * fPulseData[tbInStep].fValue;
-
-  return amp * val;
+  return amp * value;
 }
 
 Double_t 
 STPulse::PulseF1(Double_t *x, Double_t *par)
 {
-  Double_t tb = x[0] - par[1];
-  if (tb < 0) 
-    return 0;
-
-  Int_t tbInStep = tb / fStepSize;
-  if (tbInStep > fNumDataPoints - 2)
-    return 0;
-
-  Double_t r = (tb / fStepSize) - tbInStep;
-  Double_t val = r * fPulseData[tbInStep + 1].fValue + (1 - r) * fPulseData[tbInStep].fValue;
-
-  return par[0] * val;
+  return Pulse(x[0], par[0], par[1]);
 }
 
 TF1*
@@ -159,7 +167,11 @@ Double_t  STPulse::GetThresholdTbStep() { return fThresholdTbStep; }
    Int_t  STPulse::GetNumDataPoints()   { return fNumDataPoints;   }
 Double_t  STPulse::GetStepSize()        { return fStepSize;        }
 
-STSamplePoint **STPulse::GetPulseData()  { return &fPulseData; }
+STSamplePoint **STPulse::GetPulseData()
+{
+  Detach();
+  return &fPulseData;
+}
 
 void
 STPulse::Print()
@@ -180,6 +192,8 @@ STPulse::Print()
 void
 STPulse::SavePulseData(TString name, Bool_t smoothTail)
 {
+  Detach();
+
   Double_t max = 0;
   for (Int_t iData = 0; iData < fNumDataPoints; iData++) {
     if (fPulseData[iData].fValue > max)
@@ -214,6 +228,8 @@ STPulse::SavePulseData(TString name, Bool_t smoothTail)
       fPulseData[iData].fValue = fTailFunction -> Eval(iData * fStepSize);
   }
 
+  UpdateTable();
+
   ofstream file(name.Data());
   file << "#(shaping time) (number of data points) (step size) (rising tb threshold number) (default ndf)" << endl;
   file << fShapingTime << " " << fNumDataPoints << " " << fStepSize << " " << fNumAscending << " " << fNDFTbs << endl;
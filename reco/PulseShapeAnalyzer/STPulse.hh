@@ -6,6 +6,9 @@
 #include "STHit.hh"
 #include "STSamplePoint.hh"
 #include "TGraph.h"
+#include "STPulseTemplate.hh"
+
+#include <memory>
 
 class STPulse
 {
@@ -27,6 +30,42 @@ class STPulse
     /** Get Pulse value in x position with parameter (amp, tb0) */
     Double_t Pulse(Double_t x, Double_t amp, Double_t tb0);
 
+    /**
+     * Evaluate n samples of the unit-amplitude pulse at once.
+     * Sample k is at (tbOffset + k) time-buckets from the start of the pulse.
+     * value[k] is the pulse and derivative[k] is its derivative with respect
+     * to the starting time-bucket (tb0 of Pulse()), i.e. minus the slope.
+     * Same as calling Pulse(tbOffset + k, 1, 0) for each k, but reads
+     * the contiguous table built by UpdateTable() in one branch-free loop.
+     */
+    void PulseBatch(Double_t tbOffset, Int_t n, Double_t *value, Double_t *derivative);
+
+    /**
+     * Same as PulseBatch(), but sample k is at tbOffset[k] time-buckets from
+     * the start of the pulse. Used to evaluate one sample of several
+     * independent pulses (lanes) in one loop.
+     */
+    void PulseLanes(const Double_t *tbOffset, Int_t n, Double_t *value, Double_t *derivative);
+
+    /** Single precision versions of PulseBatch() and PulseLanes(), from float tables. */
+    void PulseBatch(Float_t tbOffset, Int_t n, Float_t *value, Float_t *derivative);
+    void PulseLanes(const Float_t *tbOffset, Int_t n, Float_t *value, Float_t *derivative);
+
+    /**
+     * PulseBatch() with the number of samples N fixed at compile time,
+     * for double or float tables. Defined inline below, so that the loop
+     * can be unrolled and vectorized together with the loop of the caller.
+     */
+    template <Int_t N, typename T>
+    void PulseBatch(T tbOffset, T *value, T *derivative);
+
+    /**
+     * Rebuild the table used by PulseBatch() from fPulseData.
+     * Called from SavePulseData(). Should be called again if pulse data is
+     * modified through GetPulseData().
+     */
+    void UpdateTable();
+
     /** Get Pulse with inialtial parameter (0,0) */
     TF1* GetPulseFunction(TString name = "");
 
@@ -42,34 +81,68 @@ class STPulse
        Int_t  GetNumDataPoints();
     Double_t  GetStepSize();
 
+    /**
+     * Pulse data can be modified through the returned pointer, so the data
+     * shared with other STPulse objects is copied first (see Detach()).
+     */
     STSamplePoint **GetPulseData();
 
     void Print();
 
+    /** False if the pulse data file could not be read. The pulse can not be used then. */
+    Bool_t IsGood() { return fTemplate != nullptr; }
+
     void SavePulseData(TString name, Bool_t smoothTail = true);
 
   private:
-    /** Initialize data and parameters. */
+    /** Initialize data and parameters from the shared template of fileName. */
     void Initialize(TString fileName);
 
+    /** Take parameters, data and tables from pulseTemplate. */
+    void SetTemplate(std::shared_ptr<const STPulseTemplate> pulseTemplate);
+
+    /**
+     * Make a private copy of the template before the data is modified,
+     * so that other STPulse objects sharing the template are not affected.
+     */
+    void Detach();
+
+    /** Tables of PulseBatch() in double or in float */
+    void GetTables(const Double_t *&value, const Double_t *&diff) const { value = fTableValue;  diff = fTableDiff; }
+    void GetTables(const Float_t *&value, const Float_t *&diff) const   { value = fTableValueF; diff = fTableDiffF; }
+
+    /**
+     * Table interpolation of all pulse evaluations (Pulse(), PulseF1(),
+     * PulseBatch() and PulseLanes()), in double or in float.
+     * offsetAt(k) is the time-bucket of sample k from the start of the pulse.
+     */
+    template <typename T, typename OffsetAt>
+    void Interpolate(OffsetAt offsetAt, Int_t n, T *value, T *derivative) const;
+
     /** A general C++ function object (functor) with parameters */
     Double_t PulseF1(Double_t *x, Double_t *par);
 
+    /** Template shared with other STPulse objects of the same file. */
+    std::shared_ptr<const STPulseTemplate> fTemplate; //!
+
+    /** Private copy of the template after Detach(). fTemplate points to the same. */
+    std::shared_ptr<STPulseTemplate> fOwnTemplate; //!
+
     /** The Pulse data points Will be updated as STPulse is initialized. */
-    STSamplePoint *fPulseData;
+    STSamplePoint *fPulseData = nullptr; //!
 
     /** Shaping time. */
-    Int_t fShapingTime;
+    Int_t fShapingTime = 0;
 
     /** Number of data points. Will be updated as STPulse is initialized. */
-    Int_t fNumDataPoints;
+    Int_t fNumDataPoints = 0;
 
     /** 
      * Step of data points in 1 time-bucket unit for current data file.
      * Should be smaller than 1.
      * The data points are parted by (fStepSize * [time-bucket]) from each other.
      */
-    Double_t fStepSize;
+    Double_t fStepSize = 0;
 
     /** Ratio height compare to peak height where pulse starts to rise **/
     Double_t fThresholdRatio = 0.05;
@@ -77,6 +150,18 @@ class STPulse
     /** Number of the pulse function(TF1*) created by this class */
     Int_t fNumF1 = 0;
 
+    /**
+     * Value and difference to the next data point of the pulse data,
+     * fTableValue[i] = fPulseData[i], fTableDiff[i] = fPulseData[i+1] - fPulseData[i].
+     * The last entry is 0 for both, so that index can be clamped instead of
+     * branching on the range. Owned by fTemplate.
+     */
+    const Double_t *fTableValue = nullptr; //!
+    const Double_t *fTableDiff = nullptr;  //!
+    Double_t fInvStepSize = 0;             //! 1/fStepSize
+    const Float_t *fTableValueF = nullptr; //! float copy of fTableValue
+    const Float_t *fTableDiffF = nullptr;  //! float copy of fTableDiff
+
   protected:
     /** 
      * Time-bucket at threshold-ratio of peak from start of the pulse.
@@ -110,7 +195,40 @@ class STPulse
 
     TGraph *fTailGraph = nullptr;
 
-  ClassDef(STPulse, 4)
+  ClassDef(STPulse, 5)
 };
 
+template <typename T, typename OffsetAt>
+inline void
+STPulse::Interpolate(OffsetAt offsetAt, Int_t n, T *value, T *derivative) const
+{
+  const T *tableValue;
+  const T *tableDiff;
+  GetTables(tableValue, tableDiff);
+
+  const Int_t last = fNumDataPoints - 1;
+  const T invStep = fInvStepSize;
+
+  for (Int_t k = 0; k < n; k++)
+  {
+    T tbInStep = offsetAt(k) * invStep;
+    Int_t iData = (Int_t) tbInStep;
+    T r = tbInStep - iData;
+
+    // before the start of the pulse and after the last data point, pulse is 0
+    T inRange = tbInStep < 0 ? 0 : 1;
+    iData = iData < 0 ? 0 : (iData > last ? last : iData);
+
+    value[k] = inRange * (tableValue[iData] + r * tableDiff[iData]);
+    derivative[k] = - inRange * tableDiff[iData] * invStep;
+  }
+}
+
+template <Int_t N, typename T>
+inline void
+STPulse::PulseBatch(T tbOffset, T *value, T *derivative)
+{
+  Interpolate<T>([tbOffset](Int_t k) { return tbOffset + k; }, N, value, derivative);
+}
+
 #endif
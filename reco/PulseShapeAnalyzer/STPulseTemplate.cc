@@ -0,0 +1,159 @@
+#include "STPulseTemplate.hh"
+#include "TSystem.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+using namespace std;
+
+std::map<std::string, std::shared_ptr<const STPulseTemplate>> STPulseTemplate::fRegistry;
+std::mutex STPulseTemplate::fRegistryMutex;
+
+std::shared_ptr<const STPulseTemplate>
+STPulseTemplate::Get(TString fileName)
+{
+  TString spiritroot = gSystem -> Getenv("VMCWORKDIR");
+  fileName = spiritroot + "/parameters/" + fileName;
+
+  // Shaping parameters are a part of the key, so a file written again
+  // with other shaping (e.g. by STPulse::SavePulseData()) is read again.
+  Int_t shapingTime = 0, numDataPoints = 0, numAscending = 0, ndfTbs = 0;
+  Double_t stepSize = 0;
+  {
+    ifstream file(fileName);
+    string line;
+    while (getline(file, line) && line.find("#") == 0) {}
+    istringstream ss(line);
+    ss >> shapingTime >> numDataPoints >> stepSize >> numAscending >> ndfTbs;
+  }
+  std::string key = Form("%s %d %d %.17g %d %d", fileName.Data(),
+      shapingTime, numDataPoints, stepSize, numAscending, ndfTbs);
+
+  std::lock_guard<std::mutex> lock(fRegistryMutex);
+
+  auto found = fRegistry.find(key);
+  if (found != fRegistry.end())
+    return found -> second;
+
+  auto pulseTemplate = std::make_shared<const STPulseTemplate>(fileName);
+  if (!pulseTemplate -> fIsGood) {
+    cout << "*** Pulse template could not be loaded: " << fileName << endl;
+    return nullptr;
+  }
+
+  fRegistry[key] = pulseTemplate;
+
+  return pulseTemplate;
+}
+
+STPulseTemplate::STPulseTemplate(TString fileName)
+{
+  ifstream file(fileName);
+  string line;
+
+  while (getline(file, line) && line.find("#") == 0) {}
+  istringstream ss(line);
+  ss >> fShapingTime >> fNumDataPoints >> fStepSize >> fNumAscending >> fNDFTbs;
+
+  if (fNumDataPoints < 20 || fStepSize > 1)
+  {
+    cout << "*** Error occured while initializing the pulse!" << endl;
+    cout << "*** Check file: " << fileName << endl;
+    return;
+  }
+
+  fPulseData = new STSamplePoint[fNumDataPoints];
+
+  Double_t max = 0;
+  for (Int_t iData = 0; iData < fNumDataPoints; iData++)
+  {
+    getline(file, line);
+    if (line.find("#") == 0) {
+      iData--;
+      continue;
+    }
+
+    fPulseData[iData].Init(line);
+    Double_t value = fPulseData[iData].fValue;
+
+    if (value > max) {
+      max = value;
+      fTbAtMax = iData * fStepSize;
+    }
+  }
+
+  Double_t c = 1/max;
+  Double_t valuePre = 0, valueCur = 0;
+  fTbAtThreshold = 0;
+  fTbAtTail = 0;
+
+  for (Int_t iData = 0; iData < fNumDataPoints; iData++)
+  {
+    fPulseData[iData].fValue = c * fPulseData[iData].fValue;
+
+    valuePre = valueCur;
+    valueCur = fPulseData[iData].fValue;
+
+    if (fTbAtThreshold == 0 && valueCur > fThresholdRatio)
+    {
+      fTbAtThreshold = iData * fStepSize;
+      Int_t next = iData + 1/fStepSize;
+      fThresholdTbStep = fPulseData[next].fValue - fPulseData[iData].fValue;
+    }
+
+    if (fTbAtTail == 0 && valueCur < valuePre && valueCur < 0.1)
+      fTbAtTail = iData * fStepSize;
+  }
+
+  file.close();
+
+  UpdateTable();
+
+  fIsGood = kTRUE;
+}
+
+STPulseTemplate::STPulseTemplate(const STPulseTemplate &pulseTemplate)
+: fIsGood(pulseTemplate.fIsGood),
+  fShapingTime(pulseTemplate.fShapingTime),
+  fNumDataPoints(pulseTemplate.fNumDataPoints),
+  fStepSize(pulseTemplate.fStepSize),
+  fNumAscending(pulseTemplate.fNumAscending),
+  fNDFTbs(pulseTemplate.fNDFTbs),
+  fThresholdRatio(pulseTemplate.fThresholdRatio),
+  fTbAtThreshold(pulseTemplate.fTbAtThreshold),
+  fTbAtTail(pulseTemplate.fTbAtTail),
+  fTbAtMax(pulseTemplate.fTbAtMax),
+  fThresholdTbStep(pulseTemplate.fThresholdTbStep),
+  fTableValue(pulseTemplate.fTableValue),
+  fTableDiff(pulseTemplate.fTableDiff),
+  fInvStepSize(pulseTemplate.fInvStepSize),
+  fTableValueF(pulseTemplate.fTableValueF),
+  fTableDiffF(pulseTemplate.fTableDiffF)
+{
+  if (pulseTemplate.fPulseData != nullptr) {
+    fPulseData = new STSamplePoint[fNumDataPoints];
+    for (Int_t iData = 0; iData < fNumDataPoints; iData++)
+      fPulseData[iData] = pulseTemplate.fPulseData[iData];
+  }
+}
+
+STPulseTemplate::~STPulseTemplate()
+{
+  delete [] fPulseData;
+}
+
+void
+STPulseTemplate::UpdateTable()
+{
+  fInvStepSize = 1./fStepSize;
+
+  fTableValue.assign(fNumDataPoints, 0);
+  fTableDiff.assign(fNumDataPoints, 0);
+
+  for (Int_t iData = 0; iData < fNumDataPoints - 1; iData++) {
+    fTableValue[iData] = fPulseData[iData].fValue;
+    fTableDiff[iData] = fPulseData[iData + 1].fValue - fPulseData[iData].fValue;
+  }
+
+  fTableValueF.assign(fTableValue.begin(), fTableValue.end());
+  fTableDiffF.assign(fTableDiff.begin(), fTableDiff.end());
+}
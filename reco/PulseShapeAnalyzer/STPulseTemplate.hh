@@ -0,0 +1,76 @@
+#ifndef STPULSETEMPLATE
+#define STPULSETEMPLATE
+
+#include "Rtypes.h"
+#include "TString.h"
+#include "STSamplePoint.hh"
+
+#include <vector>
+#include <map>
+#include <string>
+#include <memory>
+#include <mutex>
+
+/**
+ * Pulse data of one pulser file, loaded and prepared once per process.
+ *
+ * STPulse::Initialize() takes the template from Get(), so all STPulse
+ * objects (PSA of every thread, electronics task, event display, ...)
+ * made from the same file share one read-only copy of the data and the
+ * tables of STPulse::PulseBatch(), and the file is parsed only once.
+ *
+ * Templates given by Get() must not be modified. STPulse makes a private
+ * copy before it changes the data (SavePulseData(), GetPulseData()).
+ */
+class STPulseTemplate
+{
+  public:
+    /**
+     * Return the template of pulser file fileName in $VMCWORKDIR/parameters/.
+     * The file is read at the first call and the same template is returned
+     * afterwards, as long as the shaping parameters in the first line of the
+     * file (shaping time, number of points, step size, ...) are the same.
+     * Changes of the data points only are not seen. Returns nullptr if the file could not be read; the file
+     * is then read again at the next call. Thread-safe.
+     */
+    static std::shared_ptr<const STPulseTemplate> Get(TString fileName);
+
+    /** Read and normalize pulse data from full path fileName */
+    STPulseTemplate(TString fileName);
+    STPulseTemplate(const STPulseTemplate &pulseTemplate);
+    ~STPulseTemplate();
+
+    /** Rebuild fTableValue and fTableDiff (and the float copies) from fPulseData */
+    void UpdateTable();
+
+    Bool_t fIsGood = kFALSE;
+
+    Int_t fShapingTime = 0;
+    Int_t fNumDataPoints = 0;
+    Double_t fStepSize = 0;
+    Int_t fNumAscending = 0;
+    Int_t fNDFTbs = 0;
+
+    Double_t fThresholdRatio = 0.05;
+    Double_t fTbAtThreshold = 0;
+    Double_t fTbAtTail = 0;
+    Double_t fTbAtMax = 0;
+    Double_t fThresholdTbStep = 0;
+
+    STSamplePoint *fPulseData = nullptr; ///< normalized to 1 at the peak
+
+    /** See STPulse::PulseBatch() */
+    std::vector<Double_t> fTableValue;
+    std::vector<Double_t> fTableDiff;
+    Double_t fInvStepSize = 0;
+
+    /** Single precision copies of the tables for the float PSA path */
+    std::vector<Float_t> fTableValueF;
+    std::vector<Float_t> fTableDiffF;
+
+  private:
+    static std::map<std::string, std::shared_ptr<const STPulseTemplate>> fRegistry;
+    static std::mutex fRegistryMutex;
+};
+
+#endif
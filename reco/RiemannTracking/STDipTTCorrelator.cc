@@ -24,6 +24,16 @@ STDipTTCorrelator::STDipTTCorrelator(Double_t proxcut, Double_t dipcut, Double_t
   fProxCut = proxcut;
   fDipCut = dipcut;
   fHelixCut = helixcut;
+
+#ifdef DEBUGRIEMANNCUTS
+  STDebugLogger *logger = STDebugLogger::Instance();
+  fHistDipFail   = logger -> RegisterHist1Step("dip_fail",200,0,200);
+  fHistDip       = logger -> RegisterHist1("dip",100,0,20);
+  fHistProxFail  = logger -> RegisterHist1Step("proxT_fail",200,0,200);
+  fHistProx      = logger -> RegisterHist1("proxT",100,0,20);
+  fHistHelixFail = logger -> RegisterHist1Step("helixT_fail",200,0,200);
+  fHistHelix     = logger -> RegisterHist1("helixT",100,0,20);
+#endif
 }
 
 
@@ -58,19 +68,21 @@ STDipTTCorrelator::Correlate(STRiemannTrack* track1,
     if (phiDiff2 < phiDiff1) phiDiff1 = phiDiff2;
 
 #ifdef SUBTASK_RIEMANN
-    STDebugLogger::InstanceX() -> Print("DipTT", 
-      Form("phi diff: %f, dip cut: %f", phiDiff1, fDipCut*scaling));
+    if (STDebugLogger::InstanceX() -> IsEnabled()) {
+      STDebugLogger::InstanceX() -> Print("DipTT", 
+        Form("phi diff: %f, dip cut: %f", phiDiff1, fDipCut*scaling));
+    }
 #endif
     if (phiDiff1 > fDipCut*scaling) 
     {
       survive = kFALSE;
 #ifdef DEBUGRIEMANNCUTS
-      STDebugLogger::Instance() -> FillHist1Step("dip_fail",phiDiff1,200,0,200);
+      STDebugLogger::Instance() -> Fill1Step(fHistDipFail,phiDiff1);
 #endif
       return kTRUE;
     }
 #ifdef DEBUGRIEMANNCUTS
-    STDebugLogger::Instance() -> FillHist1("dip",phiDiff1,100,0,20);
+    STDebugLogger::Instance() -> Fill1(fHistDip,phiDiff1);
 #endif
   }
 
@@ -93,20 +105,22 @@ STDipTTCorrelator::Correlate(STRiemannTrack* track1,
   if (d112n < dist) {dist = d112n; back1 = kFALSE; back2 = kTRUE;}
 
 #ifdef SUBTASK_RIEMANN
-  STDebugLogger::InstanceX() -> Print("DipTT", 
-    Form("prox: %f, prox cut: %f", dist, fProxCut));
+  if (STDebugLogger::InstanceX() -> IsEnabled()) {
+    STDebugLogger::InstanceX() -> Print("DipTT", 
+      Form("prox: %f, prox cut: %f", dist, fProxCut));
+  }
 #endif
   // check proximity
   if (dist > fProxCut) 
   {
     survive = kFALSE;
 #ifdef DEBUGRIEMANNCUTS
-    STDebugLogger::Instance() -> FillHist1Step("proxT_fail",dist,200,0,200);
+    STDebugLogger::Instance() -> Fill1Step(fHistProxFail,dist);
 #endif
     return kTRUE;
   }
 #ifdef DEBUGRIEMANNCUTS
-  STDebugLogger::Instance() -> FillHist1("proxT",dist,100,0,20);
+  STDebugLogger::Instance() -> Fill1(fHistProx,dist);
 #endif
 
   if (track2 -> IsFitted()) 
@@ -137,18 +151,20 @@ STDipTTCorrelator::Correlate(STRiemannTrack* track1,
 
 
 #ifdef SUBTASK_RIEMANN
-  STDebugLogger::InstanceX() -> Print("DipTT", 
-    Form("dist: %f, helix cut: %f", hDist, fHelixCut*scaling));
+  if (STDebugLogger::InstanceX() -> IsEnabled()) {
+    STDebugLogger::InstanceX() -> Print("DipTT", 
+      Form("dist: %f, helix cut: %f", hDist, fHelixCut*scaling));
+  }
 #endif
     if (hDist > fHelixCut*scaling) {
       survive = kFALSE;
 #ifdef DEBUGRIEMANNCUTS
-      STDebugLogger::Instance() -> FillHist1Step("helixT_fail",hDist,200,0,200);
+      STDebugLogger::Instance() -> Fill1Step(fHistHelixFail,hDist);
 #endif
       return kTRUE;
     }
 #ifdef DEBUGRIEMANNCUTS
-    STDebugLogger::Instance() -> FillHist1("helixT",hDist,100,0,20);
+    STDebugLogger::Instance() -> Fill1(fHistHelix,hDist);
 #endif
 
     survive = kTRUE;
@@ -171,8 +187,10 @@ STDipTTCorrelator::Correlate(STRiemannTrack* track1,
   matchQuality = maxhDist;
 
 #ifdef SUBTASK_RIEMANN
-  STDebugLogger::InstanceX() -> Print("DipTT", 
-    Form("max dist: %f, helix cut: %f", maxhDist, fHelixCut));
+  if (STDebugLogger::InstanceX() -> IsEnabled()) {
+    STDebugLogger::InstanceX() -> Print("DipTT", 
+      Form("max dist: %f, helix cut: %f", maxhDist, fHelixCut));
+  }
 #endif
   if (maxhDist > fHelixCut) 
   {
@@ -27,6 +27,14 @@ class STDipTTCorrelator : public STAbsTrackTrackCorrelator
     Double_t fProxCut;
     Double_t fDipCut;
     Double_t fHelixCut;
+
+    /// STDebugLogger handles, registered only with DEBUGRIEMANNCUTS
+    Int_t fHistDipFail = -1;
+    Int_t fHistDip = -1;
+    Int_t fHistProxFail = -1;
+    Int_t fHistProx = -1;
+    Int_t fHistHelixFail = -1;
+    Int_t fHistHelix = -1;
 };
 
 #endif
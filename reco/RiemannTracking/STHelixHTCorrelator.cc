@@ -22,6 +22,12 @@
 STHelixHTCorrelator::STHelixHTCorrelator(Double_t hdistcut)
 {
   fHDistCut = hdistcut;
+
+#ifdef DEBUGRIEMANNCUTS
+  STDebugLogger *logger = STDebugLogger::Instance();
+  fHistHelixFail = logger -> RegisterHist1Step("helix_fail", 1000, 0, 1000);
+  fHistHelix     = logger -> RegisterHist1("helix", 100, 0, 20);
+#endif
 }
 
 Bool_t
@@ -42,12 +48,12 @@ STHelixHTCorrelator::Correlate(STRiemannTrack *track, STRiemannHit *rhit, Bool_t
   {
     survive = kFALSE;
 #ifdef DEBUGRIEMANNCUTS
-  STDebugLogger::Instance() -> FillHist1Step("helix_fail", distHelix, 1000, 0, 1000);
+  STDebugLogger::Instance() -> Fill1Step(fHistHelixFail, distHelix);
 #endif
     return kTRUE;
   }
 #ifdef DEBUGRIEMANNCUTS
-  STDebugLogger::Instance() -> FillHist1("helix", distHelix, 100, 0, 20);
+  STDebugLogger::Instance() -> Fill1(fHistHelix, distHelix);
 #endif
 
   survive = kTRUE;
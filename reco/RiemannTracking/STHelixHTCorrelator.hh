@@ -24,6 +24,10 @@ class STHelixHTCorrelator : public STAbsHitTrackCorrelator
 
   private:
     Double_t fHDistCut;
+
+    /// STDebugLogger handles, registered only with DEBUGRIEMANNCUTS
+    Int_t fHistHelixFail = -1;
+    Int_t fHistHelix = -1;
 };
 
 #endif
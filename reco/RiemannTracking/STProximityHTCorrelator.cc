@@ -25,6 +25,19 @@ STProximityHTCorrelator::STProximityHTCorrelator(Double_t cut, Double_t zStretch
   fZStretch = zStretch;
   fMeanDist = 2.0;
   fHelixCut = 2.*helixcut;
+
+#ifdef DEBUGRIEMANNCUTS
+  STDebugLogger *logger = STDebugLogger::Instance();
+  fHistPerp       = logger -> RegisterHist1Step("perp",200,0,200);
+  fHistRadius     = logger -> RegisterHist1Step("radius",200,0,200);
+  fHistDiff       = logger -> RegisterHist1Step("diff",200,0,200);
+  fHistHelixFail  = logger -> RegisterHist1Step("helixC_fail",10000,0,1000);
+  fHistHelix      = logger -> RegisterHist1("helixC",100,0,20);
+  fHistHelixStep  = logger -> RegisterHist1Step("helixC_step",1000,0,1000);
+  fHistProx       = logger -> RegisterHist1("prox",100,0,30);
+  fHistProxStep   = logger -> RegisterHist1Step("prox_step",1000,0,1000);
+  fHistProxFail   = logger -> RegisterHist1Step("prox_fail",1000,0,1000);
+#endif
 }
 
 Bool_t
@@ -49,22 +62,22 @@ STProximityHTCorrelator::Correlate(STRiemannTrack *track,
   {
     Double_t circDist = TMath::Abs((posX - track -> GetCenter()).Perp() - track -> GetR());
 #ifdef DEBUGRIEMANNCUTS
-    STDebugLogger::Instance() -> FillHist1Step("perp",(posX - track -> GetCenter()).Perp(),200,0,200);
-    STDebugLogger::Instance() -> FillHist1Step("radius",track -> GetR(),200,0,200);
-    STDebugLogger::Instance() -> FillHist1Step("diff",circDist,200,0,200);
+    STDebugLogger::Instance() -> Fill1Step(fHistPerp,(posX - track -> GetCenter()).Perp());
+    STDebugLogger::Instance() -> Fill1Step(fHistRadius,track -> GetR());
+    STDebugLogger::Instance() -> Fill1Step(fHistDiff,circDist);
 #endif
 
     if (circDist > fHelixCut) {
       matchQuality = circDist;
       survive = kFALSE;
 #ifdef DEBUGRIEMANNCUTS
-      STDebugLogger::Instance() -> FillHist1Step("helixC_fail",circDist,10000,0,1000);
+      STDebugLogger::Instance() -> Fill1Step(fHistHelixFail,circDist);
 #endif
       return kTRUE;
     }
 #ifdef DEBUGRIEMANNCUTS
-    STDebugLogger::Instance() -> FillHist1("helixC",circDist,100,0,20);
-    STDebugLogger::Instance() -> FillHist1Step("helixC_step",circDist,1000,0,1000);
+    STDebugLogger::Instance() -> Fill1(fHistHelix,circDist);
+    STDebugLogger::Instance() -> Fill1Step(fHistHelixStep,circDist);
 #endif
   }
 
@@ -108,12 +121,12 @@ STProximityHTCorrelator::Correlate(STRiemannTrack *track,
       break;
   }
 #ifdef DEBUGRIEMANNCUTS
-  STDebugLogger::Instance() -> FillHist1("prox",disMin,100,0,30);
-  STDebugLogger::Instance() -> FillHist1Step("prox_step",disMin,1000,0,1000);
+  STDebugLogger::Instance() -> Fill1(fHistProx,disMin);
+  STDebugLogger::Instance() -> Fill1Step(fHistProxStep,disMin);
   if (survive_debug == kTRUE)
     return kTRUE;
   else
-    STDebugLogger::Instance() -> FillHist1Step("prox_fail",disMin,1000,0,1000);
+    STDebugLogger::Instance() -> Fill1Step(fHistProxFail,disMin);
 #endif
 
   // The hit (numHits = 1), resp. both hits  (numHits = 2) have been checked and did not survive
@@ -27,6 +27,17 @@ class STProximityHTCorrelator : public STAbsHitTrackCorrelator
     Double_t fZStretch;
     Double_t fMeanDist; ///< mean distance between hits in track
     Double_t fHelixCut; ///< for fast approximation
+
+    /// STDebugLogger handles, registered only with DEBUGRIEMANNCUTS
+    Int_t fHistPerp = -1;
+    Int_t fHistRadius = -1;
+    Int_t fHistDiff = -1;
+    Int_t fHistHelixFail = -1;
+    Int_t fHistHelix = -1;
+    Int_t fHistHelixStep = -1;
+    Int_t fHistProx = -1;
+    Int_t fHistProxStep = -1;
+    Int_t fHistProxFail = -1;
 };
 
 #endif
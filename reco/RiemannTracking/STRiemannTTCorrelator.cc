@@ -22,6 +22,12 @@ STRiemannTTCorrelator::STRiemannTTCorrelator(Double_t planecut, Int_t minHitsFor
 {
   fPlaneCut = planecut;
   fMinHitsForFit = minHitsForFit;
+
+#ifdef DEBUGRIEMANNCUTS
+  STDebugLogger *logger = STDebugLogger::Instance();
+  fHistPlaneFail = logger -> RegisterHist1Step("plane_fail",200,0,200);
+  fHistPlane     = logger -> RegisterHist1("plane",200,0,20);
+#endif
 }
 
 Bool_t
@@ -69,23 +75,25 @@ STRiemannTTCorrelator::Correlate(STRiemannTrack *track1,
   matchQuality = rms;
 
 #ifdef SUBTASK_RIEMANN
-  STDebugLogger::InstanceX() -> Print("RiemannTT", 
-    Form("rms: %f, plane cut: %f", rms, fPlaneCut*scaling));
-  STDebugLogger::InstanceX() -> Print("RiemannTT", 
-    Form("track-1 rms: %f", track1 -> DistRMS()));
-  STDebugLogger::InstanceX() -> Print("RiemannTT", 
-    Form("track-2 rms: %f", track2 -> DistRMS()));
+  if (STDebugLogger::InstanceX() -> IsEnabled()) {
+    STDebugLogger::InstanceX() -> Print("RiemannTT", 
+      Form("rms: %f, plane cut: %f", rms, fPlaneCut*scaling));
+    STDebugLogger::InstanceX() -> Print("RiemannTT", 
+      Form("track-1 rms: %f", track1 -> DistRMS()));
+    STDebugLogger::InstanceX() -> Print("RiemannTT", 
+      Form("track-2 rms: %f", track2 -> DistRMS()));
+  }
 #endif
   if (rms > fPlaneCut*scaling) 
   {
     survive = kFALSE;
 #ifdef DEBUGRIEMANNCUTS
-    STDebugLogger::Instance() -> FillHist1Step("plane_fail",rms,200,0,200);
+    STDebugLogger::Instance() -> Fill1Step(fHistPlaneFail,rms);
 #endif
     return kTRUE;
   }
 #ifdef DEBUGRIEMANNCUTS
-  STDebugLogger::Instance() -> FillHist1("plane",rms,200,0,20);
+  STDebugLogger::Instance() -> Fill1(fHistPlane,rms);
 #endif
 
   survive = kTRUE;
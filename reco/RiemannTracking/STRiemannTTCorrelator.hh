@@ -25,6 +25,10 @@ class STRiemannTTCorrelator : public STAbsTrackTrackCorrelator
   private:
     Double_t fPlaneCut;
     Int_t fMinHitsForFit;
+
+    /// STDebugLogger handles, registered only with DEBUGRIEMANNCUTS
+    Int_t fHistPlaneFail = -1;
+    Int_t fHistPlane = -1;
 };
 
 #endif
@@ -52,6 +52,7 @@ STDecoderTask::STDecoderTask()
   fIsSeparatedData = kFALSE;
 
   fEventID = -1;
+  fIsEndOfData = kFALSE;
 }
 
 STDecoderTask::~STDecoderTask()
@@ -224,6 +225,31 @@ STDecoderTask::ReadEvent(Int_t eventID)
   return 0;
 }
 
+Bool_t
+STDecoderTask::ReadNextEvent(TClonesArray *rawEventArray)
+{
+  if (fIsEndOfData)
+    return kFALSE;
+
+  if (fRawEvent == NULL)
+    fRawEvent = fDecoder -> GetRawEvent(fEventID++);
+
+  if (fRawEvent == NULL) {
+    fIsEndOfData = kTRUE;
+    return kFALSE;
+  }
+
+  rawEventArray -> Delete();
+  new ((*rawEventArray)[0]) STRawEvent(fRawEvent);
+  fEventIDLast = fDecoder -> GetEventID();
+
+  // Same as FinishEvent(): look ahead so that the end of data is known in advance.
+  fRawEvent = fDecoder -> GetRawEvent();
+  if (fRawEvent == NULL)
+    fIsEndOfData = kTRUE;
+
+  return kTRUE;
+}
 
 void
 STDecoderTask::FinishEvent()
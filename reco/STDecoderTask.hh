@@ -91,6 +91,13 @@ class STDecoderTask : public FairTask {
     /// Read event for STSource
     Int_t ReadEvent(Int_t eventID);
 
+    /**
+     * Decode next event into given array, without going through FairRun.
+     * Used when the decoder is driven by STEventParallelTask.
+     * Return false when there is no more event.
+     */
+    Bool_t ReadNextEvent(TClonesArray *rawEventArray);
+
   private:
     FairLogger *fLogger;                ///< FairLogger singleton
 
@@ -124,6 +131,7 @@ class STDecoderTask : public FairTask {
 
     Long64_t fEventIDLast;              ///< Last event ID 
     Long64_t fEventID;                  ///< Event ID for STSource
+    Bool_t fIsEndOfData;                ///< Set when ReadNextEvent() reached the end
 
   ClassDef(STDecoderTask, 1);
 };
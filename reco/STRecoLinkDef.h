@@ -16,6 +16,7 @@
 #pragma link C++ class STMCTruthTask+;
 #pragma link C++ class STPIDCorrelatorTask+;
 #pragma link C++ class STRiemannToHelixTask+;
+#pragma link C++ class STEventParallelTask+;
 
 #pragma link C++ class GETDecoder+;
 #pragma link C++ class GETFrameInfo+;
@@ -92,6 +93,7 @@
 #pragma link C++ class STGenfitSinglePIDTask+;
 
 #pragma link C++ class STSource+;
+#pragma link C++ class STRunSplitter+;
 
 #pragma link C++ class STHelixTrackFinder+;
 
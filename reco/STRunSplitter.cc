@@ -0,0 +1,332 @@
+//-----------------------------------------------------------
+// Description:
+//   Splitting one run into several reconstruction processes
+//   and merging their outputs
+//
+// Environment:
+//   Software developed for the SPiRIT-TPC at RIKEN
+//-----------------------------------------------------------
+
+#include "STRunSplitter.hh"
+#include "STRecoHeader.hh"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TSystem.h"
+#include "TFileMerger.h"
+#include "TStopwatch.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+#include <thread>
+#include <atomic>
+
+using namespace std;
+
+ClassImp(STRunSplitter)
+
+STRunSplitter::STRunSplitter()
+{
+}
+
+STRunSplitter::STRunSplitter(Int_t runNo)
+: fRunNo(runNo)
+{
+}
+
+void STRunSplitter::SetRunNo(Int_t runNo)                    { fRunNo = runNo; }
+void STRunSplitter::SetMetaData(TString filename, Int_t coboIdx) { fMetaData[coboIdx] = filename; }
+void STRunSplitter::SetNumEvents(Int_t numEvents)            { fNumEvents = numEvents; }
+void STRunSplitter::SetNumWorkers(Int_t numWorkers)          { fNumWorkers = numWorkers; }
+void STRunSplitter::SetNumSplits(Int_t numSplits)            { fNumSplits = numSplits; }
+void STRunSplitter::SetWorkerCommand(TString command)        { fWorkerCommand = command; }
+void STRunSplitter::SetWorkerOutput(TString output)          { fWorkerOutput = output; }
+void STRunSplitter::SetWorkerLog(TString log)                { fWorkerLog = log; }
+void STRunSplitter::SetMergedOutput(TString output)          { fMergedOutput = output; }
+void STRunSplitter::SetKeepSplitOutput(Bool_t val)           { fKeepSplitOutput = val; }
+
+Int_t STRunSplitter::GetNumSplits()                  { return fSplitStart.size(); }
+Int_t STRunSplitter::GetSplitStart(Int_t iSplit)     { return fSplitStart.at(iSplit); }
+Int_t STRunSplitter::GetSplitNumEvents(Int_t iSplit) { return fSplitNumEvents.at(iSplit); }
+
+void STRunSplitter::SetMetaDataList(TString listFile, TString dir)
+{
+  std::ifstream metaList(listFile.Data());
+  if (!metaList.is_open()) {
+    cout << "== [STRunSplitter] Cannot open meta data list " << listFile << endl;
+    return;
+  }
+
+  TString filename;
+  for (Int_t iCobo = 0; iCobo < 12; iCobo++) {
+    if (!filename.ReadLine(metaList))
+      break;
+    fMetaData[iCobo] = dir.IsNull() ? filename : dir + "/" + filename;
+  }
+}
+
+Bool_t STRunSplitter::MakeSplits()
+{
+  fSplitStart.clear();
+  fSplitNumEvents.clear();
+  fSplitSize.clear();
+
+  if (fNumWorkers < 1)
+    fNumWorkers = 1;
+  Int_t numSplits = fNumSplits > 0 ? fNumSplits : fNumWorkers;
+
+  // Size of each event summed over all CoBos. Events missing in one of the CoBos are not used.
+  std::vector<Double_t> eventSize;
+  Bool_t hasMetaData = kFALSE;
+  for (Int_t iCobo = 0; iCobo < 12; iCobo++)
+  {
+    if (fMetaData[iCobo].IsNull())
+      continue;
+
+    TFile file(fMetaData[iCobo], "read");
+    TTree *tree = file.IsZombie() ? nullptr : (TTree *) file.Get("MetaData");
+    if (tree == nullptr) {
+      cout << "== [STRunSplitter] Cannot read meta data " << fMetaData[iCobo] << endl;
+      return kFALSE;
+    }
+
+    ULong64_t startByte = 0, endByte = 0;
+    tree -> SetBranchStatus("*", 0);
+    tree -> SetBranchStatus("startByte", 1);
+    tree -> SetBranchStatus("endByte", 1);
+    tree -> SetBranchAddress("startByte", &startByte);
+    tree -> SetBranchAddress("endByte", &endByte);
+
+    Long64_t numEntries = tree -> GetEntries();
+    if (!hasMetaData)
+      eventSize.assign(numEntries, 0);
+    else if (numEntries < eventSize.size())
+      eventSize.resize(numEntries);
+
+    for (Long64_t iEntry = 0; iEntry < eventSize.size(); iEntry++) {
+      tree -> GetEntry(iEntry);
+      eventSize[iEntry] += endByte - startByte;
+    }
+
+    hasMetaData = kTRUE;
+  }
+
+  if (!hasMetaData) {
+    if (fNumEvents < 0) {
+      cout << "== [STRunSplitter] Neither meta data nor number of events is set!" << endl;
+      return kFALSE;
+    }
+    // Without frame index, all events are assumed to be the same size.
+    eventSize.assign(fNumEvents, 1);
+  }
+
+  if (fNumEvents >= 0 && fNumEvents < eventSize.size())
+    eventSize.resize(fNumEvents);
+
+  Int_t numEvents = eventSize.size();
+  if (numEvents == 0) {
+    cout << "== [STRunSplitter] No event to process!" << endl;
+    return kFALSE;
+  }
+  if (numSplits > numEvents)
+    numSplits = numEvents;
+
+  Double_t totalSize = 0;
+  for (auto size : eventSize)
+    totalSize += size;
+
+  // Cut where the cumulative size passes k/numSplits of the total.
+  Int_t start = 0;
+  Double_t cumulative = 0, splitSize = 0;
+  for (Int_t iEvent = 0; iEvent < numEvents; iEvent++)
+  {
+    cumulative += eventSize[iEvent];
+    splitSize += eventSize[iEvent];
+
+    Int_t iSplit = fSplitStart.size();
+    Int_t numEventsLeft = numEvents - iEvent - 1;
+    Int_t numSplitsLeft = numSplits - iSplit - 1;
+
+    Bool_t cut = cumulative >= totalSize * (iSplit + 1) / numSplits;
+    if (numEventsLeft <= numSplitsLeft) // every split has at least one event
+      cut = kTRUE;
+    if (numSplitsLeft == 0)
+      cut = (iEvent == numEvents - 1);
+
+    if (cut) {
+      fSplitStart.push_back(start);
+      fSplitNumEvents.push_back(iEvent + 1 - start);
+      fSplitSize.push_back(splitSize);
+      start = iEvent + 1;
+      splitSize = 0;
+    }
+  }
+
+  return kTRUE;
+}
+
+TString STRunSplitter::Replace(TString pattern, Int_t iSplit)
+{
+  Int_t numEventsInRun = fSplitStart.back() + fSplitNumEvents.back();
+
+  pattern.ReplaceAll("%RUN%",      Form("%d", fRunNo));
+  pattern.ReplaceAll("%SPLIT%",    Form("%d", iSplit));
+  pattern.ReplaceAll("%START%",    Form("%d", fSplitStart[iSplit]));
+  pattern.ReplaceAll("%NUM%",      Form("%d", fSplitNumEvents[iSplit]));
+  pattern.ReplaceAll("%NUMINRUN%", Form("%d", numEventsInRun));
+
+  return pattern;
+}
+
+Bool_t STRunSplitter::Run()
+{
+  if (fWorkerCommand.IsNull() || fWorkerOutput.IsNull() || fMergedOutput.IsNull()) {
+    cout << "== [STRunSplitter] Worker command, worker output and merged output should be set!" << endl;
+    return kFALSE;
+  }
+
+  if (fSplitStart.empty() && !MakeSplits())
+    return kFALSE;
+
+  Print();
+
+  TStopwatch timer;
+
+  Int_t numSplits = GetNumSplits();
+  std::vector<Int_t> exitCodes(numSplits, -1);
+  std::atomic<Int_t> nextSplit(0);
+
+  auto Worker = [&]() {
+    while (1) {
+      Int_t iSplit = nextSplit++;
+      if (iSplit >= numSplits)
+        break;
+
+      TString command = Replace(fWorkerCommand, iSplit);
+      if (!fWorkerLog.IsNull())
+        command += " > " + Replace(fWorkerLog, iSplit) + " 2>&1";
+
+      // std::system rather than gSystem -> Exec, since this runs in several threads.
+      exitCodes[iSplit] = std::system(command.Data());
+    }
+  };
+
+  Int_t numWorkers = fNumWorkers < numSplits ? fNumWorkers : numSplits;
+  std::vector<std::thread> workers;
+  for (Int_t iWorker = 0; iWorker < numWorkers; iWorker++)
+    workers.push_back(std::thread(Worker));
+  for (auto &worker : workers)
+    worker.join();
+
+  Bool_t isGood = kTRUE;
+  for (Int_t iSplit = 0; iSplit < numSplits; iSplit++) {
+    if (exitCodes[iSplit] != 0) {
+      cout << "== [STRunSplitter] Split " << iSplit << " failed with exit code " << exitCodes[iSplit] << ": " << Replace(fWorkerCommand, iSplit) << endl;
+      isGood = kFALSE;
+    }
+  }
+
+  cout << "== [STRunSplitter] Reconstruction took " << timer.RealTime() << " s" << endl;
+  timer.Start();
+
+  if (!isGood)
+    return kFALSE;
+
+  if (!Merge())
+    return kFALSE;
+
+  cout << "== [STRunSplitter] Merging took " << timer.RealTime() << " s" << endl;
+  cout << "== [STRunSplitter] Output : " << fMergedOutput << endl;
+
+  return kTRUE;
+}
+
+Bool_t STRunSplitter::Merge()
+{
+  Int_t numSplits = GetNumSplits();
+  if (numSplits == 0)
+    return kFALSE;
+
+  TFileMerger merger(kFALSE);
+  merger.SetPrintLevel(0);
+  if (!merger.OutputFile(fMergedOutput, "RECREATE"))
+    return kFALSE;
+
+  STRecoHeader *recoHeader = nullptr;
+  for (Int_t iSplit = 0; iSplit < numSplits; iSplit++)
+  {
+    TString output = Replace(fWorkerOutput, iSplit);
+    if (!merger.AddFile(output, kFALSE)) {
+      cout << "== [STRunSplitter] Cannot open " << output << endl;
+      delete recoHeader;
+      return kFALSE;
+    }
+
+    TFile file(output, "read");
+    auto header = (STRecoHeader *) file.Get("RecoHeader");
+    if (header == nullptr)
+      continue;
+
+    if (recoHeader == nullptr)
+      recoHeader = (STRecoHeader *) header -> Clone();
+    else if (header -> GetParList() -> FindObject("version") != nullptr
+          && recoHeader -> GetParString("version") != header -> GetParString("version"))
+      cout << "== [STRunSplitter] Split " << iSplit << " has different version: " << header -> GetParString("version") << endl;
+
+    delete header;
+  }
+
+  // Files are merged in the order they are added, which is the order of the events.
+  // RecoHeader of each split is not merged; one header of the whole range is written below.
+  merger.AddObjectNames("RecoHeader");
+  if (!merger.PartialMerge(TFileMerger::kAll | TFileMerger::kRegular | TFileMerger::kSkipListed)) {
+    cout << "== [STRunSplitter] Merging failed!" << endl;
+    delete recoHeader;
+    return kFALSE;
+  }
+
+  if (recoHeader != nullptr)
+  {
+    TList *parList = recoHeader -> GetParList();
+    for (TString name : {"eventStart", "numEvents", "numSplits"}) {
+      TObject *par = parList -> FindObject(name);
+      if (par != nullptr) {
+        parList -> Remove(par);
+        delete par;
+      }
+    }
+
+    Int_t numEvents = 0;
+    for (auto num : fSplitNumEvents)
+      numEvents += num;
+
+    recoHeader -> SetPar("eventStart", fSplitStart.front());
+    recoHeader -> SetPar("numEvents", numEvents);
+    recoHeader -> SetPar("numSplits", numSplits);
+
+    TFile file(fMergedOutput, "update");
+    recoHeader -> Write("RecoHeader", TObject::kWriteDelete);
+    file.Close();
+
+    delete recoHeader;
+  }
+
+  if (!fKeepSplitOutput)
+    for (Int_t iSplit = 0; iSplit < numSplits; iSplit++)
+      gSystem -> Unlink(Replace(fWorkerOutput, iSplit));
+
+  return kTRUE;
+}
+
+void STRunSplitter::Print(Option_t *option) const
+{
+  cout << "== [STRunSplitter] Run " << fRunNo << " : " << fSplitStart.size() << " splits with " << fNumWorkers << " workers" << endl;
+  cout << "    [Split]   [Start]  [Events]   [Size (MB)]" << endl;
+  for (Int_t iSplit = 0; iSplit < fSplitStart.size(); iSplit++)
+    cout << right << setw(7) << iSplit
+         << setw(10) << fSplitStart[iSplit]
+         << setw(10) << fSplitNumEvents[iSplit]
+         << setw(14) << fixed << setprecision(1) << fSplitSize[iSplit] / 1024. / 1024. << endl;
+}
@@ -0,0 +1,103 @@
+//-----------------------------------------------------------
+// Description:
+//   Splitting one run into several reconstruction processes
+//   and merging their outputs
+//
+// Environment:
+//   Software developed for the SPiRIT-TPC at RIKEN
+//-----------------------------------------------------------
+
+#ifndef STRUNSPLITTER
+#define STRUNSPLITTER
+
+#include "TObject.h"
+#include "TString.h"
+
+#include <vector>
+
+/**
+ * Local orchestrator of split reconstruction of one run.
+ *
+ * 1) Splits are computed from the meta data (frame index) of the CoBo files.
+ *    Event ranges are chosen so that each split has about the same amount
+ *    of raw data, since the decoding and reconstruction time follows the
+ *    data size rather than the number of events.
+ * 2) Worker processes are launched, at most fNumWorkers at a time. Each
+ *    worker seeks to its first event directly using the shared meta data.
+ *    Splits are handed out to the workers from a queue, so a slow split
+ *    does not hold the others.
+ * 3) Outputs are merged in the order of the splits, so the events in the
+ *    merged tree are in the order of the run, and a single RecoHeader with
+ *    eventStart and numEvents of the whole range is written.
+ *
+ * Worker command and output file names are given as templates with
+ * placeholders which are replaced for each split:
+ *   %RUN%, %SPLIT%, %START%, %NUM%, %NUMINRUN%
+ *
+ * See macros/run_reco_split.C.
+ */
+class STRunSplitter : public TObject
+{
+  public:
+    STRunSplitter();
+    STRunSplitter(Int_t runNo);
+    virtual ~STRunSplitter() {}
+
+    void SetRunNo(Int_t runNo);
+
+    /// Meta data list file (same as run_reco_experiment.C). File names are relative to dir.
+    void SetMetaDataList(TString listFile, TString dir = "");
+    /// Meta data file of CoBo coboIdx
+    void SetMetaData(TString filename, Int_t coboIdx);
+
+    /// If set, only first numEvents events are used. Required if there is no meta data.
+    void SetNumEvents(Int_t numEvents);
+    void SetNumWorkers(Int_t numWorkers);
+    /// Number of splits. Default is number of workers.
+    void SetNumSplits(Int_t numSplits);
+
+    void SetWorkerCommand(TString command);
+    void SetWorkerOutput(TString output);
+    void SetWorkerLog(TString log);
+    void SetMergedOutput(TString output);
+    /// Keep output files of the workers after merging. Default is false.
+    void SetKeepSplitOutput(Bool_t val = kTRUE);
+
+    /// Compute the splits. Called from Run() if not called before.
+    Bool_t MakeSplits();
+    Int_t GetNumSplits();
+    Int_t GetSplitStart(Int_t iSplit);
+    Int_t GetSplitNumEvents(Int_t iSplit);
+
+    /// Split, run and merge. Return false if any of the steps failed.
+    Bool_t Run();
+
+    /// Merge the outputs of the splits in order.
+    Bool_t Merge();
+
+    void Print(Option_t *option = "") const;
+
+  private:
+    TString Replace(TString pattern, Int_t iSplit);
+
+    Int_t fRunNo = 0;
+
+    TString fMetaData[12];
+    Int_t fNumEvents = -1;
+    Int_t fNumWorkers = 4;
+    Int_t fNumSplits = -1;
+
+    TString fWorkerCommand;
+    TString fWorkerOutput;
+    TString fWorkerLog;
+    TString fMergedOutput;
+    Bool_t fKeepSplitOutput = kFALSE;
+
+    std::vector<Int_t> fSplitStart;
+    std::vector<Int_t> fSplitNumEvents;
+    std::vector<Double_t> fSplitSize; ///< raw data size in bytes
+
+  ClassDef(STRunSplitter, 1)
+};
+
+#endif
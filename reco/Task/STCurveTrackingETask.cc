@@ -27,14 +27,14 @@ InitStatus STCurveTrackingETask::Init()
   if (STRecoTask::Init() == kERROR)
     return kERROR;
 
-  fHitArray = (TClonesArray *) fRootManager -> GetObject("STHit");
+  fHitArray = (TClonesArray *) GetRecoObject("STHit");
   if (fHitArray == nullptr) {
     LOG(ERROR) << "Cannot find STHit array!" << FairLogger::endl;
     return kERROR;
   }
   
   fTrackArray = new TClonesArray("STCurveTrack", 100);
-  fRootManager -> Register("STCurveTrack", "SpiRIT", fTrackArray, fIsPersistence);
+  RegisterRecoObject("STCurveTrack", fTrackArray, fIsPersistence);
 
   fTrackFinder = new STCurveTrackFinder();
 
@@ -43,6 +43,8 @@ InitStatus STCurveTrackingETask::Init()
 
 void STCurveTrackingETask::Exec(Option_t *opt)
 {
+  STRecoTaskProfile profile(this);
+
   fTrackArray -> Delete();
 
   if (fEventHeader -> IsBadEvent())
@@ -52,10 +54,12 @@ void STCurveTrackingETask::Exec(Option_t *opt)
 
   if (fTrackArray -> GetEntriesFast() < fNumTracksLowLimit) {
     fEventHeader -> SetIsBadEvent();
+    auto lock = LockLogger();
     LOG(INFO) << Space() << "Found less than " << fNumTracksLowLimit << " curve tracks. Bad event!" << FairLogger::endl;
     fTrackArray -> Delete();
     return;
   }
 
+  auto lock = LockLogger();
   LOG(INFO) << Space() << "STCurveTrack " << fTrackArray -> GetEntriesFast() << FairLogger::endl;
 }
@@ -0,0 +1,240 @@
+#include "STEventParallelTask.hh"
+
+ClassImp(STEventParallelTask)
+
+STEventParallelTask::STEventParallelTask()
+: STEventParallelTask(4)
+{
+}
+
+STEventParallelTask::STEventParallelTask(Int_t numLanes, Bool_t persistence)
+: STRecoTask("Event Parallel Task", 1, persistence)
+{
+  fNumLanes = numLanes < 1 ? 1 : numLanes;
+  fLaneTasks.resize(fNumLanes);
+}
+
+STEventParallelTask::~STEventParallelTask()
+{
+  for (auto &future : fFutures)
+    if (future.valid())
+      future.wait();
+
+  delete fPool;
+
+  for (auto slot : fSlots)
+    delete slot;
+  for (auto array : fRawEventArrays)
+    delete array;
+  for (auto array : fSwapArrays)
+    delete array;
+}
+
+void STEventParallelTask::SetDecoder(STDecoderTask *decoder) { fDecoder = decoder; }
+STDecoderTask *STEventParallelTask::GetDecoder() { return fDecoder; }
+
+Int_t STEventParallelTask::GetNumLanes() { return fNumLanes; }
+
+void STEventParallelTask::AddLaneTask(Int_t iLane, STRecoTask *task) { fLaneTasks.at(iLane).push_back(task); }
+STRecoTask *STEventParallelTask::GetLaneTask(Int_t iLane, Int_t iTask) { return fLaneTasks.at(iLane).at(iTask); }
+
+void STEventParallelTask::SetNumEvents(Long64_t numEvents) { fNumEvents = numEvents; }
+
+void STEventParallelTask::SetParContainers()
+{
+  STRecoTask::SetParContainers();
+
+  if (fDecoder != nullptr)
+    fDecoder -> SetParContainers();
+
+  for (auto &tasks : fLaneTasks)
+    for (auto task : tasks)
+      task -> SetParContainers();
+}
+
+InitStatus STEventParallelTask::Init()
+{
+  if (STRecoTask::Init() == kERROR)
+    return kERROR;
+
+  if (fDecoder == nullptr) {
+    LOG(ERROR) << "Decoder is not set!" << FairLogger::endl;
+    return kERROR;
+  }
+
+  if (fDecoder -> Init() == kERROR)
+    return kERROR;
+
+  for (Int_t iLane = 0; iLane < fNumLanes; iLane++)
+  {
+    if (fLaneTasks[iLane].size() != fLaneTasks[0].size()) {
+      LOG(ERROR) << "Lane " << iLane << " has different number of tasks from lane 0!" << FairLogger::endl;
+      return kERROR;
+    }
+
+    auto slot = new STEventSlot();
+    slot -> SetLaneID(iLane);
+    fSlots.push_back(slot);
+
+    auto rawEventArray = new TClonesArray("STRawEvent");
+    slot -> Register("STRawEvent", rawEventArray, kFALSE);
+    fRawEventArrays.push_back(rawEventArray);
+
+    for (auto task : fLaneTasks[iLane])
+    {
+      if (!task -> IsThreadSafe()) {
+        LOG(ERROR) << task -> GetName() << " is not thread-safe. Add it to FairRun after " << GetName() << "." << FairLogger::endl;
+        return kERROR;
+      }
+
+      task -> SetEventSlot(slot);
+      if (task -> Init() == kERROR) {
+        LOG(ERROR) << "Cannot initialize " << task -> GetName() << " in lane " << iLane << "!" << FairLogger::endl;
+        return kERROR;
+      }
+    }
+  }
+
+  // Every lane registers the same objects. Objects of lane 0 are used as templates of output.
+  auto slot0 = fSlots[0];
+  for (Int_t iObject = 0; iObject < slot0 -> GetNumObjects(); iObject++)
+  {
+    TString name = slot0 -> GetName(iObject);
+    if (name == "STRawEvent")
+      continue;
+
+    TObject *object = slot0 -> GetObject(iObject);
+    if (!object -> InheritsFrom(TClonesArray::Class()) && !object -> InheritsFrom(STEventHeader::Class())) {
+      LOG(ERROR) << name << " is not TClonesArray nor STEventHeader. Cannot be transfered from lanes!" << FairLogger::endl;
+      return kERROR;
+    }
+
+    TObject *output = object -> Clone();
+    RegisterRecoObject(name, output, slot0 -> IsPersistence(iObject));
+
+    TClonesArray *swapArray = nullptr;
+    if (object -> InheritsFrom(TClonesArray::Class()))
+      swapArray = new TClonesArray(((TClonesArray *) object) -> GetClass());
+
+    fOutputNames.push_back(name);
+    fOutputObjects.push_back(output);
+    fSwapArrays.push_back(swapArray);
+  }
+
+  fPool = new STThreadPool(fNumLanes);
+  fFutures.resize(fNumLanes);
+  fIsFilled.resize(fNumLanes, kFALSE);
+
+  LOG(INFO) << GetName() << " : " << fNumLanes << " lanes with " << fLaneTasks[0].size() << " tasks each" << FairLogger::endl;
+
+  return kSUCCESS;
+}
+
+Bool_t STEventParallelTask::FillLane(Int_t iLane)
+{
+  fIsFilled[iLane] = kFALSE;
+
+  if (fNumEvents >= 0 && fNumEventsRead >= fNumEvents)
+    return kFALSE;
+
+  if (!fDecoder -> ReadNextEvent(fRawEventArrays[iLane]))
+    return kFALSE;
+
+  fSlots[iLane] -> SetEventID(fDecoder -> GetEventID());
+  fNumEventsRead++;
+  fIsFilled[iLane] = kTRUE;
+
+  auto &tasks = fLaneTasks[iLane];
+  fFutures[iLane] = fPool -> Submit([&tasks]() {
+    for (auto task : tasks)
+      task -> Exec("");
+  });
+
+  return kTRUE;
+}
+
+void STEventParallelTask::TransferLane(Int_t iLane)
+{
+  auto slot = fSlots[iLane];
+
+  for (Int_t iObject = 0; iObject < fOutputNames.size(); iObject++)
+  {
+    TObject *input = slot -> GetObject(fOutputNames[iObject]);
+    TObject *output = fOutputObjects[iObject];
+
+    if (output -> InheritsFrom(TClonesArray::Class())) {
+      // Objects are exchanged, not copied, so pointers between output objects (track -> hit) stay valid.
+      // Objects of the previous event go back to the lane, cleared, to be reused by ConstructedAt().
+      auto inputArray = (TClonesArray *) input;
+      auto outputArray = (TClonesArray *) output;
+      auto swapArray = fSwapArrays[iObject];
+      swapArray -> AbsorbObjects(outputArray);
+      outputArray -> AbsorbObjects(inputArray);
+      inputArray -> AbsorbObjects(swapArray);
+      inputArray -> Clear("C");
+    }
+    else
+      *((STEventHeader *) output) = *((STEventHeader *) input);
+  }
+}
+
+void STEventParallelTask::ClearOutput()
+{
+  for (auto output : fOutputObjects)
+  {
+    if (output -> InheritsFrom(TClonesArray::Class()))
+      ((TClonesArray *) output) -> Clear("C");
+    else {
+      auto header = (STEventHeader *) output;
+      header -> Clear();
+      header -> SetIsBadEvent();
+    }
+  }
+}
+
+void STEventParallelTask::Exec(Option_t *opt)
+{
+  STRecoTaskProfile profile(this);
+
+  // Lanes are started here, not in Init(), so that tasks can still be configured after FairRun::Init().
+  if (!fIsStarted) {
+    fIsStarted = kTRUE;
+    for (Int_t iLane = 0; iLane < fNumLanes; iLane++)
+      if (!FillLane(iLane))
+        break;
+  }
+
+  // No event left: outputs of the previous event must not be written again
+  if (!fIsFilled[fCurrentLane]) {
+    ClearOutput();
+    return;
+  }
+
+  fFutures[fCurrentLane].get();
+  TransferLane(fCurrentLane);
+  FillLane(fCurrentLane);
+
+  fCurrentLane = (fCurrentLane + 1) % fNumLanes;
+}
+
+void STEventParallelTask::FinishEvent()
+{
+  if (!fIsFilled[fCurrentLane]) {
+    auto lock = LockLogger();
+    LOG(INFO) << "End of events. Terminating FairRun." << FairLogger::endl;
+    FairRootManager::Instance() -> SetFinishRun();
+  }
+}
+
+void STEventParallelTask::Finish()
+{
+  for (auto &future : fFutures)
+    if (future.valid())
+      future.wait();
+
+  for (auto &tasks : fLaneTasks)
+    for (auto task : tasks)
+      task -> FinishTask();
+
+  STRecoTask::Finish();
+}
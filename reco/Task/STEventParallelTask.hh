@@ -0,0 +1,95 @@
+#ifndef STEVENTPARALLELTASK_HH
+#define STEVENTPARALLELTASK_HH
+
+#include "STRecoTask.hh"
+#include "STDecoderTask.hh"
+#include "STEventSlot.hh"
+#include "STThreadPool.hh"
+
+#include <vector>
+#include <future>
+
+/**
+ * Run a chain of STRecoTask on several events at the same time.
+ *
+ * The task owns the decoder and numLanes copies of the task chain
+ * (preview, PSA, helix tracking, ...). Each copy ("lane") has its own
+ * STEventSlot, so the lanes share no containers. Events are given to the
+ * lanes in round-robin, and the outputs are handed to FairRootManager in
+ * the order of the events, so the output tree is identical to the serial run.
+ *
+ * Only tasks checked to be thread-safe (STRecoTask::IsThreadSafe() is true;
+ * false by default) can be added to the lanes. Other tasks (e.g. GENFIT tasks)
+ * should be added to FairRun after this task and are run serially on the
+ * merged output.
+ * Tasks of each lane read their own parameters and calibration data in Init();
+ * only the pulse templates (STPulseTemplate) are shared between the lanes.
+ *
+ * Usage:
+ *   auto parallel = new STEventParallelTask(numLanes);
+ *   parallel -> SetDecoder(decoder);
+ *   for (Int_t iLane = 0; iLane < numLanes; iLane++) {
+ *     parallel -> AddLaneTask(iLane, new STEventPreviewTask());
+ *     parallel -> AddLaneTask(iLane, new STPSAETask());
+ *     ...
+ *   }
+ *   run -> AddTask(parallel);
+ *   run -> AddTask(new STGenfitETask());
+ */
+class STEventParallelTask : public STRecoTask
+{
+  public:
+    STEventParallelTask();
+    STEventParallelTask(Int_t numLanes, Bool_t persistence = false);
+    ~STEventParallelTask();
+
+    /// Decoder which provides STRawEvent. Should not be added to FairRun.
+    void SetDecoder(STDecoderTask *decoder);
+    STDecoderTask *GetDecoder();
+
+    Int_t GetNumLanes();
+
+    /// Add task to the end of the chain of lane iLane. Must be called before Init().
+    void AddLaneTask(Int_t iLane, STRecoTask *task);
+    STRecoTask *GetLaneTask(Int_t iLane, Int_t iTask);
+
+    /// Stop reading after numEvents events (-1 for no limit).
+    void SetNumEvents(Long64_t numEvents);
+
+    virtual void SetParContainers();
+    virtual InitStatus Init();
+    virtual void Exec(Option_t *opt);
+    virtual void FinishEvent();
+    virtual void Finish();
+
+  private:
+    /// Read next event into the lane and start the chain of the lane. Return false if there is no more event.
+    Bool_t FillLane(Int_t iLane);
+    /// Move outputs of the lane to the objects registered in FairRootManager.
+    void TransferLane(Int_t iLane);
+    /// Clear the objects registered in FairRootManager, with the event header set bad.
+    void ClearOutput();
+
+    STDecoderTask *fDecoder = nullptr;
+    STThreadPool *fPool = nullptr; //!
+
+    Int_t fNumLanes = 4;
+    Int_t fCurrentLane = 0;
+    Bool_t fIsStarted = kFALSE;
+    Long64_t fNumEvents = -1;
+    Long64_t fNumEventsRead = 0;
+
+    std::vector<STEventSlot *> fSlots; //!
+    std::vector<TClonesArray *> fRawEventArrays; //!
+    std::vector<std::vector<STRecoTask *>> fLaneTasks; //!
+    std::vector<std::future<void>> fFutures; //!
+    std::vector<Bool_t> fIsFilled; //!
+
+    std::vector<TString> fOutputNames; //!
+    std::vector<TObject *> fOutputObjects; //! registered in FairRootManager
+    std::vector<TClonesArray *> fSwapArrays; //! for exchanging objects of lane and output, nullptr if not TClonesArray
+
+  ClassDef(STEventParallelTask, 2)
+};
+
+#endif
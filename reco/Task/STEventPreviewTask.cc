@@ -24,14 +24,14 @@ InitStatus STEventPreviewTask::Init()
   if (STRecoTask::Init() == kERROR)
     return kERROR;
 
-  fRawEventArray = (TClonesArray *) fRootManager -> GetObject("STRawEvent");
+  fRawEventArray = (TClonesArray *) GetRecoObject("STRawEvent");
   if (fRawEventArray == nullptr) {
     LOG(ERROR) << "Cannot find STRawEvent array!" << FairLogger::endl;
     return kERROR;
   }
 
   fEventHeader = new STEventHeader();
-  fRootManager -> Register("STEventHeader", "SpiRIT", fEventHeader, fIsPersistence);
+  RegisterRecoObject("STEventHeader", fEventHeader, fIsPersistence);
 
   if (fRecoHeader != nullptr) {
     fRecoHeader -> SetPar("pre_identifyEvent", fIdentifyEvent);
@@ -44,6 +44,8 @@ InitStatus STEventPreviewTask::Init()
 
 void STEventPreviewTask::Exec(Option_t *opt)
 {
+  STRecoTaskProfile profile(this);
+
   fEventHeader -> Clear();
 
   STRawEvent *rawEvent = (STRawEvent *) fRawEventArray -> At(0);
@@ -61,6 +63,7 @@ void STEventPreviewTask::Exec(Option_t *opt)
   else if (fEventHeader -> IsCosmicEvent())       status = "Cosmic Event";
   else if (fEventHeader -> IsBadEvent())          status = "Bad Event";
 
+  auto lock = LockLogger();
   LOG(INFO) << "Event " << fEventHeader -> GetEventID() << " : " << status << FairLogger::endl;
 }
 
@@ -85,3 +88,5 @@ void STEventPreviewTask::LayerTest(STRawEvent *rawEvent)
   else
     fEventHeader -> SetIsBadEvent();
 }
+
+Bool_t STEventPreviewTask::IsThreadSafe() { return kTRUE; }
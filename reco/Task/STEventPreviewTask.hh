@@ -15,6 +15,9 @@ class STEventPreviewTask : public STRecoTask
     virtual InitStatus Init();
     virtual void Exec(Option_t *opt);
 
+    /// Uses only the raw event and the header of its own slot
+    virtual Bool_t IsThreadSafe();
+
   private:
     void LayerTest(STRawEvent *rawEvent);
 
@@ -0,0 +1,29 @@
+#include "STEventSlot.hh"
+
+void STEventSlot::Register(TString name, TObject *object, Bool_t persistence)
+{
+  fNames.push_back(name);
+  fObjects.push_back(object);
+  fPersistence.push_back(persistence);
+  fMap[name] = object;
+}
+
+TObject *STEventSlot::GetObject(TString name)
+{
+  auto found = fMap.find(name);
+  if (found == fMap.end())
+    return nullptr;
+
+  return found -> second;
+}
+
+Int_t STEventSlot::GetNumObjects() { return fObjects.size(); }
+TString STEventSlot::GetName(Int_t idx) { return fNames.at(idx); }
+TObject *STEventSlot::GetObject(Int_t idx) { return fObjects.at(idx); }
+Bool_t STEventSlot::IsPersistence(Int_t idx) { return fPersistence.at(idx); }
+
+void STEventSlot::SetEventID(Long64_t eventID) { fEventID = eventID; }
+Long64_t STEventSlot::GetEventID() { return fEventID; }
+
+void STEventSlot::SetLaneID(Int_t laneID) { fLaneID = laneID; }
+Int_t STEventSlot::GetLaneID() { return fLaneID; }
@@ -0,0 +1,47 @@
+#ifndef STEVENTSLOT_HH
+#define STEVENTSLOT_HH
+
+#include "TObject.h"
+#include "TString.h"
+
+#include <map>
+#include <vector>
+
+/**
+ * Private object store of one event in flight.
+ *
+ * Replaces FairRootManager for tasks running inside STEventParallelTask.
+ * Each lane of the parallel task owns one slot, so the tasks of different
+ * lanes never share their input and output containers.
+ */
+class STEventSlot
+{
+  public:
+    STEventSlot() {}
+    ~STEventSlot() {}
+
+    void Register(TString name, TObject *object, Bool_t persistence);
+    TObject *GetObject(TString name);
+
+    Int_t GetNumObjects();
+    TString GetName(Int_t idx);
+    TObject *GetObject(Int_t idx);
+    Bool_t IsPersistence(Int_t idx);
+
+    void SetEventID(Long64_t eventID);
+    Long64_t GetEventID();
+
+    void SetLaneID(Int_t laneID);
+    Int_t GetLaneID();
+
+  private:
+    std::vector<TString>  fNames;
+    std::vector<TObject*> fObjects;
+    std::vector<Bool_t>   fPersistence;
+    std::map<TString, TObject*> fMap;
+
+    Long64_t fEventID = -1;
+    Int_t fLaneID = 0;
+};
+
+#endif
@@ -70,6 +70,8 @@ STGenfitETask::Init()
 
 void STGenfitETask::Exec(Option_t *opt)
 {
+  STRecoTaskProfile profile(this);
+
   fTrackArray -> Clear("C");
   fTrackCandArray -> Clear("C");
 
@@ -170,5 +172,8 @@ void STGenfitETask::Exec(Option_t *opt)
   }
   fTrackArray -> Compress();
 
+  auto lock = LockLogger();
   LOG(INFO) << Space() << "STTrack " << fTrackArray -> GetEntriesFast() << FairLogger::endl;
 }
+
+Bool_t STGenfitETask::IsThreadSafe() { return kFALSE; }
@@ -80,6 +80,8 @@ STGenfitSinglePIDTask::Init()
 
 void STGenfitSinglePIDTask::Exec(Option_t *opt)
 {
+  STRecoTaskProfile profile(this);
+
   fTrackArray -> Clear("C");
   fTrackCandArray -> Clear("C");
   fVertexArray -> Delete();
@@ -134,6 +136,7 @@ fGenfitTest -> CalculatedEdx2(track, recoTrack, helixTrack);
     helixTrack -> SetGenfitMomentum(candTrack -> GetP());
   }
 
+  auto lock = LockLogger();
   LOG(INFO) << Space() << "STTrack " << fTrackArray -> GetEntriesFast() << FairLogger::endl;
 
   if (genfitTrackArray.size() < 2)
@@ -170,3 +173,5 @@ fGenfitTest -> CalculatedEdx2(track, recoTrack, helixTrack);
     delete vertex;
   }
 }
+
+Bool_t STGenfitSinglePIDTask::IsThreadSafe() { return kFALSE; }
@@ -21,6 +21,9 @@ class STGenfitSinglePIDTask : public STRecoTask
     virtual InitStatus Init();
     virtual void Exec(Option_t *opt);
 
+    /// GENFIT field and material managers are global
+    virtual Bool_t IsThreadSafe();
+
   private:
     TClonesArray *fHelixTrackArray = nullptr;
     TClonesArray *fTrackPreArray = nullptr;
@@ -28,6 +28,15 @@ void STHelixTrackingTask::SetClusterPersistence(Bool_t value) { fIsClusterPersis
 
 void STHelixTrackingTask::SetNumTracksLowLimit(Int_t limit) { fNumTracksLowLimit = limit; }
 void STHelixTrackingTask::SetClusteringOption(Int_t opt) { fClusteringOption = opt; }
+void STHelixTrackingTask::SetNumSectors(Int_t numSectors) { fNumSectors = numSectors; }
+void STHelixTrackingTask::SetValidateSectors(Bool_t val) { fValidateSectors = val; }
+void STHelixTrackingTask::SetBeamAxis(Double_t x, Double_t y)
+{
+  fBeamX = x;
+  fBeamY = y;
+}
+void STHelixTrackingTask::SetUseSinglePrecision(Bool_t val) { fUseSinglePrecision = val; }
+void STHelixTrackingTask::SetValidatePrecision(Bool_t val) { fValidatePrecision = val; }
 STHelixTrackFinder *STHelixTrackingTask::GetTrackFinder() { return fTrackFinder; }
 
 InitStatus STHelixTrackingTask::Init()
@@ -35,23 +44,30 @@ InitStatus STHelixTrackingTask::Init()
   if (STRecoTask::Init() == kERROR)
     return kERROR;
 
-  fHitArray = (TClonesArray *) fRootManager -> GetObject("STHit");
+  fHitArray = (TClonesArray *) GetRecoObject("STHit");
   if (fHitArray == nullptr) {
     LOG(ERROR) << "Cannot find STHit array!" << FairLogger::endl;
     return kERROR;
   }
   
   fTrackArray = new TClonesArray("STHelixTrack", 100);
-  fRootManager -> Register("STHelixTrack", "SpiRIT", fTrackArray, fIsPersistence);
+  RegisterRecoObject("STHelixTrack", fTrackArray, fIsPersistence);
 
   fHitClusterArray = new TClonesArray("STHitCluster", 100);
-  fRootManager -> Register("STHitCluster", "SpiRIT", fHitClusterArray, fIsClusterPersistence);
+  RegisterRecoObject("STHitCluster", fHitClusterArray, fIsClusterPersistence);
 
   fTrackFinder = new STHelixTrackFinder();
   fTrackFinder -> SetClusteringOption(fClusteringOption);
+  fTrackFinder -> SetNumSectors(fNumSectors);
+  fTrackFinder -> SetValidateSectors(fValidateSectors);
+  fTrackFinder -> SetBeamAxis(fBeamX, fBeamY);
+  fTrackFinder -> SetUseSinglePrecision(fUseSinglePrecision);
+  fTrackFinder -> SetValidatePrecision(fValidatePrecision);
 
   if (fRecoHeader != nullptr) {
     fRecoHeader -> SetPar("helix_numTracksLowLimit", fNumTracksLowLimit);
+    fRecoHeader -> SetPar("helix_numSectors", fNumSectors);
+    fRecoHeader -> SetPar("helix_singlePrecision", fUseSinglePrecision);
     fRecoHeader -> Write("RecoHeader", TObject::kWriteDelete);
   }
 
@@ -60,8 +76,10 @@ InitStatus STHelixTrackingTask::Init()
 
 void STHelixTrackingTask::Exec(Option_t *opt)
 {
-  fTrackArray -> Delete();
-  fHitClusterArray -> Delete();
+  STRecoTaskProfile profile(this);
+
+  fTrackArray -> Clear("C");
+  fHitClusterArray -> Clear("C");
 
   if (fEventHeader -> IsBadEvent())
     return;
@@ -70,11 +88,30 @@ void STHelixTrackingTask::Exec(Option_t *opt)
 
   if (fTrackArray -> GetEntriesFast() < fNumTracksLowLimit) {
     fEventHeader -> SetIsBadEvent();
+    auto lock = LockLogger();
     LOG(INFO) << Space() << "Found less than " << fNumTracksLowLimit << " helix tracks. Bad event!" << FairLogger::endl;
-    fTrackArray -> Delete();
-    fHitClusterArray -> Delete();
+    fTrackArray -> Clear("C");
+    fHitClusterArray -> Clear("C");
     return;
   }
 
+  auto lock = LockLogger();
   LOG(INFO) << Space() << "STHelixTrack " << fTrackArray -> GetEntriesFast() << FairLogger::endl;
 }
+
+void STHelixTrackingTask::Finish()
+{
+  if (fTrackFinder != nullptr && fNumSectors > 1 && fValidateSectors) {
+    auto lock = LockLogger();
+    fTrackFinder -> PrintSectorValidation();
+  }
+
+  if (fTrackFinder != nullptr && fUseSinglePrecision && fValidatePrecision) {
+    auto lock = LockLogger();
+    fTrackFinder -> PrintPrecisionValidation();
+  }
+
+  STRecoTask::Finish();
+}
+
+Bool_t STHelixTrackingTask::IsThreadSafe() { return kTRUE; }
@@ -18,10 +18,27 @@ class STHelixTrackingTask : public STRecoTask
 
     virtual InitStatus Init();
     virtual void Exec(Option_t *opt);
+    /// Print the sector and precision validation accumulated over the run
+    virtual void Finish();
+
+    /// Track finder of each instance is separate
+    virtual Bool_t IsThreadSafe();
 
     void SetNumTracksLowLimit(Int_t limit);
     void SetClusteringOption(Int_t opt);
 
+    /// Find tracks in azimuthal sectors in parallel (see STHelixTrackFinder::SetNumSectors())
+    void SetNumSectors(Int_t numSectors);
+    /// Compare sector tracks with serial ones for every event
+    void SetValidateSectors(Bool_t val = kTRUE);
+    /// Beam axis (x, y) [mm] of the sectors (see STHelixTrackFinder::SetBeamAxis())
+    void SetBeamAxis(Double_t x, Double_t y);
+
+    /// Correlate hits in single precision (see STHelixTrackFinder::SetUseSinglePrecision())
+    void SetUseSinglePrecision(Bool_t val = kTRUE);
+    /// Compare single precision correlation with double precision for every event, printed in Finish()
+    void SetValidatePrecision(Bool_t val = kTRUE);
+
     STHelixTrackFinder *GetTrackFinder();
 
   private:
@@ -31,13 +48,20 @@ class STHelixTrackingTask : public STRecoTask
 
     Bool_t fIsClusterPersistence = kFALSE;
 
-    STHelixTrackFinder* fTrackFinder;
+    STHelixTrackFinder* fTrackFinder = nullptr;
 
     Int_t fNumTracksLowLimit = 1;
     Int_t fClusteringOption = 2;
 
+    Int_t fNumSectors = 1;
+    Bool_t fValidateSectors = kFALSE;
+    Double_t fBeamX = 0.;
+    Double_t fBeamY = -213.3;
+    Bool_t fUseSinglePrecision = kFALSE;
+    Bool_t fValidatePrecision = kFALSE;
+
 
-  ClassDef(STHelixTrackingTask, 1)
+  ClassDef(STHelixTrackingTask, 4)
 };
 
 #endif
@@ -56,14 +56,14 @@ InitStatus STHitClusteringCTTask::Init()
   if (STRecoTask::Init() == kERROR)
     return kERROR;
 
-  fTrackArray = (TClonesArray *) fRootManager -> GetObject("STCurveTrack");
+  fTrackArray = (TClonesArray *) GetRecoObject("STCurveTrack");
   if (fTrackArray == nullptr) {
     LOG(ERROR) << "Cannot find STCurveTrack array!" << FairLogger::endl;
     return kERROR;
   }
 
   fClusterArray = new TClonesArray("STHitCluster", 500);
-  fRootManager -> Register("STHitCluster", "SpiRIT", fClusterArray, fIsPersistence);
+  RegisterRecoObject("STHitCluster", fClusterArray, fIsPersistence);
 
   fClusterizer = new STClusterizerCurveTrack();
   if (fSetProxCut)  fClusterizer -> SetProximityCut(fXCut, fYCut, fZCut);
@@ -77,12 +77,15 @@ InitStatus STHitClusteringCTTask::Init()
 void
 STHitClusteringCTTask::Exec(Option_t *opt)
 {
-  fClusterArray -> Delete();
+  STRecoTaskProfile profile(this);
+
+  fClusterArray -> Clear("C");
 
   if (fEventHeader -> IsBadEvent())
     return;
 
   fClusterizer -> AnalyzeTrack(fTrackArray, fClusterArray);
 
+  auto lock = LockLogger();
   LOG(INFO) << Space() << "STHitCluster " << fClusterArray -> GetEntriesFast() << FairLogger::endl;
 }
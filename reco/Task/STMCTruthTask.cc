@@ -55,6 +55,8 @@ InitStatus STMCTruthTask::Init()
 
 void STMCTruthTask::Exec(Option_t *opt)
 {
+  STRecoTaskProfile profile(this);
+
   if (fEventHeader -> IsBadEvent())
     return;
 
@@ -171,5 +173,6 @@ void STMCTruthTask::Exec(Option_t *opt)
     truth -> Init(-1, iReco, 0, TVector3(0,0,0), reco -> GetRecoMomentum());
   }
 
+  auto lock = LockLogger();
   LOG(INFO) << Space() << "MC Matching: " << countMatch << " / " << fMCArray -> GetEntries() << FairLogger::endl;
 }
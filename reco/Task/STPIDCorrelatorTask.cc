@@ -44,6 +44,8 @@ InitStatus STPIDCorrelatorTask::Init()
 
 void STPIDCorrelatorTask::Exec(Option_t *opt)
 {
+  STRecoTaskProfile profile(this);
+
   //std::cout << "Inside STPIDCorrelatorTask" << std::endl;
     
   if (fEventHeader -> IsBadEvent())
@@ -106,6 +108,7 @@ void STPIDCorrelatorTask::Exec(Option_t *opt)
     recoTrack -> SelectTrackCandidate(bestIndex);
   }
   
+  auto lock = LockLogger();
   LOG(INFO) << Space() << "STPIDCorrelatorTask done." << FairLogger::endl;
 }
 
@@ -47,20 +47,23 @@ void STPSAETask::SetPulserData(TString pulserData) { fPulserDataName = pulserDat
 void STPSAETask::UseDefautPulserData(Int_t shapingTime) { fShapingTime = shapingTime; }
 
 void STPSAETask::SetNumHitsLowLimit(Int_t limit) { fNumHitsLowLimit = limit; }
+void STPSAETask::SetUseNewtonFit(Bool_t val) { fUseNewtonFit = val; }
+void STPSAETask::SetUseSinglePrecision(Bool_t val) { fUseSinglePrecision = val; }
+void STPSAETask::SetValidatePrecision(Bool_t val) { fValidatePrecision = val; }
 
 InitStatus STPSAETask::Init()
 {
   if (STRecoTask::Init() == kERROR)
     return kERROR;
 
-  fRawEventArray = (TClonesArray *) fRootManager -> GetObject("STRawEvent");
+  fRawEventArray = (TClonesArray *) GetRecoObject("STRawEvent");
   if (fRawEventArray == nullptr) {
     LOG(ERROR) << "Cannot find STRawEvent array!" << FairLogger::endl;
     return kERROR;
   }
 
   fHitArray = new TClonesArray("STHit", 1000);
-  fRootManager -> Register("STHit", "SpiRIT", fHitArray, fIsPersistence);
+  RegisterRecoObject("STHit", fHitArray, fIsPersistence);
 
   if (!fPulserDataName.IsNull())
     fPSA = new STPSAFastFit(fPulserDataName);
@@ -68,6 +71,9 @@ InitStatus STPSAETask::Init()
     fPSA = new STPSAFastFit(fShapingTime);
   fPSA -> SetThreshold(fThreshold);
   fPSA -> SetLayerCut(fLayerLowCut, fLayerHighCut);
+  fPSA -> SetUseNewtonFit(fUseNewtonFit);
+  fPSA -> SetUseSinglePrecision(fUseSinglePrecision);
+  fPSA -> SetValidatePrecision(fValidatePrecision);
 
   fShapingTime = fPSA -> GetShapingTime();
 
@@ -78,6 +84,8 @@ InitStatus STPSAETask::Init()
     fRecoHeader -> SetPar("psa_pulserData",      fPulserDataName);
     fRecoHeader -> SetPar("psa_shapingTime",     fShapingTime);
     fRecoHeader -> SetPar("psa_numHitsLowLimit", fNumHitsLowLimit);
+    fRecoHeader -> SetPar("psa_newtonFit",       fUseNewtonFit);
+    fRecoHeader -> SetPar("psa_singlePrecision", fUseSinglePrecision);
     fRecoHeader -> Write("RecoHeader", TObject::kWriteDelete);
   }
 
@@ -86,7 +94,9 @@ InitStatus STPSAETask::Init()
 
 void STPSAETask::Exec(Option_t *opt)
 {
-  fHitArray -> Delete();
+  STRecoTaskProfile profile(this);
+
+  fHitArray -> Clear("C");
 
   if (fEventHeader -> IsBadEvent())
     return;
@@ -97,10 +107,24 @@ void STPSAETask::Exec(Option_t *opt)
 
   if (fHitArray -> GetEntriesFast() < fNumHitsLowLimit) {
     fEventHeader -> SetIsBadEvent();
+    auto lock = LockLogger();
     LOG(INFO) << Space() << "Found less than " << fNumHitsLowLimit << " hits. Bad event!" << FairLogger::endl;
-    fHitArray -> Delete();
+    fHitArray -> Clear("C");
     return;
   }
 
+  auto lock = LockLogger();
   LOG(INFO) << Space() << "STHit " << fHitArray -> GetEntriesFast() << FairLogger::endl;
 }
+
+void STPSAETask::Finish()
+{
+  if (fPSA != nullptr && fUseSinglePrecision && fValidatePrecision) {
+    auto lock = LockLogger();
+    fPSA -> PrintPrecisionValidation();
+  }
+
+  STRecoTask::Finish();
+}
+
+Bool_t STPSAETask::IsThreadSafe() { return kTRUE; }
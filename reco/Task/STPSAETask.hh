@@ -26,6 +26,11 @@ class STPSAETask : public STRecoTask
 
     virtual InitStatus Init();
     virtual void Exec(Option_t *opt);
+    /// Print the precision validation accumulated over the run
+    virtual void Finish();
+
+    /// PSA of each instance is separate; pulse templates are shared read-only
+    virtual Bool_t IsThreadSafe();
 
     void SetThreshold(Double_t threshold);
     void SetLayerCut(Int_t lowCut, Int_t highCut);
@@ -35,11 +40,19 @@ class STPSAETask : public STRecoTask
     void SetPulserData(TString pulserData);
     void UseDefautPulserData(Int_t shapingTime);
 
+    /// Fit pulse with Gauss-Newton steps (default) or with the old step search
+    void SetUseNewtonFit(Bool_t val = kTRUE);
+
+    /// Run PSA in single precision (see STPSAFastFit::SetUseSinglePrecision())
+    void SetUseSinglePrecision(Bool_t val = kTRUE);
+    /// Compare single precision hits with double precision ones for every event, printed in Finish()
+    void SetValidatePrecision(Bool_t val = kTRUE);
+
   private:
     TClonesArray *fRawEventArray = nullptr;
     TClonesArray *fHitArray = nullptr;
 
-    STPSAFastFit *fPSA;
+    STPSAFastFit *fPSA = nullptr;
     
     Double_t fThreshold = 20;
     Int_t fLayerLowCut  = -1;
@@ -50,6 +63,10 @@ class STPSAETask : public STRecoTask
 
     Int_t fNumHitsLowLimit = 1;
 
+    Bool_t fUseNewtonFit = kTRUE;
+    Bool_t fUseSinglePrecision = kFALSE;
+    Bool_t fValidatePrecision = kFALSE;
+
   ClassDef(STPSAETask, 1)
 };
 
@@ -42,12 +42,55 @@ InitStatus STRecoTask::Init()
     return kERROR;
   }
 
-  fRecoHeader = (STRecoHeader *) fRootManager -> GetOutFile() -> Get("RecoHeader");
-  fEventHeader = (STEventHeader *) fRootManager -> GetObject("STEventHeader");
+  // Inside STEventParallelTask, only the tasks of the first lane write to RecoHeader.
+  if (fEventSlot == nullptr || fEventSlot -> GetLaneID() == 0)
+    fRecoHeader = (STRecoHeader *) fRootManager -> GetOutFile() -> Get("RecoHeader");
+  fEventHeader = (STEventHeader *) GetRecoObject("STEventHeader");
+
+  if (fProfileID < 0)
+    fProfileID = STTaskProfiler::Instance() -> Register(GetName());
 
   return kSUCCESS;
 }
 
+void STRecoTask::Finish()
+{
+  if (fProfileID >= 0)
+    STTaskProfiler::Instance() -> Finish(fProfileID);
+}
+
+void STRecoTask::SetEventSlot(STEventSlot *slot) { fEventSlot = slot; }
+STEventSlot *STRecoTask::GetEventSlot() { return fEventSlot; }
+
+Bool_t STRecoTask::IsThreadSafe() { return kFALSE; }
+
+TObject *STRecoTask::GetRecoObject(TString name)
+{
+  if (fEventSlot != nullptr)
+    return fEventSlot -> GetObject(name);
+
+  return fRootManager -> GetObject(name);
+}
+
+void STRecoTask::RegisterRecoObject(TString name, TObject *object, Bool_t persistence)
+{
+  if (object -> InheritsFrom(TCollection::Class()))
+    fOutputCollections.push_back((TCollection *) object);
+
+  if (fEventSlot != nullptr)
+    fEventSlot -> Register(name, object, persistence);
+  else if (object -> InheritsFrom(TCollection::Class()))
+    fRootManager -> Register(name, "SpiRIT", (TCollection *) object, persistence);
+  else
+    fRootManager -> Register(name, "SpiRIT", (TNamed *) object, persistence);
+}
+
+std::unique_lock<std::mutex> STRecoTask::LockLogger()
+{
+  static std::mutex loggerMutex;
+  return std::unique_lock<std::mutex>(loggerMutex);
+}
+
 TString STRecoTask::Space()
 {
   Int_t length = 0;
@@ -60,3 +103,27 @@ TString STRecoTask::Space()
 
   return space;
 }
+
+STRecoTaskProfile::STRecoTaskProfile(STRecoTask *task)
+: fTask(task)
+{
+  fIsEnabled = fTask -> fProfileID >= 0 && STTaskProfiler::Instance() -> IsEnabled();
+  if (fIsEnabled)
+    STTaskProfiler::Now(fWall, fCpu);
+}
+
+STRecoTaskProfile::~STRecoTaskProfile()
+{
+  if (!fIsEnabled)
+    return;
+
+  Double_t wall, cpu;
+  STTaskProfiler::Now(wall, cpu);
+
+  Long_t numObjects = 0;
+  for (auto collection : fTask -> fOutputCollections)
+    numObjects += collection -> GetEntries();
+
+  STTaskProfiler::Instance() -> Fill(fTask -> fProfileID, wall - fWall, cpu - fCpu, numObjects);
+  STTaskProfiler::Instance() -> SampleMemory();
+}
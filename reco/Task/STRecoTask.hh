@@ -10,9 +10,14 @@
 #include "STDigiPar.hh"
 #include "STRecoHeader.hh"
 #include "STEventHeader.hh"
+#include "STEventSlot.hh"
+#include "STTaskProfiler.hh"
 
 #include "TClonesArray.h" 
 
+#include <vector>
+#include <mutex>
+
 class STRecoTask : public FairTask 
 {
   public:
@@ -25,19 +30,74 @@ class STRecoTask : public FairTask
 
     virtual void SetParContainers();
 
+    /// Report to STTaskProfiler. Derived class overriding Finish() should call this.
+    virtual void Finish();
+
+    /**
+     * If set, input and output objects are taken from the slot instead of
+     * FairRootManager. Used by STEventParallelTask. Must be called before Init().
+     */
+    void SetEventSlot(STEventSlot *slot);
+    STEventSlot *GetEventSlot();
+
+    /**
+     * Return true only if the task was checked to run in several instances at once:
+     * no shared resources which are not thread-safe (geometry navigation, GENFIT
+     * field/material managers, STDebugLogger string interface, ...).
+     * False by default. Task which is not thread-safe cannot run inside STEventParallelTask.
+     */
+    virtual Bool_t IsThreadSafe();
+
   protected:
+    /// Get input object from event slot if set, otherwise from FairRootManager
+    TObject *GetRecoObject(TString name);
+    /// Register output object to event slot if set, otherwise to FairRootManager
+    void RegisterRecoObject(TString name, TObject *object, Bool_t persistence);
+
     Bool_t fIsPersistence;  ///< Persistence check variable
 
     STRecoHeader *fRecoHeader = nullptr;
     STEventHeader *fEventHeader = nullptr;
 
     FairRootManager *fRootManager;
+    STEventSlot *fEventSlot = nullptr; //!
 
     STDigiPar *fDigiPar;
 
     TString Space();
 
+    /**
+     * FairLogger is not thread-safe, and the lanes of STEventParallelTask run
+     * at the same time as the serial tasks. Exec() holds this lock while logging:
+     *   auto lock = LockLogger();
+     *   LOG(INFO) << Space() << ... << FairLogger::endl;
+     */
+    std::unique_lock<std::mutex> LockLogger();
+
+  private:
+    friend class STRecoTaskProfile;
+
+    Int_t fProfileID = -1; //!
+    std::vector<TCollection *> fOutputCollections; //! counted by profiler
+
   ClassDef(STRecoTask, 1);
 };
 
+/**
+ * Profile one Exec() of STRecoTask with STTaskProfiler.
+ * Declare at the top of Exec():
+ *   STRecoTaskProfile profile(this);
+ */
+class STRecoTaskProfile
+{
+  public:
+    STRecoTaskProfile(STRecoTask *task);
+    ~STRecoTaskProfile();
+
+  private:
+    STRecoTask *fTask;
+    Bool_t fIsEnabled;
+    Double_t fWall, fCpu;
+};
+
 #endif
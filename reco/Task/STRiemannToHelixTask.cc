@@ -16,17 +16,19 @@ InitStatus STRiemannToHelixTask::Init()
 
   fFitter = new STHelixTrackFitter();
 
-  fHitClusterArray = (TClonesArray *) fRootManager -> GetObject("STHitCluster");
-  fRiemannArray = (TClonesArray *) fRootManager -> GetObject("STRiemannTrack");
+  fHitClusterArray = (TClonesArray *) GetRecoObject("STHitCluster");
+  fRiemannArray = (TClonesArray *) GetRecoObject("STRiemannTrack");
   
   fHelixArray = new TClonesArray("STHelixTrack", 100);
-  fRootManager -> Register("STHelixTrack", "SpiRIT", fHelixArray, fIsPersistence);
+  RegisterRecoObject("STHelixTrack", fHelixArray, fIsPersistence);
 
   return kSUCCESS;
 }
 
 void STRiemannToHelixTask::Exec(Option_t *opt)
 {
+  STRecoTaskProfile profile(this);
+
   fHelixArray -> Delete();
 
   Int_t nRiemannTracks = fRiemannArray -> GetEntriesFast();
@@ -51,5 +53,6 @@ void STRiemannToHelixTask::Exec(Option_t *opt)
     helixTrack -> FinalizeClusters();
   }
 
+  auto lock = LockLogger();
   LOG(INFO) << Space() << "STHelixTrack " << fHelixArray -> GetEntriesFast() << FairLogger::endl;
 }
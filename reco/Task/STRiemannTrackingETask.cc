@@ -178,27 +178,27 @@ STRiemannTrackingETask::Init()
   if (STRecoTask::Init() == kERROR)
     return kERROR;
 
-  fSMClusterArray = (TClonesArray *) fRootManager -> GetObject("STHitClusterSM");
+  fSMClusterArray = (TClonesArray *) GetRecoObject("STHitClusterSM");
   if (fSMClusterArray == nullptr) {
     fLogger -> Error(MESSAGE_ORIGIN, "Cannot find SM STHitCluster array!");
     return kERROR;
   }
 
 #ifdef PRETRACKING
-  fPreTrackArray = (TClonesArray *) fRootManager -> GetObject("STCurveTrack");
+  fPreTrackArray = (TClonesArray *) GetRecoObject("STCurveTrack");
 #endif
 
 #ifdef SUBTASK_RIEMANN
-  fRiemannTrackArray = (TClonesArray *) fRootManager -> GetObject("STRiemannTrack");
+  fRiemannTrackArray = (TClonesArray *) GetRecoObject("STRiemannTrack");
 #endif
 
 #ifndef SUBTASK_RIEMANN
   fRiemannTrackArray = new TClonesArray("STRiemannTrack");
-  fRootManager -> Register("STRiemannTrack", "SpiRIT", fRiemannTrackArray, fIsPersistence);
+  RegisterRecoObject("STRiemannTrack", fRiemannTrackArray, fIsPersistence);
 #endif
 
   fRiemannHitArray = new TClonesArray("STRiemannHit");
-  fRootManager -> Register("STRiemannHit", "SpiRIT", fRiemannHitArray, kFALSE);
+  RegisterRecoObject("STRiemannHit", fRiemannHitArray, kFALSE);
 
   fTrackFinder = new STRiemannTrackFinder();
   fTrackFinder -> SetSorting(fSorting);
@@ -244,6 +244,8 @@ STRiemannTrackingETask::Init()
 
 void STRiemannTrackingETask::Exec(Option_t *opt)
 {
+  STRecoTaskProfile profile(this);
+
 #ifdef SUBTASK_RIEMANN
   if (opt == TString("sub")) 
   {
@@ -415,6 +417,7 @@ void STRiemannTrackingETask::Exec(Option_t *opt)
     }
   }
 
+  auto lock = LockLogger();
   LOG(INFO) << Space() << "STRiemannTrack " << foundTracks << FairLogger::endl;
 }
 
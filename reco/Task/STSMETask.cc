@@ -29,14 +29,14 @@ InitStatus STSMETask::Init()
   if (STRecoTask::Init() == kERROR)
     return kERROR;
 
-  fClusterArray = (TClonesArray *) fRootManager -> GetObject("STHitCluster");
+  fClusterArray = (TClonesArray *) GetRecoObject("STHitCluster");
   if (fClusterArray == nullptr) {
     LOG(INFO) << "Cannot find STHitCluster array!" << FairLogger::endl;
     return kERROR;
   }
 
   fSMClusterArray = new TClonesArray("STHitCluster", 500);
-  fRootManager -> Register("STHitClusterSM", "SpiRIT", fSMClusterArray, fIsPersistence);
+  RegisterRecoObject("STHitClusterSM", fSMClusterArray, fIsPersistence);
 
   fManipulator = new STSystemManipulator();
 
@@ -58,6 +58,8 @@ InitStatus STSMETask::Init()
 void
 STSMETask::Exec(Option_t *opt)
 {
+  STRecoTaskProfile profile(this);
+
   fSMClusterArray -> Delete();
 
   if (fEventHeader -> IsBadEvent())
@@ -65,5 +67,6 @@ STSMETask::Exec(Option_t *opt)
 
   fManipulator -> Change(fClusterArray, fSMClusterArray);
 
+  auto lock = LockLogger();
   LOG(INFO) << Space() << "STHitCluster system manipulated" << FairLogger::endl;
 }
@@ -0,0 +1,42 @@
+/**
+ * Common part of the test macros in test/.
+ *
+ * A failed check prints a line starting with "***" and counts in
+ * fNumFailed. PrintTestResult() at the end of the macro prints the line
+ * CTest looks for (PASS_REGULAR_EXPRESSION in test/CMakeLists.txt) only
+ * if no check failed.
+ */
+
+#ifndef STTESTUTIL_HH
+#define STTESTUTIL_HH
+
+#include "Rtypes.h"
+#include "TString.h"
+
+#include <cmath>
+#include <iostream>
+
+/// Number of failed checks of the macro
+Int_t fNumFailed = 0;
+
+/// Check that value is within tolerance of reference
+void Check(TString name, Double_t value, Double_t reference, Double_t tolerance)
+{
+  if (!(std::abs(value - reference) <= tolerance)) {
+    std::cout << "*** " << name << " : " << value << " (reference: " << reference << ", tolerance " << tolerance << ")" << std::endl;
+    fNumFailed++;
+  }
+}
+
+/// Print the number of failed checks, or the success line of the macro
+void PrintTestResult()
+{
+  if (fNumFailed != 0) {
+    std::cout << "*** " << fNumFailed << " checks failed" << std::endl;
+    return;
+  }
+
+  std::cout << "Macro finished successfully." << std::endl;
+}
+
+#endif
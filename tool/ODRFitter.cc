@@ -3,16 +3,19 @@
 
 #include "ODRFitter.hh"
 #include <iostream>
+#include <limits>
 using namespace std;
 
 ClassImp(ODRFitter)
 
 ODRFitter::ODRFitter()
 {
-  fNormal = new TVectorD(3);
-  fMatrixA = new TMatrixD(3,3);
-  fEigenValues = new TVectorD(3);
-  fEigenVectors = new TMatrixD(3,3);
+  for (Int_t i = 0; i < 3; i++) {
+    fNormal[i] = 0;
+    fEigenValues[i] = 0;
+    for (Int_t j = 0; j < 3; j++)
+      fEigenVectors[i][j] = 0;
+  }
 
   Reset();
 }
@@ -33,7 +36,7 @@ void ODRFitter::Reset()
 
   for (Int_t i = 0; i < 3; i++)
     for (Int_t j = 0; j < 3; j++)
-      (*fMatrixA)[i][j] = 0;
+      fMatrixA[i][j] = 0;
 
   fRMSLine = -1;
   fRMSPlane = -1;
@@ -56,14 +59,14 @@ void ODRFitter::AddPoint(Double_t x, Double_t y, Double_t z, Double_t w)
   Double_t wy2 = w * dY * dY;
   Double_t wz2 = w * dZ * dZ;
 
-  (*fMatrixA)[0][0] += wx2;
-  (*fMatrixA)[0][1] += w * dX * dY;
-  (*fMatrixA)[0][2] += w * dX * dZ;
+  fMatrixA[0][0] += wx2;
+  fMatrixA[0][1] += w * dX * dY;
+  fMatrixA[0][2] += w * dX * dZ;
 
-  (*fMatrixA)[1][1] += wy2;
-  (*fMatrixA)[1][2] += w * dY * dZ;
+  fMatrixA[1][1] += wy2;
+  fMatrixA[1][2] += w * dY * dZ;
 
-  (*fMatrixA)[2][2] += wz2;
+  fMatrixA[2][2] += wz2;
 
   fSumOfPC2 += wx2 + wy2 + wz2;
   fWeightSum += w;
@@ -78,14 +81,14 @@ void ODRFitter::SetMatrixA(
   Double_t c12, 
   Double_t c22)
 {
-  (*fMatrixA)[0][0] = c00;
-  (*fMatrixA)[0][1] = c01;
-  (*fMatrixA)[0][2] = c02;
+  fMatrixA[0][0] = c00;
+  fMatrixA[0][1] = c01;
+  fMatrixA[0][2] = c02;
 
-  (*fMatrixA)[1][1] = c11;
-  (*fMatrixA)[1][2] = c12;
+  fMatrixA[1][1] = c11;
+  fMatrixA[1][2] = c12;
 
-  (*fMatrixA)[2][2] = c22;
+  fMatrixA[2][2] = c22;
 
   fSumOfPC2 += c00 + c11 + c22;
 }
@@ -95,25 +98,226 @@ void ODRFitter::SetNumPoints(Double_t numPoints) { fNumPoints = numPoints; }
 
 bool ODRFitter::Solve()
 {
-  (*fMatrixA)[1][0] = (*fMatrixA)[0][1];
-  (*fMatrixA)[2][0] = (*fMatrixA)[0][2];
-  (*fMatrixA)[2][1] = (*fMatrixA)[1][2];
+  fMatrixA[1][0] = fMatrixA[0][1];
+  fMatrixA[2][0] = fMatrixA[0][2];
+  fMatrixA[2][1] = fMatrixA[1][2];
 
-  if ((*fMatrixA)[0][0] == 0 && (*fMatrixA)[1][1] == 0 && (*fMatrixA)[2][2] == 0)
+  if (fMatrixA[0][0] == 0 && fMatrixA[1][1] == 0 && fMatrixA[2][2] == 0)
     return false;
 
-  (*fEigenVectors) = fMatrixA -> EigenVectors(*fEigenValues);
+  SolveSymmetric3(fMatrixA, fEigenValues, fEigenVectors);
   return true;
 }
 
+void ODRFitter::SolveSymmetric3(const Double_t a[3][3], Double_t values[3], Double_t vectors[3][3])
+{
+  const Int_t n = 3;
+
+  Double_t (*v)[3] = vectors;
+  Double_t *d = values;
+  Double_t e[3];
+
+  for (Int_t i = 0; i < n; i++)
+    for (Int_t j = 0; j < n; j++)
+      v[i][j] = a[i][j];
+
+  // Householder reduction to tridiagonal form (tred2)
+
+  for (Int_t j = 0; j < n; j++)
+    d[j] = v[n-1][j];
+
+  for (Int_t i = n-1; i > 0; i--)
+  {
+    Double_t scale = 0;
+    Double_t h = 0;
+    for (Int_t k = 0; k < i; k++)
+      scale += TMath::Abs(d[k]);
+
+    if (scale == 0) {
+      e[i] = d[i-1];
+      for (Int_t j = 0; j < i; j++) {
+        d[j] = v[i-1][j];
+        v[i][j] = 0;
+        v[j][i] = 0;
+      }
+    }
+    else {
+      for (Int_t k = 0; k < i; k++) {
+        d[k] /= scale;
+        h += d[k] * d[k];
+      }
+      Double_t f = d[i-1];
+      Double_t g = TMath::Sqrt(h);
+      if (f > 0)
+        g = -g;
+      e[i] = scale * g;
+      h = h - f * g;
+      d[i-1] = f - g;
+      for (Int_t j = 0; j < i; j++)
+        e[j] = 0;
+
+      for (Int_t j = 0; j < i; j++) {
+        f = d[j];
+        v[j][i] = f;
+        g = e[j] + v[j][j] * f;
+        for (Int_t k = j+1; k <= i-1; k++) {
+          g += v[k][j] * d[k];
+          e[k] += v[k][j] * f;
+        }
+        e[j] = g;
+      }
+
+      f = 0;
+      for (Int_t j = 0; j < i; j++) {
+        e[j] /= h;
+        f += e[j] * d[j];
+      }
+      Double_t hh = f / (h + h);
+      for (Int_t j = 0; j < i; j++)
+        e[j] -= hh * d[j];
+
+      for (Int_t j = 0; j < i; j++) {
+        f = d[j];
+        g = e[j];
+        for (Int_t k = j; k <= i-1; k++)
+          v[k][j] -= (f * e[k] + g * d[k]);
+        d[j] = v[i-1][j];
+        v[i][j] = 0;
+      }
+    }
+    d[i] = h;
+  }
+
+  for (Int_t i = 0; i < n-1; i++)
+  {
+    v[n-1][i] = v[i][i];
+    v[i][i] = 1;
+    Double_t h = d[i+1];
+    if (h != 0) {
+      for (Int_t k = 0; k <= i; k++)
+        d[k] = v[k][i+1] / h;
+      for (Int_t j = 0; j <= i; j++) {
+        Double_t g = 0;
+        for (Int_t k = 0; k <= i; k++)
+          g += v[k][i+1] * v[k][j];
+        for (Int_t k = 0; k <= i; k++)
+          v[k][j] -= g * d[k];
+      }
+    }
+    for (Int_t k = 0; k <= i; k++)
+      v[k][i+1] = 0;
+  }
+
+  for (Int_t j = 0; j < n; j++) {
+    d[j] = v[n-1][j];
+    v[n-1][j] = 0;
+  }
+  v[n-1][n-1] = 1;
+  e[0] = 0;
+
+  // QL iteration of the symmetric tridiagonal matrix (tql2)
+
+  for (Int_t i = 1; i < n; i++)
+    e[i-1] = e[i];
+  e[n-1] = 0;
+
+  Double_t f = 0;
+  Double_t tst1 = 0;
+  const Double_t eps = std::numeric_limits<Double_t>::epsilon(); // 2^-52
+
+  for (Int_t l = 0; l < n; l++)
+  {
+    tst1 = TMath::Max(tst1, TMath::Abs(d[l]) + TMath::Abs(e[l]));
+    Int_t m = l;
+    while (m < n - 1) {
+      if (TMath::Abs(e[m]) <= eps * tst1)
+        break;
+      m++;
+    }
+
+    if (m > l) {
+      Int_t iter = 0;
+      do {
+        if (++iter > 30)
+          break;
+
+        Double_t g = d[l];
+        Double_t p = (d[l+1] - g) / (2 * e[l]);
+        Double_t r = TMath::Hypot(p, 1.0);
+        if (p < 0)
+          r = -r;
+        d[l] = e[l] / (p + r);
+        d[l+1] = e[l] * (p + r);
+        Double_t dl1 = d[l+1];
+        Double_t h = g - d[l];
+        for (Int_t i = l+2; i < n; i++)
+          d[i] -= h;
+        f += h;
+
+        p = d[m];
+        Double_t c = 1, c2 = 1, c3 = 1;
+        Double_t el1 = e[l+1];
+        Double_t s = 0, s2 = 0;
+        for (Int_t i = m-1; i >= l; i--) {
+          c3 = c2;
+          c2 = c;
+          s2 = s;
+          g = c * e[i];
+          h = c * p;
+          r = TMath::Hypot(p, e[i]);
+          e[i+1] = s * r;
+          s = e[i] / r;
+          c = p / r;
+          p = c * d[i] - s * g;
+          d[i+1] = h + s * (c * g + s * d[i]);
+          for (Int_t k = 0; k < n; k++) {
+            h = v[k][i+1];
+            v[k][i+1] = s * v[k][i] + c * h;
+            v[k][i] = c * v[k][i] - s * h;
+          }
+        }
+        p = -s * s2 * c3 * el1 * e[l] / dl1;
+        e[l] = s * p;
+        d[l] = c * p;
+      } while (TMath::Abs(e[l]) > eps * tst1);
+    }
+    d[l] = d[l] + f;
+    e[l] = 0;
+  }
+
+  // Sort eigen values and vectors by decending order
+
+  for (Int_t i = 0; i < n-1; i++)
+  {
+    Int_t k = i;
+    Double_t p = d[i];
+    for (Int_t j = i+1; j < n; j++) {
+      if (d[j] > p) {
+        k = j;
+        p = d[j];
+      }
+    }
+    if (k != i) {
+      d[k] = d[i];
+      d[i] = p;
+      for (Int_t j = 0; j < n; j++) {
+        p = v[j][i];
+        v[j][i] = v[j][k];
+        v[j][k] = p;
+      }
+    }
+  }
+}
+
 void ODRFitter::ChooseEigenValue(Int_t iEV)
 {
-  (*fNormal) = TMatrixDColumn((*fEigenVectors), iEV);
+  for (Int_t i = 0; i < 3; i++)
+    fNormal[i] = fEigenVectors[i][iEV];
 
-  fRMSLine = (fSumOfPC2 - (*fEigenValues)[iEV]) / (fWeightSum - 2*fWeightSum/fNumPoints);
+  fRMSLine = (fSumOfPC2 - fEigenValues[iEV]) / (fWeightSum - 2*fWeightSum/fNumPoints);
   fRMSLine = TMath::Sqrt(fRMSLine);
 
-  fRMSPlane = (*fEigenValues)[iEV] / (fWeightSum - 2*fWeightSum/fNumPoints);
+  fRMSPlane = fEigenValues[iEV] / (fWeightSum - 2*fWeightSum/fNumPoints);
   if (fRMSPlane < 0) fRMSPlane = 0;
   fRMSPlane = TMath::Sqrt(fRMSPlane);
 }
@@ -137,8 +341,8 @@ bool ODRFitter::FitPlane()
 }
 
 TVector3 ODRFitter::GetCentroid()  { return TVector3(fXCentroid, fYCentroid, fZCentroid); }
-TVector3 ODRFitter::GetNormal()    { return TVector3((*fNormal)[0], (*fNormal)[1], (*fNormal)[2]); }
-TVector3 ODRFitter::GetDirection() { return TVector3((*fNormal)[0], (*fNormal)[1], (*fNormal)[2]); }
+TVector3 ODRFitter::GetNormal()    { return TVector3(fNormal[0], fNormal[1], fNormal[2]); }
+TVector3 ODRFitter::GetDirection() { return TVector3(fNormal[0], fNormal[1], fNormal[2]); }
    Int_t ODRFitter::GetNumPoints() { return fNumPoints; }
 Double_t ODRFitter::GetWeightSum() { return fWeightSum; }
 Double_t ODRFitter::GetRMSLine()   { return fRMSLine; }
@@ -20,8 +20,6 @@
 #define ODRFITTER
 
 #include "TVector3.h"
-#include "TMatrixD.h"
-#include "TVectorD.h"
 #include "TMath.h"
 #include <iostream>
 
@@ -78,6 +76,23 @@ class ODRFitter
     Double_t GetRMSLine();    ///< Get RMS of the line fit 
     Double_t GetRMSPlane();   ///< Get RMS of the plane fit 
 
+    /**
+     *  @brief  Eigen values and vectors of symmetric 3x3 matrix
+     *
+     *  @param a        symmetric matrix (only read)
+     *  @param values   eigen values sorted by decending order
+     *  @param vectors  vectors[i][j] is i-th component of j-th eigen vector
+     *
+     *  @detail
+     *    Householder tridiagonalization and QL iteration (tred2/tql2)
+     *    done in place on the stack. Same algorithm and sort as
+     *    TMatrixDSymEigen, which is used by TMatrixD::EigenVectors(),
+     *    so the results (including the sign of the eigen vectors) are
+     *    the same as before, without heap allocations.
+     *    Can be called without a fitter object for many matrices.
+     */
+    static void SolveSymmetric3(const Double_t a[3][3], Double_t values[3], Double_t vectors[3][3]);
+
   private:
        Int_t fNumPoints; ///< Number of point set
     Double_t fWeightSum; ///< Sum of weights
@@ -86,18 +101,17 @@ class ODRFitter
     Double_t fXCentroid;
     Double_t fYCentroid;
     Double_t fZCentroid;
-    //TMatrixD *fCentroid;  ///< Centroid position of the point set
-    TVectorD *fNormal;    ///< Normal vector of ODR plane, or vector of ODR line
+    Double_t fNormal[3];  ///< Normal vector of ODR plane, or vector of ODR line
 
-    TMatrixD *fMatrixA;      ///< Matrix A
-    TVectorD *fEigenValues;  ///< eigen values sorted by decending order
-    TMatrixD *fEigenVectors; ///< eigen vectors sorted by decending eigen value order
+    Double_t fMatrixA[3][3];      ///< Matrix A
+    Double_t fEigenValues[3];     ///< eigen values sorted by decending order
+    Double_t fEigenVectors[3][3]; ///< eigen vectors (columns) sorted by decending eigen value order
 
     Double_t fRMSLine; /// Root mean square of the line fit
     Double_t fRMSPlane; /// Root mean square of the plane fit
 
 
-  ClassDef(ODRFitter, 2)
+  ClassDef(ODRFitter, 3)
 };
 
 #endif
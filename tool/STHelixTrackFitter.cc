@@ -2,6 +2,8 @@
 
 #include "STDebugLogger.hh"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 using namespace std;
 
 ClassImp(STHelixTrackFitter)
@@ -50,12 +52,9 @@ STHelixTrackFitter::FitPlane(STHelixTrack *track)
   return true;
 }
 
-bool
-STHelixTrackFitter::Fit(STHelixTrack *track)
+Double_t
+STHelixTrackFitter::ChargeWeightScale(STHelixTrack *track)
 {
-  if (track -> GetNumHits() < 3)
-    return false;
-
   Double_t scale = 1;
   Double_t trackLength = track -> TrackLength();
   Double_t meanCharge = track -> GetChargeSum()/track -> GetNumHits();
@@ -67,67 +66,125 @@ STHelixTrackFitter::Fit(STHelixTrack *track)
     scale = 1 + scaleTrackLength;
   }
 
-  fODRFitter -> Reset();
-
-  Double_t xMean = track -> GetXMean();
-  Double_t zMean = track -> GetZMean();
-  Double_t xCov  = track -> GetXCov();
-  Double_t zCov  = track -> GetZCov();
-  Double_t RSR = 2 * sqrt(xCov + zCov);
-
-  Double_t xMapMean = 0;
-  Double_t yMapMean = 0;
-  Double_t zMapMean = 0;
+  return scale;
+}
 
-  auto hitArray = track -> GetHitArray();
+void
+STHelixTrackFitter::AddToMapSums(STHit *hit, Double_t sign)
+{
+  Double_t x = hit -> GetX() - fMapXRef;
+  Double_t z = hit -> GetZ() - fMapZRef;
+  Double_t w = hit -> GetCharge();
+  if (fMapScale != 1)
+    w = TMath::Power(w, fMapScale);
+  w = sign * w;
+
+  Double_t rEff = sqrt(x*x + z*z) / (2*fMapRSR);
+  Double_t denominator = 1 + rEff*rEff;
+
+  Double_t xMap = x / denominator;
+  Double_t yMap = 2 * fMapRSR * rEff * rEff / denominator;
+  Double_t zMap = z / denominator;
+
+  fSW  += w;
+  fSX  += w * xMap;
+  fSY  += w * yMap;
+  fSZ  += w * zMap;
+  fSXX += w * xMap * xMap;
+  fSXY += w * xMap * yMap;
+  fSXZ += w * xMap * zMap;
+  fSYY += w * yMap * yMap;
+  fSYZ += w * yMap * zMap;
+  fSZZ += w * zMap * zMap;
+
+  Double_t q = sign * hit -> GetCharge();
+  Double_t r2 = x*x + z*z;
+
+  fPX   += q * x;
+  fPZ   += q * z;
+  fPXX  += q * x * x;
+  fPXZ  += q * x * z;
+  fPZZ  += q * z * z;
+  fPR2  += q * r2;
+  fPXR2 += q * x * r2;
+  fPZR2 += q * z * r2;
+  fPR4  += q * r2 * r2;
+}
 
-  Double_t x = 0;
-  Double_t z = 0;
+void
+STHelixTrackFitter::AddToHelixSums(STHit *hit, Double_t alpha, Double_t sign)
+{
+  Double_t x = hit -> GetX() - fXCRef;
+  Double_t y = hit -> GetY();
+  Double_t z = hit -> GetZ() - fZCRef;
+  Double_t w = sign * hit -> GetCharge();
+
+  fHA  += w * alpha;
+  fHAA += w * alpha * alpha;
+  fHY  += w * y;
+  fHYY += w * y * y;
+  fHAY += w * alpha * y;
+
+  // gradient of alpha to the center position
+  Double_t d2 = x*x + z*z;
+  if (d2 == 0)
+    return;
+
+  Double_t gx =  z / d2;
+  Double_t gz = -x / d2;
+
+  fHGX  += w * gx;
+  fHGZ  += w * gz;
+  fHAGX += w * alpha * gx;
+  fHAGZ += w * alpha * gz;
+  fHYGX += w * y * gx;
+  fHYGZ += w * y * gz;
+  fHGXX += w * gx * gx;
+  fHGXZ += w * gx * gz;
+  fHGZZ += w * gz * gz;
+}
 
-  for (auto hit : *hitArray)
-  {
-    x = hit -> GetX() - xMean;
-    z = hit -> GetZ() - zMean;
-    Double_t w = hit -> GetCharge();
-    w = TMath::Power(w, scale);
+Double_t
+STHelixTrackFitter::AlphaFromReference(STHit *hit)
+{
+  Double_t alpha = TMath::ATan2(hit -> GetZ() - fZCRef, hit -> GetX() - fXCRef);
+  return alpha + TMath::TwoPi() * TMath::Nint((fAlphaRef - alpha) / TMath::TwoPi());
+}
 
-    Double_t rEff = sqrt(x*x + z*z) / (2*RSR);
-    Double_t denominator = 1 + rEff*rEff;
+bool
+STHelixTrackFitter::IsIncrementalFor(STHelixTrack *track)
+{
+  return fIncTrack == track && fIncHitGeneration == track -> GetHitGeneration();
+}
 
-    Double_t xMap = x / denominator;
-    Double_t yMap = 2 * RSR * rEff * rEff / denominator;
-    Double_t zMap = z / denominator;
+bool
+STHelixTrackFitter::FitCircle(STHelixTrack *track, Double_t &xC, Double_t &zC, Double_t &radius, bool &isLine)
+{
+  isLine = false;
 
-    xMapMean += w * xMap;
-    yMapMean += w * yMap;
-    zMapMean += w * zMap;
-  }
+  Double_t RSR = fMapRSR;
 
+  // Map mean is normalized by the charge sum, not by the sum of w.
   Double_t weightSum = track -> GetChargeSum();
-  xMapMean = xMapMean / weightSum;
-  yMapMean = yMapMean / weightSum;
-  zMapMean = zMapMean / weightSum;
+  Double_t xMapMean = fSX / weightSum;
+  Double_t yMapMean = fSY / weightSum;
+  Double_t zMapMean = fSZ / weightSum;
+
+  // SUM_i {w_i * (m_i - mapMean)(m_i - mapMean)^T} from the moments
+  Double_t c00 = fSXX - 2*xMapMean*fSX + fSW*xMapMean*xMapMean;
+  Double_t c01 = fSXY - xMapMean*fSY - yMapMean*fSX + fSW*xMapMean*yMapMean;
+  Double_t c02 = fSXZ - xMapMean*fSZ - zMapMean*fSX + fSW*xMapMean*zMapMean;
+  Double_t c11 = fSYY - 2*yMapMean*fSY + fSW*yMapMean*yMapMean;
+  Double_t c12 = fSYZ - yMapMean*fSZ - zMapMean*fSY + fSW*yMapMean*zMapMean;
+  Double_t c22 = fSZZ - 2*zMapMean*fSZ + fSW*zMapMean*zMapMean;
 
+  fODRFitter -> Reset();
   fODRFitter -> SetCentroid(xMapMean, yMapMean, zMapMean);
+  fODRFitter -> SetMatrixA(c00, c01, c02, c11, c12, c22);
+  fODRFitter -> SetWeightSum(fSW);
+  fODRFitter -> SetNumPoints(track -> GetNumHits());
   TVector3 mapMean(xMapMean, yMapMean, zMapMean);
 
-  for (auto hit : *hitArray)
-  {
-    x = hit -> GetX() - xMean;
-    z = hit -> GetZ() - zMean;
-    Double_t w = hit -> GetCharge();
-    w = TMath::Power(w, scale);
-
-    Double_t rEff = sqrt(x*x + z*z) / (2*RSR);
-    Double_t denominator = 1 + rEff*rEff;
-
-    Double_t xMap = x / denominator;
-    Double_t yMap = 2 * RSR * rEff * rEff / denominator;
-    Double_t zMap = z / denominator;
-
-    fODRFitter -> AddPoint(xMap, yMap, zMap, w);
-  }
-
   if (fODRFitter -> Solve() == false)
     return false;
 
@@ -136,7 +193,7 @@ STHelixTrackFitter::Fit(STHelixTrack *track)
   fODRFitter -> ChooseEigenValue(2); TVector3 nToPlane = fODRFitter -> GetDirection();
 
   if (std::abs(nToPlane.Y()) < 1.e-8) {
-    track -> SetIsLine();
+    isLine = true;
     return false;
   }
 
@@ -165,12 +222,46 @@ STHelixTrackFitter::Fit(STHelixTrack *track)
 
   TVector3 FCC = 0.5 * (louuInvMap + highInvMap);
 
-  Double_t xC = FCC.X() + xMean;
-  Double_t zC = FCC.Z() + zMean;
-  Double_t radius = 0.5 * (louuInvMap - highInvMap).Mag();
+  xC = FCC.X() + fMapXRef;
+  zC = FCC.Z() + fMapZRef;
+  radius = 0.5 * (louuInvMap - highInvMap).Mag();
 
   if (radius > 1.e+8) {
-    track -> SetIsLine();
+    isLine = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool
+STHelixTrackFitter::Fit(STHelixTrack *track)
+{
+  fIncTrack = nullptr;
+
+  if (track -> GetNumHits() < 3)
+    return false;
+
+  fMapScale = ChargeWeightScale(track);
+  fMapXRef = track -> GetXMean();
+  fMapZRef = track -> GetZMean();
+  fMapRSR = 2 * sqrt(track -> GetXCov() + track -> GetZCov());
+
+  fSW = 0;
+  fSX = 0; fSY = 0; fSZ = 0;
+  fSXX = 0; fSXY = 0; fSXZ = 0; fSYY = 0; fSYZ = 0; fSZZ = 0;
+  fPX = 0; fPZ = 0; fPXX = 0; fPXZ = 0; fPZZ = 0;
+  fPR2 = 0; fPXR2 = 0; fPZR2 = 0; fPR4 = 0;
+
+  auto hitArray = track -> GetHitArray();
+  for (auto hit : *hitArray)
+    AddToMapSums(hit, 1);
+
+  Double_t xC, zC, radius;
+  bool isLine;
+  if (FitCircle(track, xC, zC, radius, isLine) == false) {
+    if (isLine)
+      track -> SetIsLine();
     return false;
   }
 
@@ -179,12 +270,13 @@ STHelixTrackFitter::Fit(STHelixTrack *track)
 
   track -> SetIsHelix();
 
+  Double_t weightSum = track -> GetChargeSum();
+
   sort(hitArray -> begin(), hitArray -> end(), STHitSortY());
 
   TVector3 position0 = hitArray -> at(0) -> GetPosition();
-  x = position0.X() - xC;
-  z = position0.Z() - zC;
-  Double_t y = 0;
+  Double_t x = position0.X() - xC;
+  Double_t z = position0.Z() - zC;
 
   Double_t alphaInit = TMath::ATan2(z, x);
   TVector2 xAxis(x,z);
@@ -193,21 +285,23 @@ STHelixTrackFitter::Fit(STHelixTrack *track)
   xAxis = xAxis.Unit();
   zAxis = zAxis.Unit();
 
-  Double_t expA  = 0;
-  Double_t expA2 = 0;
-  Double_t expY  = 0;
-  Double_t expAY = 0;
+  fXCRef = xC;
+  fZCRef = zC;
+  fHA = 0; fHAA = 0; fHY = 0; fHYY = 0; fHAY = 0;
+  fHGX = 0; fHGZ = 0; fHAGX = 0; fHAGZ = 0; fHYGX = 0; fHYGZ = 0;
+  fHGXX = 0; fHGXZ = 0; fHGZZ = 0;
 
   Double_t alphaStack = 0;
   Double_t alphaLast = 0;
 
   Double_t alphaMin = alphaInit;
   Double_t alphaMax = alphaInit;
+  fHeadHit = hitArray -> at(0);
+  fTailHit = hitArray -> at(0);
 
   for (auto hit : *hitArray)
   {
     x = hit -> GetX() - xC;
-    y = hit -> GetY();
     z = hit -> GetZ() - zC;;
 
     TVector2 v(x,z);
@@ -233,26 +327,25 @@ STHelixTrackFitter::Fit(STHelixTrack *track)
 
     alphaLast = alphaLast + alphaInit;
 
-    Double_t w = hit -> GetCharge();
+    AddToHelixSums(hit, alphaLast, 1);
 
-    expA  += w * alphaLast;
-    expA2 += w * alphaLast * alphaLast;
-    expY  += w * y;
-    expAY += w * alphaLast * y;
-
-    if (alphaLast < alphaMin)
+    if (alphaLast < alphaMin) {
       alphaMin = alphaLast;
-    if (alphaLast > alphaMax)
+      fHeadHit = hit;
+    }
+    if (alphaLast > alphaMax) {
       alphaMax = alphaLast;
+      fTailHit = hit;
+    }
   }
 
   track -> SetAlphaHead(alphaMin);
   track -> SetAlphaTail(alphaMax);
 
-  expA  /= weightSum;
-  expA2 /= weightSum;
-  expY  /= weightSum;
-  expAY /= weightSum;
+  Double_t expA  = fHA  / weightSum;
+  Double_t expA2 = fHAA / weightSum;
+  Double_t expY  = fHY  / weightSum;
+  Double_t expAY = fHAY / weightSum;
 
   Double_t slope  = (expAY - expA*expY) / (expA2 - expA*expA);
   Double_t offset = (expA2*expY - expA*expAY) / (expA2 - expA*expA);
@@ -280,12 +373,192 @@ STHelixTrackFitter::Fit(STHelixTrack *track)
   track -> SetRMSW(rmsr);
   track -> SetRMSH(rmsy);
 
+  // Sums are kept for FitIncremental() only while the alpha of a hit is unambiguous.
+  fAlphaMin = alphaMin;
+  fAlphaMax = alphaMax;
+  fAlphaRef = 0.5 * (alphaMin + alphaMax);
+  if (alphaMax - alphaMin < TMath::Pi()) {
+    fIncTrack = track;
+    fIncHitGeneration = track -> GetHitGeneration();
+    fIncNumUpdates = 0;
+  }
+
   return true;
 }
 
+void
+STHelixTrackFitter::AddHit(STHelixTrack *track, STHit *hit)
+{
+  bool isIncremental = IsIncrementalFor(track);
+
+  track -> AddHit(hit);
+
+  if (!isIncremental) {
+    if (fIncTrack == track)
+      fIncTrack = nullptr;
+    return;
+  }
+
+  AddToMapSums(hit, 1);
+
+  Double_t alpha = AlphaFromReference(hit);
+  AddToHelixSums(hit, alpha, 1);
+
+  if (alpha < fAlphaMin) {
+    fAlphaMin = alpha;
+    fHeadHit = hit;
+  }
+  if (alpha > fAlphaMax) {
+    fAlphaMax = alpha;
+    fTailHit = hit;
+  }
+
+  fIncHitGeneration = track -> GetHitGeneration();
+  fIncNumUpdates++;
+
+  if (fAlphaMax - fAlphaMin >= TMath::Pi())
+    fIncTrack = nullptr;
+}
+
+void
+STHelixTrackFitter::RemoveHit(STHelixTrack *track, STHit *hit)
+{
+  bool isIncremental = IsIncrementalFor(track);
+
+  track -> Remove(hit);
+
+  if (!isIncremental) {
+    if (fIncTrack == track)
+      fIncTrack = nullptr;
+    return;
+  }
+
+  // New head or tail is not known without the other hits.
+  if (hit == fHeadHit || hit == fTailHit) {
+    fIncTrack = nullptr;
+    return;
+  }
+
+  Double_t alpha = AlphaFromReference(hit);
+
+  AddToMapSums(hit, -1);
+  AddToHelixSums(hit, alpha, -1);
+
+  fIncHitGeneration = track -> GetHitGeneration();
+  fIncNumUpdates++;
+}
+
+bool
+STHelixTrackFitter::FitIncremental(STHelixTrack *track)
+{
+  if (IsIncrementalFor(track) == false
+      || track -> GetNumHits() < fIncMinHits
+      || fIncNumUpdates >= fIncRefitInterval)
+    return Fit(track);
+
+  // Charge weight exponent changes with the track length below 500 mm, and the map
+  // mean of Fit() is sensitive to it. Short tracks are cheap to fit anyway.
+  if (fMapScale != 1 || ChargeWeightScale(track) != 1)
+    return Fit(track);
+
+  // Riemann sphere fit depends on the map reference. Keep it only while the hit
+  // distribution is close to the one of the last full fit; as the track grows,
+  // full fits become geometrically rarer so the cost per hit stays constant.
+  Double_t RSR = 2 * sqrt(track -> GetXCov() + track -> GetZCov());
+  Double_t dXMean = track -> GetXMean() - fMapXRef;
+  Double_t dZMean = track -> GetZMean() - fMapZRef;
+  if (std::abs(RSR - fMapRSR) > fIncMapTolerance * fMapRSR
+      || sqrt(dXMean*dXMean + dZMean*dZMean) > fIncMapTolerance * fMapRSR)
+    return Fit(track);
+
+  Double_t xC, zC, radius;
+  bool isLine;
+  if (FitCircle(track, xC, zC, radius, isLine) == false)
+    return Fit(track);
+
+  // Alpha in the sums is taken around the reference center. For the new center it is
+  // alpha + g.dC to the first order, where g is the gradient of alpha to the center.
+  // Remaining error moves a hit along the circle by about dC^2/radius.
+  Double_t dX = xC - fXCRef;
+  Double_t dZ = zC - fZCRef;
+  Double_t dC2 = dX*dX + dZ*dZ;
+
+  Double_t sumA  = fHA + dX*fHGX + dZ*fHGZ;
+  Double_t sumA2 = fHAA + 2*(dX*fHAGX + dZ*fHAGZ) + dX*dX*fHGXX + 2*dX*dZ*fHGXZ + dZ*dZ*fHGZZ;
+  Double_t sumAY = fHAY + dX*fHYGX + dZ*fHYGZ;
+
+  Double_t weightSum = track -> GetChargeSum();
+
+  Double_t expA  = sumA  / weightSum;
+  Double_t expA2 = sumA2 / weightSum;
+  Double_t expY  = fHY   / weightSum;
+  Double_t expAY = sumAY / weightSum;
+
+  Double_t slope  = (expAY - expA*expY) / (expA2 - expA*expA);
+  Double_t offset = (expA2*expY - expA*expAY) / (expA2 - expA*expA);
+
+  if (std::isinf(slope))
+    return Fit(track);
+
+  if (dC2/radius * std::max(1., std::abs(slope)/radius) > fIncDriftTolerance)
+    return Fit(track);
+
+  track -> SetHelixCenter(xC, zC);
+  track -> SetHelixRadius(radius);
+  track -> SetIsHelix();
+
+  // Head and tail hits are known, so their alpha is exact.
+  Double_t alphaHead = TMath::ATan2(fHeadHit -> GetZ() - zC, fHeadHit -> GetX() - xC);
+  Double_t alphaTail = TMath::ATan2(fTailHit -> GetZ() - zC, fTailHit -> GetX() - xC);
+  alphaHead += TMath::TwoPi() * TMath::Nint((fAlphaMin - alphaHead) / TMath::TwoPi());
+  alphaTail += TMath::TwoPi() * TMath::Nint((fAlphaMax - alphaTail) / TMath::TwoPi());
+
+  track -> SetAlphaHead(alphaHead);
+  track -> SetAlphaTail(alphaTail);
+  track -> SetAlphaSlope(slope);
+  track -> SetYInitial(offset);
+
+  // Same as the RMS of Map() in Fit(): radial distance to the circle and y-distance along the dip.
+  // Radial distance d - radius = f / (d + radius) with f = d^2 - radius^2, which is
+  // a polynomial of the hit position, so SUM_i {w_i * f_i^2} comes from the moments.
+  Double_t cX = xC - fMapXRef;
+  Double_t cZ = zC - fMapZRef;
+  Double_t cR = sqrt(cX*cX + cZ*cZ);
+  Double_t K  = (cR - radius) * (cR + radius);
+
+  Double_t sumF2 = fPR4
+                 + 4 * (cX*cX*fPXX + 2*cX*cZ*fPXZ + cZ*cZ*fPZZ)
+                 + K*K*weightSum
+                 - 4 * (cX*fPXR2 + cZ*fPZR2)
+                 + 2*K*fPR2
+                 - 4*K * (cX*fPX + cZ*fPZ);
+
+  Double_t Sx = sumF2 / (4*radius*radius);
+  Double_t Sy = fHYY - 2*slope*sumAY - 2*offset*fHY
+              + slope*slope*sumA2 + 2*slope*offset*sumA + offset*offset*weightSum;
+  Sy = Sy * (1 + slope*slope/(radius*radius));
+
+  if (Sx < 0) Sx = 0;
+  if (Sy < 0) Sy = 0;
+
+  track -> SetRMSW(sqrt(Sx / weightSum));
+  track -> SetRMSH(sqrt(Sy / weightSum));
+
+  return true;
+}
+
+void STHelixTrackFitter::ResetIncremental() { fIncTrack = nullptr; }
+
+void STHelixTrackFitter::SetIncrementalMinHits(Int_t numHits)          { fIncMinHits = numHits < 4 ? 4 : numHits; }
+void STHelixTrackFitter::SetIncrementalRefitInterval(Int_t numUpdates) { fIncRefitInterval = numUpdates; }
+void STHelixTrackFitter::SetIncrementalDriftTolerance(Double_t dist)   { fIncDriftTolerance = dist; }
+void STHelixTrackFitter::SetIncrementalMapTolerance(Double_t ratio)    { fIncMapTolerance = ratio; }
+
 bool
 STHelixTrackFitter::FitCluster(STHelixTrack *track)
 {
+  fIncTrack = nullptr;
+
   if (track -> GetNumStableClusters() < 3)
     return false;
 
@@ -16,10 +16,109 @@ class STHelixTrackFitter
     bool Fit(STHelixTrack *track);
     bool FitCluster(STHelixTrack *track);
 
+    /**
+     * Add hit to the track and to the weighted sums of the last Fit() of the track.
+     * Same as STHelixTrack::AddHit() if the sums are not of this track.
+     */
+    void AddHit(STHelixTrack *track, STHit *hit);
+
+    /**
+     * Remove hit from the track and from the weighted sums of the last Fit() of the track.
+     * Same as STHelixTrack::Remove() if the sums are not of this track.
+     */
+    void RemoveHit(STHelixTrack *track, STHit *hit);
+
+    /**
+     * Approximation of Fit() without walking over the hits.
+     *
+     * Fit() keeps the weighted moments of the hits on the Riemann sphere (circle fit),
+     * of (x, z, r^2) (RMS) and of (alpha, y) around the fitted center (pitch fit), with
+     * the map reference and the center held fixed. AddHit() and RemoveHit() update them
+     * in O(1) and this method solves the helix from the sums only. Alpha for the new
+     * center is corrected to the first order of the center movement, and the radial
+     * distance of the RMS is taken as (d^2 - R^2)/2R. Agreement with Fit() is checked
+     * by test/testHelixTrackFitter.C (well below 0.1 mm at the hits).
+     *
+     * Full Fit() is done instead when
+     *  - the sums are not of this track, or the track is changed without this fitter
+     *    (STHelixTrack::GetHitGeneration() differs from the one of the sums),
+     *  - the track has less than fIncMinHits hits,
+     *  - fIncRefitInterval updates are made since the last full fit,
+     *  - the track is shorter than 500 mm (charge weight exponent is not 1),
+     *  - mean or spread of the hits changed more than fIncMapTolerance of the map reference,
+     *  - the helix center moved from the reference center so that the error of
+     *    the alpha correction is more than fIncDriftTolerance [mm],
+     *  - the track covers more than pi in alpha, or a hit at the head/tail is removed.
+     */
+    bool FitIncremental(STHelixTrack *track);
+
+    /// Forget the sums, so that the next FitIncremental() does full Fit().
+    void ResetIncremental();
+
+    void SetIncrementalMinHits(Int_t numHits);          ///< Default is 20
+    void SetIncrementalRefitInterval(Int_t numUpdates); ///< Default is 20
+    void SetIncrementalDriftTolerance(Double_t dist);   ///< Default is 0.2 [mm]
+    void SetIncrementalMapTolerance(Double_t ratio);    ///< Default is 0.05
+
+  private:
+    Double_t ChargeWeightScale(STHelixTrack *track);
+
+    /// Add (sign = 1) or subtract (sign = -1) hit to the Riemann sphere sums
+    void AddToMapSums(STHit *hit, Double_t sign);
+    /// Add (sign = 1) or subtract (sign = -1) hit to the alpha-y and radial sums
+    void AddToHelixSums(STHit *hit, Double_t alpha, Double_t sign);
+    /// alpha of hit around the reference center, unwrapped to the reference alpha range
+    Double_t AlphaFromReference(STHit *hit);
+    /// true if the sums were made for the current content of the track
+    bool IsIncrementalFor(STHelixTrack *track);
+
+    /// Circle fit from the Riemann sphere sums. Track is not changed.
+    bool FitCircle(STHelixTrack *track, Double_t &xC, Double_t &zC, Double_t &radius, bool &isLine);
+
   private:
     ODRFitter *fODRFitter;
 
-  ClassDef(STHelixTrackFitter, 2)
+    Int_t    fIncMinHits = 20;
+    Int_t    fIncRefitInterval = 20;
+    Double_t fIncDriftTolerance = 0.2;
+    Double_t fIncMapTolerance = 0.05;
+
+    STHelixTrack *fIncTrack = nullptr; //! track of the sums, nullptr if not valid
+    UInt_t   fIncHitGeneration = 0;    //! STHelixTrack::GetHitGeneration() of the track in the sums
+    Int_t    fIncNumUpdates = 0;       //! AddHit/RemoveHit since the last full fit
+
+    // Riemann sphere map reference
+    Double_t fMapXRef = 0;             //! x origin of the map
+    Double_t fMapZRef = 0;             //! z origin of the map
+    Double_t fMapRSR = 0;              //! radius of the Riemann sphere
+    Double_t fMapScale = 1;            //! charge weight w = charge^scale
+
+    // Riemann sphere sums with weight w
+    Double_t fSW = 0;                                             //!
+    Double_t fSX = 0, fSY = 0, fSZ = 0;                           //!
+    Double_t fSXX = 0, fSXY = 0, fSXZ = 0;                        //!
+    Double_t fSYY = 0, fSYZ = 0, fSZZ = 0;                        //!
+
+    // Moments of (x, z, r^2) around the map origin with weight charge, for RMS
+    Double_t fPX = 0, fPZ = 0, fPXX = 0, fPXZ = 0, fPZZ = 0;      //!
+    Double_t fPR2 = 0, fPXR2 = 0, fPZR2 = 0, fPR4 = 0;            //!
+
+    // Helix reference of the last full fit
+    Double_t fXCRef = 0;               //! x of the reference center
+    Double_t fZCRef = 0;               //! z of the reference center
+    Double_t fAlphaRef = 0;            //! middle of the alpha range of the last full fit
+    Double_t fAlphaMin = 0;            //! alpha of fHeadHit around the reference center
+    Double_t fAlphaMax = 0;            //! alpha of fTailHit around the reference center
+    STHit *fHeadHit = nullptr;         //! hit with the smallest alpha
+    STHit *fTailHit = nullptr;         //! hit with the largest alpha
+
+    // alpha-y sums around the reference center with weight charge,
+    // and with the gradient g of alpha to the center position
+    Double_t fHA = 0, fHAA = 0, fHY = 0, fHYY = 0, fHAY = 0;      //!
+    Double_t fHGX = 0, fHGZ = 0, fHAGX = 0, fHAGZ = 0;            //!
+    Double_t fHYGX = 0, fHYGZ = 0, fHGXX = 0, fHGXZ = 0, fHGZZ = 0; //!
+
+  ClassDef(STHelixTrackFitter, 3)
 };
 
 #endif
@@ -0,0 +1,68 @@
+#include "STHitTable.hh"
+
+ClassImp(STHitTable)
+
+void
+STHitTable::Clear()
+{
+  fNumHits = 0;
+
+  fHits.clear();
+  fX.clear();
+  fY.clear();
+  fZ.clear();
+  fDx.clear();
+  fDy.clear();
+  fDz.clear();
+  fCharge.clear();
+  fTb.clear();
+  fRow.clear();
+  fLayer.clear();
+  fOwner.clear();
+}
+
+void
+STHitTable::Fill(TClonesArray *hitArray)
+{
+  fNumHits = hitArray -> GetEntries();
+
+  fHits.resize(fNumHits);
+  fX.resize(fNumHits);
+  fY.resize(fNumHits);
+  fZ.resize(fNumHits);
+  fDx.resize(fNumHits);
+  fDy.resize(fNumHits);
+  fDz.resize(fNumHits);
+  fCharge.resize(fNumHits);
+  fTb.resize(fNumHits);
+  fRow.resize(fNumHits);
+  fLayer.resize(fNumHits);
+  fOwner.assign(fNumHits, -1);
+
+  for (Int_t iHit = 0; iHit < fNumHits; iHit++)
+  {
+    auto hit = (STHit *) hitArray -> At(iHit);
+    fHits[iHit] = hit;
+
+    fX[iHit] = hit -> GetX();
+    fY[iHit] = hit -> GetY();
+    fZ[iHit] = hit -> GetZ();
+    fDx[iHit] = hit -> GetDx();
+    fDy[iHit] = hit -> GetDy();
+    fDz[iHit] = hit -> GetDz();
+    fCharge[iHit] = hit -> GetCharge();
+    fTb[iHit] = hit -> GetTb();
+    fRow[iHit] = hit -> GetRow();
+    fLayer[iHit] = hit -> GetLayer();
+  }
+}
+
+void
+STHitTable::MakeHit(Int_t idx, STHit *hit) const
+{
+  hit -> SetHit(idx, fX[idx], fY[idx], fZ[idx], fCharge[idx]);
+  hit -> SetPosSigma(fDx[idx], fDy[idx], fDz[idx]);
+  hit -> SetRow(fRow[idx]);
+  hit -> SetLayer(fLayer[idx]);
+  hit -> SetTb(fTb[idx]);
+}
@@ -0,0 +1,76 @@
+#ifndef STHITTABLE
+#define STHITTABLE
+
+#include "STHit.hh"
+#include "TClonesArray.h"
+#include <vector>
+
+/**
+ * Hits of an event in columns for the tracking.
+ *
+ * Fill() reads position, position sigma, charge, row, layer and time bucket
+ * of each hit once, so that loops over the hits of the event read contiguous
+ * arrays instead of calling the getters (and GetPosition()) of each STHit.
+ * Index in the table is the index in the hit array.
+ *
+ * Owner track of each hit (-1 if none) is kept in the table, apart from
+ * the track candidates of STHit.
+ */
+class STHitTable
+{
+  public:
+    STHitTable() {};
+    ~STHitTable() {};
+
+    void Clear();
+
+    /// Fill columns from hitArray. Owners are set to -1.
+    void Fill(TClonesArray *hitArray);
+
+    Int_t GetNumHits() const { return fNumHits; }
+
+    const Double_t *GetX()      const { return fX.data(); }
+    const Double_t *GetY()      const { return fY.data(); }
+    const Double_t *GetZ()      const { return fZ.data(); }
+    const Double_t *GetDx()     const { return fDx.data(); }
+    const Double_t *GetDy()     const { return fDy.data(); }
+    const Double_t *GetDz()     const { return fDz.data(); }
+    const Double_t *GetCharge() const { return fCharge.data(); }
+    const Double_t *GetTb()     const { return fTb.data(); }
+    const    Int_t *GetRow()    const { return fRow.data(); }
+    const    Int_t *GetLayer()  const { return fLayer.data(); }
+    const    Int_t *GetOwner()  const { return fOwner.data(); }
+
+    /// STHit of the hit array at index
+    STHit *GetHit(Int_t idx) const { return fHits[idx]; }
+
+    Int_t GetOwner(Int_t idx) const { return fOwner[idx]; }
+    void SetOwner(Int_t idx, Int_t trackID) { fOwner[idx] = trackID; }
+
+    /**
+     * Write hit of index to hit, with hit ID idx.
+     * Same as STHit::SetHit(STHit *) but cluster ID, track ID,
+     * chi-square and NDF are not set.
+     */
+    void MakeHit(Int_t idx, STHit *hit) const;
+
+  private:
+    Int_t fNumHits = 0;
+
+    std::vector<STHit *> fHits;      //!
+    std::vector<Double_t> fX;        //!
+    std::vector<Double_t> fY;        //!
+    std::vector<Double_t> fZ;        //!
+    std::vector<Double_t> fDx;       //!
+    std::vector<Double_t> fDy;       //!
+    std::vector<Double_t> fDz;       //!
+    std::vector<Double_t> fCharge;   //!
+    std::vector<Double_t> fTb;       //!
+    std::vector<Int_t> fRow;         //!
+    std::vector<Int_t> fLayer;       //!
+    std::vector<Int_t> fOwner;       //! owner track ID, -1 if none
+
+  ClassDef(STHitTable, 1)
+};
+
+#endif
@@ -1,207 +1,317 @@
 #include "STPadPlaneMap.hh"
 #include <iostream>
+#include <climits>
+#include <cstring>
 using namespace std;
 
-void STPadHitContainer::Clear()
-{
-  fHitArray.clear();
-}
+namespace {
+  /// Neighbor pads of (row, layer) are (row + drow[i], layer + dlayer[i])
+  const Int_t drow[]   = {0, 0, 1, -1};
+  const Int_t dlayer[] = {-1, 1, 0, 0};
 
-void STPadHitContainer::AddNeighbor(STPadHitContainer *neighbor)
-{
-  fNeighbors.push_back(neighbor);
+  /// Bits of occupancy word iWord for the indices lo <= index <= hi
+  ULong64_t RangeMask(Int_t iWord, Int_t lo, Int_t hi)
+  {
+    Int_t l = lo - iWord * 64;
+    Int_t h = hi - iWord * 64;
+    if (h < 0 || l > 63 || l > h)
+      return 0;
+    if (l < 0) l = 0;
+    if (h > 63) h = 63;
+
+    ULong64_t mask = (h == 63) ? ~0ULL : ((1ULL << (h + 1)) - 1);
+    return mask & ~((1ULL << l) - 1);
+  }
+
+  /// Index of the lowest set bit of bits, which must not be 0
+  inline Int_t LowestBit(ULong64_t bits)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    Int_t index = 0;
+    while (!(bits & 1ULL)) {
+      bits >>= 1;
+      index++;
+    }
+    return index;
+#endif
+  }
+
+  /// Index of the highest set bit of bits, which must not be 0
+  inline Int_t HighestBit(ULong64_t bits)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(bits);
+#else
+    Int_t index = 63;
+    while (!(bits & (1ULL << 63))) {
+      bits <<= 1;
+      index--;
+    }
+    return index;
+#endif
+  }
 }
 
-pads_t *STPadHitContainer::GetNeighbors() { return &fNeighbors; }
+ClassImp(STPadPlaneMap)
 
-void STPadHitContainer::AddHit(STHit *hit)
+STPadPlaneMap::STPadPlaneMap()
 {
-  fHitArray.push_back(hit);
+  for (Int_t pad = 0; pad < fNumPads; pad++) {
+    fPadHead[pad] = -1;
+    fPadTail[pad] = -1;
+    fPadTouched[pad] = false;
+    fVisitStamp[pad] = 0;
+  }
+
+  memset(fRowOccupancy, 0, sizeof(fRowOccupancy));
+  memset(fLayerOccupancy, 0, sizeof(fLayerOccupancy));
 }
 
-void STPadHitContainer::GetHits(hits_t *array)
+void STPadPlaneMap::Clear()
 {
-  for (auto hit : fHitArray)
-    array -> push_back(hit);
+  for (auto pad : fTouchedPads) {
+    fPadHead[pad] = -1;
+    fPadTail[pad] = -1;
+    fPadTouched[pad] = false;
+  }
+  fTouchedPads.clear();
+
+  memset(fRowOccupancy, 0, sizeof(fRowOccupancy));
+  memset(fLayerOccupancy, 0, sizeof(fLayerOccupancy));
+
+  fNodes.clear();
+  fFreeNode = -1;
+
+  fEndOfMap = false;
+  fNextRow = 107;
+  fNextLayer = 90;
+  fEndOfFreeMap = false;
+  fNextFreeRow = 107;
+  fNextFreeLayer = 90;
 }
 
-STHit *STPadHitContainer::PullOutNextHit()
+void STPadPlaneMap::SetOccupancy(Int_t row, Int_t layer, bool on)
 {
-  if (fHitArray.size() == 0)
-    return nullptr;
+  ULong64_t layerBit = 1ULL << (layer % 64);
+  ULong64_t rowBit = 1ULL << (row % 64);
 
-  STHit *hit = fHitArray.back();
-  fHitArray.pop_back();
-  return hit;
+  if (on) {
+    fRowOccupancy[row][layer / 64] |= layerBit;
+    fLayerOccupancy[layer][row / 64] |= rowBit;
+  }
+  else {
+    fRowOccupancy[row][layer / 64] &= ~layerBit;
+    fLayerOccupancy[layer][row / 64] &= ~rowBit;
+  }
 }
 
-STHit *STPadHitContainer::PullOutNextFreeHit()
+Int_t STPadPlaneMap::PrevOccupiedRow(Int_t layer, Int_t row)
 {
-  Int_t numHits = fHitArray.size();
-  if (numHits == 0)
-    return nullptr;
-
-  for (Int_t i = 0; i < numHits; i++) {
-    Int_t idx = numHits-i-1;
-    STHit *hit = fHitArray[idx];
-    if (hit -> GetNumTrackCands() == 0) {
-      fHitArray.erase(fHitArray.begin()+idx);
-      return hit;
+  if (row < 0)
+    return -1;
+
+  for (Int_t iWord = row / 64; iWord >= 0; iWord--) {
+    ULong64_t bits = fLayerOccupancy[layer][iWord];
+    if (iWord == row / 64) {
+      Int_t shift = 63 - row % 64;
+      bits = (bits << shift) >> shift;
     }
+    if (bits != 0)
+      return iWord * 64 + HighestBit(bits);
   }
 
-  return nullptr;
+  return -1;
 }
 
-
-void STPadHitContainer::PullOutHits(hits_t *array)
+void STPadPlaneMap::AddHit(STHit *hit)
 {
-  auto numHits = fHitArray.size();
-  for (Int_t iHit = 0; iHit < numHits; iHit++) 
-  {
-    STHit *hit = fHitArray.back();
-    fHitArray.pop_back();
-    array -> push_back(hit);
+  Int_t row = hit -> GetRow();
+  Int_t layer = hit -> GetLayer();
+  Int_t pad = PadIndex(row, layer);
+
+  Int_t node = fFreeNode;
+  if (node != -1)
+    fFreeNode = fNodes[node].fNext;
+  else {
+    node = fNodes.size();
+    fNodes.push_back(STPadHitNode());
+  }
+
+  fNodes[node].fHit = hit;
+  fNodes[node].fPrev = fPadTail[pad];
+  fNodes[node].fNext = -1;
+
+  if (fPadTail[pad] == -1) {
+    fPadHead[pad] = node;
+    SetOccupancy(row, layer, true);
+    if (!fPadTouched[pad]) {
+      fPadTouched[pad] = true;
+      fTouchedPads.push_back(pad);
+    }
   }
+  else
+    fNodes[fPadTail[pad]].fNext = node;
+
+  fPadTail[pad] = node;
 }
 
-ClassImp(STPadPlaneMap)
+void STPadPlaneMap::AddHits(hits_t *hits)
+{
+  for (auto hit : *hits)
+    AddHit(hit);
+}
 
-STPadPlaneMap::STPadPlaneMap()
+STHit *STPadPlaneMap::RemoveNode(Int_t pad, Int_t node)
 {
-  for (Int_t row = 0; row < 108; row++)
-    for (Int_t layer = 0; layer < 112; layer++) 
-      fPadMap[row][layer] = new STPadHitContainer();
+  STPadHitNode &hitNode = fNodes[node];
 
-  Int_t drow[]   = {0, 0, 1, -1};
-  Int_t dlayer[] = {-1, 1, 0, 0};
+  if (hitNode.fPrev != -1) fNodes[hitNode.fPrev].fNext = hitNode.fNext;
+  else                     fPadHead[pad] = hitNode.fNext;
 
-  for (Int_t row = 0; row < 108; row++) {
-    for (Int_t layer = 0; layer < 112; layer++) {
+  if (hitNode.fNext != -1) fNodes[hitNode.fNext].fPrev = hitNode.fPrev;
+  else                     fPadTail[pad] = hitNode.fPrev;
 
-      for (Int_t i = 0; i < 4; i++) {
-        Int_t rowNb = row + drow[i];
-        Int_t layerNb = layer + dlayer[i];
-
-        if (rowNb < 0 || rowNb >= 108 || layerNb < 0 || layerNb >= 112 )
-          continue;
+  if (fPadHead[pad] == -1)
+    SetOccupancy(pad / fNumLayers, pad % fNumLayers, false);
 
-        fPadMap[row][layer] -> AddNeighbor(fPadMap[rowNb][layerNb]);
-      }
+  hitNode.fNext = fFreeNode;
+  fFreeNode = node;
 
-    }
-  }
+  return hitNode.fHit;
 }
 
-void STPadPlaneMap::Clear()
+void STPadPlaneMap::PullOutPad(Int_t pad, hits_t *array)
 {
-  for (Int_t row = 0; row < 108; row++)
-    for (Int_t layer = 0; layer < 112; layer++) 
-      fPadMap[row][layer] -> Clear();
+  Int_t tail = fPadTail[pad];
+  if (tail == -1)
+    return;
 
-  fEndOfMap = false;
-  fNextRow = 107;
-  fNextLayer = 90;
-  fEndOfFreeMap = false;
-  fNextFreeRow = 107;
-  fNextFreeLayer = 90;
-}
+  for (Int_t node = tail; node != -1; node = fNodes[node].fPrev)
+    array -> push_back(fNodes[node].fHit);
 
-void STPadPlaneMap::AddHit(STHit *hit)
-{
-  fPadMap[hit->GetRow()][hit->GetLayer()] -> AddHit(hit);
+  // Whole list of the pad goes back to the pool at once
+  fNodes[tail].fNext = fFreeNode;
+  fFreeNode = fPadHead[pad];
+
+  fPadHead[pad] = -1;
+  fPadTail[pad] = -1;
+  SetOccupancy(pad / fNumLayers, pad % fNumLayers, false);
 }
 
-void STPadPlaneMap::AddHits(hits_t *hits)
+void STPadPlaneMap::CopyPad(Int_t pad, hits_t *array)
 {
-  for (auto hit : *hits)
-    fPadMap[hit->GetRow()][hit->GetLayer()] -> AddHit(hit);
+  for (Int_t node = fPadHead[pad]; node != -1; node = fNodes[node].fNext)
+    array -> push_back(fNodes[node].fHit);
 }
 
-STHit *STPadPlaneMap::PullOutNextHit()
+STHit *STPadPlaneMap::PullOutNextHit(Int_t &row, Int_t &layer, bool &endOfMap, bool freeOnly)
 {
-  if (fEndOfMap)
-    return nullptr;
+  while (!endOfMap)
+  {
+    row = PrevOccupiedRow(layer, row);
 
-  STHit *hit = fPadMap[fNextRow][fNextLayer] -> PullOutNextHit();
+    if (row != -1) {
+      Int_t pad = PadIndex(row, layer);
+      for (Int_t node = fPadTail[pad]; node != -1; node = fNodes[node].fPrev)
+        if (!freeOnly || fNodes[node].fHit -> GetNumTrackCands() == 0)
+          return RemoveNode(pad, node);
 
-  if (hit == nullptr) {
-    if (fNextRow == 0) {
-      fNextLayer--;
+      if (row > 0) {
+        row--;
+        continue;
+      }
+    }
 
-      if (fNextLayer == -1)
-        fNextLayer = 111;
-      else if (fNextLayer == 90)
-        fEndOfMap = true;
+    layer--;
 
-      fNextRow = 107;
-    } else
-      fNextRow--;
+    if (layer == -1)
+      layer = 111;
+    else if (layer == 90)
+      endOfMap = true;
 
-    return PullOutNextHit();
+    row = 107;
   }
-  else
-    return hit;
+
+  return nullptr;
 }
 
-STHit *STPadPlaneMap::PullOutNextFreeHit()
+STHit *STPadPlaneMap::PullOutNextHit()
 {
-  if (fEndOfFreeMap)
-    return nullptr;
-
-  STHit *hit = fPadMap[fNextFreeRow][fNextFreeLayer] -> PullOutNextFreeHit();
-
-  if (hit == nullptr) {
-    if (fNextFreeRow == 0) {
-      fNextFreeLayer--;
-
-      if (fNextFreeLayer == -1)
-        fNextFreeLayer = 111;
-      else if (fNextFreeLayer == 90)
-        fEndOfFreeMap = true;
-
-      fNextFreeRow = 107;
-    } else
-      fNextFreeRow--;
+  return PullOutNextHit(fNextRow, fNextLayer, fEndOfMap, false);
+}
 
-    return PullOutNextFreeHit();
-  }
-  else
-    return hit;
+STHit *STPadPlaneMap::PullOutNextFreeHit()
+{
+  return PullOutNextHit(fNextFreeRow, fNextFreeLayer, fEndOfFreeMap, true);
 }
 
 void STPadPlaneMap::PullOutNeighborHits(hits_t *hits, hits_t *array, Int_t level)
 {
   for (auto hit : *hits)
   {
-    auto pad = fPadMap[hit->GetRow()][hit->GetLayer()];
-    auto neighbors = pad -> GetNeighbors();
-    while (level > 0)
-    {
-      pads_t neighborsSum;
-      for (auto neighbor : *neighbors) {
-        auto neighbors2 = pad -> GetNeighbors();
-        for (auto neighbor2 : *neighbors2)
-          neighborsSum.push_back(neighbor2);
-      }
-      for (auto neighbor2 : neighborsSum)
-        neighbors -> push_back(neighbor2);
-      level--;
+    if (fStamp == INT_MAX) {
+      for (Int_t pad = 0; pad < fNumPads; pad++)
+        fVisitStamp[pad] = 0;
+      fStamp = 0;
     }
-    for (auto neighbor : *neighbors)
+    fStamp++;
+
+    Int_t origin = PadIndex(hit -> GetRow(), hit -> GetLayer());
+    fVisitStamp[origin] = fStamp;
+
+    fBFSQueue.clear();
+    fBFSDepth.clear();
+    fBFSQueue.push_back(origin);
+    fBFSDepth.push_back(0);
+
+    for (size_t iQueue = 0; iQueue < fBFSQueue.size(); iQueue++)
     {
-      neighbor -> PullOutHits(array);
+      Int_t pad = fBFSQueue[iQueue];
+      Int_t depth = fBFSDepth[iQueue];
+
+      if (depth > 0)
+        PullOutPad(pad, array);
+
+      if (depth > level)
+        continue;
+
+      Int_t row = pad / fNumLayers;
+      Int_t layer = pad % fNumLayers;
+
+      for (Int_t i = 0; i < 4; i++) {
+        Int_t rowNb = row + drow[i];
+        Int_t layerNb = layer + dlayer[i];
+
+        if (rowNb < 0 || rowNb >= fNumRows || layerNb < 0 || layerNb >= fNumLayers)
+          continue;
+
+        Int_t padNb = PadIndex(rowNb, layerNb);
+        if (fVisitStamp[padNb] == fStamp)
+          continue;
+
+        fVisitStamp[padNb] = fStamp;
+        fBFSQueue.push_back(padNb);
+        fBFSDepth.push_back(depth + 1);
+      }
     }
   }
 }
 
 void STPadPlaneMap::PullOutNeighborHits(STHit *hit, hits_t *array)
 {
-  auto pad = fPadMap[hit->GetRow()][hit->GetLayer()];
-  auto neighbors = pad -> GetNeighbors();
-  for (auto neighbor : *neighbors)
-  {
-    neighbor -> PullOutHits(array);
+  Int_t row = hit -> GetRow();
+  Int_t layer = hit -> GetLayer();
+
+  for (Int_t i = 0; i < 4; i++) {
+    Int_t rowNb = row + drow[i];
+    Int_t layerNb = layer + dlayer[i];
+
+    if (rowNb < 0 || rowNb >= fNumRows || layerNb < 0 || layerNb >= fNumLayers)
+      continue;
+
+    PullOutPad(PadIndex(rowNb, layerNb), array);
   }
 }
 
@@ -212,67 +322,103 @@ void STPadPlaneMap::PullOutNeighborHits(TVector3 pos, Double_t range, hits_t *ar
   Int_t rowRange = (range+4)/8;
   Int_t layerRange = (range+6)/12;
 
-  for (auto iRow = -rowRange; iRow <= rowRange; iRow++) {
-    for (auto iLayer = -layerRange; iLayer <= layerRange; iLayer++) {
-      Int_t rowNb = row+iRow;
-      Int_t layerNb = layer+iLayer;
-      if (rowNb < 0 || rowNb >= 108 || layerNb < 0 || layerNb >= 112 )
-        continue;
-      fPadMap[rowNb][layerNb] -> PullOutHits(array);
+  for (auto rowNb = row - rowRange; rowNb <= row + rowRange; rowNb++) {
+    if (rowNb < 0 || rowNb >= fNumRows)
+      continue;
+
+    for (Int_t iWord = 0; iWord < 2; iWord++) {
+      ULong64_t bits = fRowOccupancy[rowNb][iWord] & RangeMask(iWord, layer - layerRange, layer + layerRange);
+      while (bits != 0) {
+        Int_t layerNb = iWord * 64 + LowestBit(bits);
+        bits &= bits - 1;
+        PullOutPad(PadIndex(rowNb, layerNb), array);
+      }
     }
   }
 }
 
 void STPadPlaneMap::PullOutPadHits(Int_t row, Int_t layer, hits_t *array)
 {
-  if (row < 0 || row >= 108 || layer< 0 || layer>= 112 )
+  if (row < 0 || row >= fNumRows || layer < 0 || layer >= fNumLayers)
     return;
 
-  fPadMap[row][layer] -> PullOutHits(array);
+  PullOutPad(PadIndex(row, layer), array);
 }
 
 void STPadPlaneMap::PullOutRowHits(Int_t row, hits_t *array)
 {
-  if (row < 0 || row >= 108)
+  if (row < 0 || row >= fNumRows)
     return;
 
-  for (Int_t layer = 0; layer < 112; layer++) 
-    fPadMap[row][layer] -> PullOutHits(array);
+  for (Int_t iWord = 0; iWord < 2; iWord++) {
+    ULong64_t bits = fRowOccupancy[row][iWord];
+    while (bits != 0) {
+      Int_t layer = iWord * 64 + LowestBit(bits);
+      bits &= bits - 1;
+      PullOutPad(PadIndex(row, layer), array);
+    }
+  }
 }
 
 void STPadPlaneMap::PullOutLayerHits(Int_t layer, hits_t *array)
 {
-  if (layer< 0 || layer>= 112 )
+  if (layer < 0 || layer >= fNumLayers)
     return;
 
-  for (Int_t row = 0; row < 108; row++) 
-    fPadMap[row][layer] -> PullOutHits(array);
+  for (Int_t iWord = 0; iWord < 2; iWord++) {
+    ULong64_t bits = fLayerOccupancy[layer][iWord];
+    while (bits != 0) {
+      Int_t row = iWord * 64 + LowestBit(bits);
+      bits &= bits - 1;
+      PullOutPad(PadIndex(row, layer), array);
+    }
+  }
 }
 
 void STPadPlaneMap::GetNeighborHits(STHit *hit, hits_t *array)
 {
-  auto pad = fPadMap[hit->GetRow()][hit->GetLayer()];
-  auto neighbors = pad -> GetNeighbors();
-  for (auto neighbor : *neighbors)
-    neighbor -> GetHits(array);
+  Int_t row = hit -> GetRow();
+  Int_t layer = hit -> GetLayer();
+
+  for (Int_t i = 0; i < 4; i++) {
+    Int_t rowNb = row + drow[i];
+    Int_t layerNb = layer + dlayer[i];
+
+    if (rowNb < 0 || rowNb >= fNumRows || layerNb < 0 || layerNb >= fNumLayers)
+      continue;
+
+    CopyPad(PadIndex(rowNb, layerNb), array);
+  }
 }
 
 void STPadPlaneMap::GetRowHits(Int_t row, hits_t *array)
 {
-  if (row < 0 || row >= 108)
+  if (row < 0 || row >= fNumRows)
     return;
 
-  for (Int_t layer = 0; layer < 112; layer++) 
-    fPadMap[row][layer] -> GetHits(array);
+  for (Int_t iWord = 0; iWord < 2; iWord++) {
+    ULong64_t bits = fRowOccupancy[row][iWord];
+    while (bits != 0) {
+      Int_t layer = iWord * 64 + LowestBit(bits);
+      bits &= bits - 1;
+      CopyPad(PadIndex(row, layer), array);
+    }
+  }
 }
 
 void STPadPlaneMap::GetLayerHits(Int_t layer, hits_t *array)
 {
-  if (layer< 0 || layer>= 112 )
+  if (layer < 0 || layer >= fNumLayers)
     return;
 
-  for (Int_t row = 0; row < 108; row++) 
-    fPadMap[row][layer] -> GetHits(array);
+  for (Int_t iWord = 0; iWord < 2; iWord++) {
+    ULong64_t bits = fLayerOccupancy[layer][iWord];
+    while (bits != 0) {
+      Int_t row = iWord * 64 + LowestBit(bits);
+      bits &= bits - 1;
+      CopyPad(PadIndex(row, layer), array);
+    }
+  }
 }
 
 Int_t STPadPlaneMap::CalculateRow(Double_t x)   { return Int_t((x+432)/8); }
@@ -4,33 +4,21 @@
 #include "STHit.hh"
 #include <vector>
 
-class STPadHitContainer;
-
-typedef std::vector<STPadHitContainer *> pads_t;
 typedef std::vector<STHit *> hits_t;
 
-class STPadHitContainer
-{
-  public:
-    STPadHitContainer() {};
-    ~STPadHitContainer() {};
-
-    void Clear();
-
-    void AddNeighbor(STPadHitContainer *pad);
-    pads_t *GetNeighbors();
-
-    void AddHit(STHit *hit);
-    STHit *PullOutNextHit();
-    STHit *PullOutNextFreeHit();
-    void PullOutHits(hits_t *array);
-    void GetHits(hits_t *array);
-
-  private:
-    hits_t fHitArray;
-    pads_t fNeighbors;
-};
-
+/**
+ * Map of hits on the pad plane (108 rows x 112 layers) for the track finder.
+ *
+ * Hits of all pads are kept in one node pool. Each pad holds a linked list
+ * of node indices (head to tail in order of AddHit), so adding and pulling
+ * out hits never allocates once the pool has grown to the event size.
+ * Non-empty pads are marked in occupancy bitmaps of each row and layer,
+ * so scans over rows, layers and ranges only visit pads with hits, and
+ * Clear() only resets pads touched since the last Clear().
+ *
+ * Order of the pulled out hits is the same as the previous implementation
+ * with one container object per pad: last added hit of a pad comes first.
+ */
 class STPadPlaneMap
 {
   public:
@@ -44,6 +32,11 @@ class STPadPlaneMap
 
     STHit *PullOutNextHit();
     STHit *PullOutNextFreeHit();
+    /**
+     * Pull out hits of the pads around the pads of hits.
+     * Pads up to (level + 1) steps of row/layer from the pad of each hit are
+     * visited in breadth first order; the pad of the hit itself is not.
+     */
     void PullOutNeighborHits(hits_t *hits, hits_t *array, Int_t level = 0);
     void PullOutNeighborHits(STHit *hit, hits_t *array);
     void PullOutNeighborHits(TVector3 pos, Double_t range, hits_t *array);
@@ -61,7 +54,48 @@ class STPadPlaneMap
     Double_t CalculateZ(Int_t layer);
 
   private:
-    STPadHitContainer *fPadMap[108][112];
+    static const Int_t fNumRows = 108;
+    static const Int_t fNumLayers = 112;
+    static const Int_t fNumPads = fNumRows * fNumLayers;
+
+    Int_t PadIndex(Int_t row, Int_t layer) { return row * fNumLayers + layer; }
+
+    /// Remove node from the list of pad and give it back to the pool
+    STHit *RemoveNode(Int_t pad, Int_t node);
+    /// Pull out all hits of pad from tail to head
+    void PullOutPad(Int_t pad, hits_t *array);
+    /// Copy hits of pad from head to tail
+    void CopyPad(Int_t pad, hits_t *array);
+
+    /// Set (on) or clear occupancy bits of pad
+    void SetOccupancy(Int_t row, Int_t layer, bool on);
+    /// Largest row <= row with hits in layer, -1 if none
+    Int_t PrevOccupiedRow(Int_t layer, Int_t row);
+
+    /// Move cursor (row, layer) over the pads in the order of PullOutNextHit()
+    STHit *PullOutNextHit(Int_t &row, Int_t &layer, bool &endOfMap, bool freeOnly);
+
+    struct STPadHitNode {
+      STHit *fHit;
+      Int_t fPrev;
+      Int_t fNext;
+    };
+
+    std::vector<STPadHitNode> fNodes;  //! node pool
+    Int_t fFreeNode = -1;              //! head of the recycled nodes, linked by fNext
+
+    Int_t fPadHead[fNumPads];          //! first node of pad, -1 if empty
+    Int_t fPadTail[fNumPads];          //! last node of pad, -1 if empty
+    bool fPadTouched[fNumPads];        //! pad had hits since the last Clear()
+    std::vector<Int_t> fTouchedPads;   //! pads to reset in Clear()
+
+    ULong64_t fRowOccupancy[fNumRows][2];     //! bit (layer) is set if pad has hits
+    ULong64_t fLayerOccupancy[fNumLayers][2]; //! bit (row) is set if pad has hits
+
+    std::vector<Int_t> fBFSQueue;      //! pads to visit in PullOutNeighborHits()
+    std::vector<Int_t> fBFSDepth;      //! step of the pads in fBFSQueue
+    Int_t fVisitStamp[fNumPads];       //! fStamp of the last visit of pad
+    Int_t fStamp = 0;                  //!
 
     bool fEndOfMap = false;
     Int_t fNextRow = 107;
@@ -71,7 +105,7 @@ class STPadPlaneMap
     Int_t fNextFreeRow = 107;
     Int_t fNextFreeLayer = 90;
 
-  ClassDef(STPadPlaneMap, 1)
+  ClassDef(STPadPlaneMap, 2)
 };
 
 #endif
@@ -10,6 +10,7 @@
 #pragma link C++ class ODRFitter+;
 #pragma link C++ class STHelixTrackFitter+;
 #pragma link C++ class STPadPlaneMap+;
+#pragma link C++ class STHitTable+;
 #pragma link C++ class STSamplePoint+;
 
 #endif
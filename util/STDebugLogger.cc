@@ -7,46 +7,102 @@ using namespace std;
 
 ClassImp(STDebugLogger)
 
-STDebugLogger* STDebugLogger::fInstance = NULL;
+/// Per-thread storage of the handle interface
+struct STDebugLogger::Shard
+{
+  Long64_t generation;                       ///< fGeneration of the logger which owns the shard
+  std::vector<std::vector<Double_t>> hist1;  ///< bin contents (with under/overflow) for each histogram handle
+  std::vector<Long64_t> hist1Entries;
+  std::vector<std::vector<Double_t>> hist1Step; ///< values in filling order for each step histogram handle
+  std::vector<st_time_t> timerStamp;
+  std::vector<Long64_t> timerTotal;          ///< in ns
+};
+
+static std::mutex gSTDebugLoggerInstanceMutex;
+static std::atomic<Long64_t> gSTDebugLoggerGeneration(0);
+
+/**
+ * Returns the shard to the logger when the thread exits.
+ * Shard is released only if the logger which owns it is still the instance,
+ * otherwise the shard was already deleted with its logger.
+ */
+struct STDebugLoggerShardHolder
+{
+  STDebugLogger::Shard *shard = nullptr;
+  Long64_t generation = -1; ///< generation of the owner of shard, shard may be deleted
+  ~STDebugLoggerShardHolder() {
+    if (shard == nullptr)
+      return;
+
+    std::lock_guard<std::mutex> lock(gSTDebugLoggerInstanceMutex);
+    STDebugLogger *logger = STDebugLogger::fInstance.load(std::memory_order_acquire);
+    if (logger != NULL && logger -> fGeneration == generation)
+      logger -> ReleaseShard(shard);
+  }
+};
+
+std::atomic<STDebugLogger*> STDebugLogger::fInstance(NULL);
 STDebugLogger* STDebugLogger::Create(TString name)
 {
-  if (fInstance == NULL)
-    fInstance = new STDebugLogger(name);
+  std::lock_guard<std::mutex> lock(gSTDebugLoggerInstanceMutex);
+  STDebugLogger *logger = fInstance.load(std::memory_order_relaxed);
+  if (logger == NULL)
+    logger = new STDebugLogger(name);
   else 
     cout << "STDebugLogger already exist!" << endl;
 
-  return fInstance;
+  return logger;
 }
 
 STDebugLogger* STDebugLogger::Instance() 
 {
-  if (fInstance == NULL)
-    fInstance = new STDebugLogger();
+  STDebugLogger *logger = fInstance.load(std::memory_order_acquire);
+  if (logger != NULL)
+    return logger;
 
-  return fInstance;
+  std::lock_guard<std::mutex> lock(gSTDebugLoggerInstanceMutex);
+  logger = fInstance.load(std::memory_order_relaxed);
+  if (logger == NULL)
+    logger = new STDebugLogger();
+
+  return logger;
 }
 
 STDebugLogger* STDebugLogger::InstanceX() 
 {
-  if (fInstance == NULL)
-    fInstance = new STDebugLogger("");
+  STDebugLogger *logger = fInstance.load(std::memory_order_acquire);
+  if (logger != NULL)
+    return logger;
+
+  std::lock_guard<std::mutex> lock(gSTDebugLoggerInstanceMutex);
+  logger = fInstance.load(std::memory_order_relaxed);
+  if (logger == NULL)
+    logger = new STDebugLogger("");
 
-  return fInstance;
+  return logger;
 }
 
+// fInstance is published at the end of the constructors (release), so
+// threads that see it through Instance() also see the constructed members.
 STDebugLogger::STDebugLogger()
 {
-  if (fInstance != NULL) throw;
-  fInstance = this;
+  if (fInstance.load() != NULL) throw;
+  fEnabled = true;
+  fGeneration = ++gSTDebugLoggerGeneration;
 
   fOutFile = new TFile("st_debug_logger.root","RECREATE");
   fMaxBranchIdx = 0;
+
+  fInstance.store(this, std::memory_order_release);
 }
 
 STDebugLogger::STDebugLogger(TString name)
 {
-  if (fInstance != NULL) throw;
-  fInstance = this;
+  if (fInstance.load() != NULL) throw;
+  fEnabled = true;
+  fGeneration = ++gSTDebugLoggerGeneration;
+  fOutFile = NULL;
+  fMaxBranchIdx = 0;
 
   if (name != "")
   {
@@ -54,23 +110,246 @@ STDebugLogger::STDebugLogger(TString name)
     fOutFile = new TFile(name,"RECREATE");
     fMaxBranchIdx = 0;
   }
+
+  fInstance.store(this, std::memory_order_release);
 }
 
 STDebugLogger::~STDebugLogger()
 {
+  // Threads exiting after this do not release their shards to this logger
+  {
+    std::lock_guard<std::mutex> lock(gSTDebugLoggerInstanceMutex);
+    if (fInstance.load(std::memory_order_relaxed) == this)
+      fInstance.store(NULL, std::memory_order_release);
+  }
+
   if (fOutFile != NULL)
   {
     fOutFile -> Close();
     delete fOutFile;
   }
+
+  for (auto shard : fShards)
+    delete shard;
+}
+
+void STDebugLogger::SetEnabled(Bool_t val) { fEnabled = val; }
+
+Int_t
+STDebugLogger::RegisterHist1(TString name, Int_t nbins, Double_t min, Double_t max)
+{
+  return RegisterHist1Def(name, nbins, min, max, kFALSE);
+}
+
+Int_t
+STDebugLogger::RegisterHist1Step(TString name, Int_t nbins, Double_t min, Double_t max)
+{
+  return RegisterHist1Def(name, nbins, min, max, kTRUE);
+}
+
+Int_t
+STDebugLogger::RegisterHist1Def(TString name, Int_t nbins, Double_t min, Double_t max, Bool_t step)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+
+  for (Int_t handle = 0; handle < fHist1Defs.size(); handle++)
+    if (fHist1Defs[handle].name == name)
+      return handle;
+
+  Hist1Def def;
+  def.name = name;
+  def.nbins = nbins;
+  def.min = min;
+  def.max = max;
+  def.step = step;
+  fHist1Defs.push_back(def);
+
+  return fHist1Defs.size() - 1;
+}
+
+Int_t
+STDebugLogger::RegisterTimer(TString name)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+
+  for (Int_t handle = 0; handle < fTimerNames.size(); handle++)
+    if (fTimerNames[handle] == name)
+      return handle;
+
+  fTimerNames.push_back(name);
+
+  return fTimerNames.size() - 1;
+}
+
+STDebugLogger::Shard*
+STDebugLogger::GetShard()
+{
+  static thread_local STDebugLoggerShardHolder holder;
+  if (holder.shard == nullptr || holder.generation != fGeneration) {
+    // Shard of a previous logger is deleted with that logger
+    holder.shard = AcquireShard();
+    holder.generation = fGeneration;
+  }
+
+  return holder.shard;
+}
+
+STDebugLogger::Shard*
+STDebugLogger::AcquireShard()
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+
+  if (!fFreeShards.empty()) {
+    Shard *shard = fFreeShards.back();
+    fFreeShards.pop_back();
+    return shard;
+  }
+
+  Shard *shard = new Shard();
+  shard -> generation = fGeneration;
+  fShards.push_back(shard);
+
+  return shard;
+}
+
+void
+STDebugLogger::ReleaseShard(Shard *shard)
+{
+  // Contents are kept. They are only added up in Write(), so it does not matter which thread filled them.
+  std::lock_guard<std::mutex> lock(fMutex);
+  if (shard -> generation == fGeneration)
+    fFreeShards.push_back(shard);
+}
+
+void
+STDebugLogger::Fill1Shard(Int_t handle, Double_t val)
+{
+  Shard *shard = GetShard();
+  if (shard -> hist1.size() <= handle) {
+    shard -> hist1.resize(handle + 1);
+    shard -> hist1Entries.resize(handle + 1, 0);
+  }
+
+  auto &bins = shard -> hist1[handle];
+  const Hist1Def &def = fHist1Defs[handle];
+  if (bins.empty())
+    bins.resize(def.nbins + 2, 0);
+
+  Int_t bin;
+  if (val < def.min)
+    bin = 0;
+  else if (val >= def.max)
+    bin = def.nbins + 1;
+  else
+    bin = 1 + Int_t(def.nbins * (val - def.min) / (def.max - def.min));
+
+  bins[bin] += 1;
+  shard -> hist1Entries[handle]++;
+}
+
+void
+STDebugLogger::Fill1StepShard(Int_t handle, Double_t val)
+{
+  Shard *shard = GetShard();
+  if (shard -> hist1Step.size() <= handle)
+    shard -> hist1Step.resize(handle + 1);
+
+  shard -> hist1Step[handle].push_back(val);
+}
+
+void
+STDebugLogger::TimerStartShard(Int_t handle)
+{
+  Shard *shard = GetShard();
+  if (shard -> timerStamp.size() <= handle) {
+    shard -> timerStamp.resize(handle + 1);
+    shard -> timerTotal.resize(handle + 1, 0);
+  }
+
+  shard -> timerStamp[handle] = std::chrono::high_resolution_clock::now();
+}
+
+void
+STDebugLogger::TimerStopShard(Int_t handle)
+{
+  st_time_t now = std::chrono::high_resolution_clock::now();
+
+  Shard *shard = GetShard();
+  if (shard -> timerStamp.size() <= handle)
+    return;
+
+  shard -> timerTotal[handle] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - shard -> timerStamp[handle]).count();
+}
+
+void
+STDebugLogger::MergeShards()
+{
+  for (Int_t handle = 0; handle < fHist1Defs.size(); handle++)
+  {
+    const Hist1Def &def = fHist1Defs[handle];
+
+    TH1D *hist = fMapHist1[def.name];
+    if (hist == NULL) {
+      if (fOutFile != NULL)
+        fOutFile -> cd();
+      hist = new TH1D(def.name, "", def.nbins, def.min, def.max);
+      fMapHist1[def.name] = hist;
+    }
+
+    if (def.step) {
+      // Same as FillHist1Step(). The sequence is kept per thread, shard after shard.
+      for (auto shard : fShards)
+      {
+        if (shard -> hist1Step.size() <= handle)
+          continue;
+
+        for (auto val : shard -> hist1Step[handle])
+          hist -> Fill(hist -> GetEntries(), val);
+        shard -> hist1Step[handle].clear();
+      }
+      continue;
+    }
+
+    Long64_t entries = hist -> GetEntries();
+    for (auto shard : fShards)
+    {
+      if (shard -> hist1.size() <= handle || shard -> hist1[handle].empty())
+        continue;
+
+      auto &bins = shard -> hist1[handle];
+      for (Int_t bin = 0; bin < bins.size(); bin++)
+        hist -> AddBinContent(bin, bins[bin]);
+      entries += shard -> hist1Entries[handle];
+
+      bins.assign(bins.size(), 0);
+      shard -> hist1Entries[handle] = 0;
+    }
+    hist -> SetEntries(entries);
+  }
+
+  for (Int_t handle = 0; handle < fTimerNames.size(); handle++)
+  {
+    Long64_t total = 0;
+    for (auto shard : fShards) {
+      if (shard -> timerTotal.size() > handle) {
+        total += shard -> timerTotal[handle];
+        shard -> timerTotal[handle] = 0;
+      }
+    }
+    fTimeTotal[fTimerNames[handle]] += total / 1000000;
+  }
 }
 
 void 
 STDebugLogger::Write()
 {
+  std::lock_guard<std::mutex> lock(fMutex);
+
   if (fOutFile == NULL)
     return;
 
+  MergeShards();
+
   fOutFile -> cd();
 
   Int_t total_time = 0;
@@ -96,7 +375,6 @@ STDebugLogger::Write()
   std::map<TString, TH1D*>::iterator itHist1D = fMapHist1.begin();
   while (itHist1D != fMapHist1.end()) 
   {
-    cout << itTimer -> second << endl;
     cout << "STDebugLogger::Writing 1D Histogram " << itHist1D -> first << endl;
     itHist1D -> second -> Write();
     delete itHist1D -> second;
@@ -124,6 +402,7 @@ STDebugLogger::Write()
   if (fOutFile != NULL) {
     fOutFile -> Close();
     delete fOutFile;
+    fOutFile = NULL;
   }
 }
 
@@ -131,6 +410,11 @@ void
 STDebugLogger::FillHist1(TString name, Double_t val,
                          Int_t nbins, Double_t min, Double_t max)
 {
+  if (!IsEnabled())
+    return;
+
+  std::lock_guard<std::mutex> lock(fMutex);
+
   if (fMapHist1[name] == NULL)
   {
     fOutFile -> cd();
@@ -145,6 +429,11 @@ void
 STDebugLogger::FillHist1Step(TString name, Double_t val,
                              Int_t nbins, Double_t min, Double_t max)
 {
+  if (!IsEnabled())
+    return;
+
+  std::lock_guard<std::mutex> lock(fMutex);
+
   if (fMapHist1[name] == NULL)
   {
     fOutFile -> cd();
@@ -160,6 +449,11 @@ STDebugLogger::FillHist2(TString name, Double_t xval, Double_t yval,
                          Int_t xnbins, Double_t xmin, Double_t xmax,
                          Int_t ynbins, Double_t ymin, Double_t ymax)
 {
+  if (!IsEnabled())
+    return;
+
+  std::lock_guard<std::mutex> lock(fMutex);
+
   if (fMapHist2[name] == NULL)
   {
     fOutFile -> cd();
@@ -174,6 +468,11 @@ STDebugLogger::FillHist2(TString name, Double_t xval, Double_t yval,
 void 
 STDebugLogger::FillTree(TString name, Int_t nVal, Double_t *val, TString *bname)
 {
+  if (!IsEnabled())
+    return;
+
+  std::lock_guard<std::mutex> lock(fMutex);
+
   if (fMapTree[name] == NULL)
   {
     fOutFile -> cd();
@@ -217,18 +516,27 @@ STDebugLogger::FillTree(TString name, Int_t nVal, Double_t *val, TString *bname)
 TTree*
 STDebugLogger::GetTree(TString name)
 {
+  std::lock_guard<std::mutex> lock(fMutex);
   return fMapTree[name];
 }
 
 void 
 STDebugLogger::TimerStart(TString name)
 {
+  if (!IsEnabled())
+    return;
+
+  std::lock_guard<std::mutex> lock(fMutex);
   fTimeStamp[name] = std::chrono::high_resolution_clock::now();
 }
 
 void 
 STDebugLogger::TimerStop(TString name) 
 { 
+  if (!IsEnabled())
+    return;
+
+  std::lock_guard<std::mutex> lock(fMutex);
   st_time_t stamp = fTimeStamp[name];
   st_time_t now = std::chrono::high_resolution_clock::now();
   
@@ -239,15 +547,21 @@ STDebugLogger::TimerStop(TString name)
 void 
 STDebugLogger::SetObject(TString name, TObject* object)
 {
+  std::lock_guard<std::mutex> lock(fMutex);
   //if (fMapObject[name] == NULL)
     fMapObject[name] = object;
 }
 
-TObject* STDebugLogger::GetObject(TString name) { return fMapObject[name] != NULL ? fMapObject[name] : NULL; }
+TObject* STDebugLogger::GetObject(TString name)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fMapObject[name] != NULL ? fMapObject[name] : NULL;
+}
 
 void 
 STDebugLogger::SetIntPar(TString name, Int_t val)
 {
+  std::lock_guard<std::mutex> lock(fMutex);
   //fItMapIntPar = fMapIntPar.find(name);
   //if (fItMapIntPar != fMapIntPar.end())
     fMapIntPar[name] = val;
@@ -256,6 +570,7 @@ STDebugLogger::SetIntPar(TString name, Int_t val)
 Bool_t 
 STDebugLogger::GetIntPar(TString name, Int_t &val) 
 { 
+  std::lock_guard<std::mutex> lock(fMutex);
   fItMapIntPar = fMapIntPar.find(name);
   if (fItMapIntPar != fMapIntPar.end()) {
     val = fItMapIntPar -> second;
@@ -285,5 +600,5 @@ STDebugLogger::Print(TString header, TString message)
 }
 
 TFile* STDebugLogger::GetOutFile() { return fOutFile; }
-TH1D*  STDebugLogger::GetHist1(TString name) { return fMapHist1[name] != NULL ? fMapHist1[name] : NULL; }
-TH2D*  STDebugLogger::GetHist2(TString name) { return fMapHist2[name] != NULL ? fMapHist2[name] : NULL; }
+TH1D*  STDebugLogger::GetHist1(TString name) { std::lock_guard<std::mutex> lock(fMutex); return fMapHist1[name] != NULL ? fMapHist1[name] : NULL; }
+TH2D*  STDebugLogger::GetHist2(TString name) { std::lock_guard<std::mutex> lock(fMutex); return fMapHist2[name] != NULL ? fMapHist2[name] : NULL; }
@@ -14,9 +14,28 @@
 #include <vector> 
 #include <iostream>
 #include <chrono>
+#include <mutex>
+#include <atomic>
 
 typedef std::chrono::high_resolution_clock::time_point st_time_t;
 
+/**
+ * Debug histograms, trees and timers written to one ROOT file.
+ *
+ * Two interfaces are provided:
+ *
+ *  - String interface (FillHist1("name", ...), TimerStart("name"), ...).
+ *    Objects are looked up by name on every call and a mutex is taken,
+ *    so it is safe but slow. Fine outside of loops.
+ *
+ *  - Handle interface (RegisterHist1(), Fill1(), RegisterTimer(), ...).
+ *    Register once in the main thread (in Init()) and keep the handle.
+ *    Each thread fills its own shard without any lock, and the shards are
+ *    merged in Write(). Use this from hot loops and worker threads.
+ *
+ * Both interfaces return right away when the logger is disabled with
+ * SetEnabled(false), so the calls can be left in production code.
+ */
 class STDebugLogger
 {
   public:
@@ -28,8 +47,28 @@ class STDebugLogger
     STDebugLogger(TString name);
     ~STDebugLogger();
 
+    /// Merge thread shards and write. Worker threads must be finished before.
     void Write();
 
+    void SetEnabled(Bool_t val = kTRUE);
+    Bool_t IsEnabled() const { return fEnabled.load(std::memory_order_relaxed); }
+
+
+    //////////////////////////////////////////////////////////////////////////////
+    /// Return handle of histogram. Must not be called while other threads are filling.
+    Int_t RegisterHist1(TString name, Int_t nbins = 100, Double_t min = 0., Double_t max = 100.);
+    /// Same as RegisterHist1() but for Fill1Step(), the handle version of FillHist1Step().
+    Int_t RegisterHist1Step(TString name, Int_t nbins = 100, Double_t min = 0., Double_t max = 100.);
+    /// Return handle of timer. Must not be called while other threads are filling.
+    Int_t RegisterTimer(TString name);
+
+    void Fill1(Int_t handle, Double_t val)  { if (IsEnabled()) Fill1Shard(handle, val); }
+    void Fill1Step(Int_t handle, Double_t val) { if (IsEnabled()) Fill1StepShard(handle, val); }
+    void TimerStart(Int_t handle)           { if (IsEnabled()) TimerStartShard(handle); }
+    void TimerStop(Int_t handle)            { if (IsEnabled()) TimerStopShard(handle); }
+    //////////////////////////////////////////////////////////////////////////////
+
+
     //////////////////////////////////////////////////////////////////////////////
     void FillHist1(TString name, Double_t val,
                    Int_t nbins = 100, Double_t min = 0., Double_t max = 100.);
@@ -78,6 +117,35 @@ class STDebugLogger
     ///////////////////////////////////////////////
 
   private:
+    friend struct STDebugLoggerShardHolder;
+    struct Shard;
+
+    Shard *GetShard();
+    Shard *AcquireShard();
+    void ReleaseShard(Shard *shard);
+    void MergeShards();
+
+    Int_t RegisterHist1Def(TString name, Int_t nbins, Double_t min, Double_t max, Bool_t step);
+    void Fill1Shard(Int_t handle, Double_t val);
+    void Fill1StepShard(Int_t handle, Double_t val);
+    void TimerStartShard(Int_t handle);
+    void TimerStopShard(Int_t handle);
+
+    std::atomic<bool> fEnabled; //!
+    Long64_t fGeneration; //! number of the logger since the start, tag of its shards
+    std::mutex fMutex; //! lock of string interface and shard list
+
+    struct Hist1Def {
+      TString name;
+      Int_t nbins;
+      Double_t min, max;
+      Bool_t step; ///< filled in sequence by Fill1Step()
+    };
+    std::vector<Hist1Def> fHist1Defs; //!
+    std::vector<TString> fTimerNames; //!
+    std::vector<Shard*> fShards; //! all shards, owned by logger
+    std::vector<Shard*> fFreeShards; //! shards of finished threads, reused by new threads
+
     ////////////////////////////////////
     TFile* fOutFile;
     std::map<TString, TH1D*> fMapHist1;
@@ -109,7 +177,7 @@ class STDebugLogger
     std::map<TString, Int_t>::iterator fItMapIntPar;
     ////////////////////////////////////////
 
-    static STDebugLogger* fInstance;
+    static std::atomic<STDebugLogger*> fInstance;
 
   ClassDef(STDebugLogger, 1)
 };
@@ -0,0 +1,234 @@
+#include "STTaskProfiler.hh"
+
+#include "TFile.h"
+#include "TSystem.h"
+#include "TMath.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <ctime>
+
+using namespace std;
+
+STTaskProfiler* STTaskProfiler::fInstance = nullptr;
+
+STTaskProfiler* STTaskProfiler::Instance()
+{
+  static std::once_flag flag;
+  std::call_once(flag, []() { fInstance = new STTaskProfiler(); });
+
+  return fInstance;
+}
+
+STTaskProfiler::STTaskProfiler()
+{
+  fEnabled = false;
+  fLastMemorySample = 0.;
+
+  fHistRSS = new TH1D("rss", "process;resident memory (MB)", 200, 0, 1000);
+  fHistRSS -> SetDirectory(nullptr);
+  fHistRSS -> SetCanExtend(TH1::kAllAxes);
+
+  const char *env = gSystem -> Getenv("ST_TASK_PROFILE");
+  if (env != nullptr) {
+    fEnabled = true;
+    TString name = env;
+    if (!name.IsNull() && name != "1")
+      fOutputName = name;
+  }
+}
+
+STTaskProfiler::~STTaskProfiler()
+{
+  for (auto &stat : fStats) {
+    delete stat.histWall;
+    delete stat.histCpu;
+    delete stat.histObjects;
+  }
+  delete fHistRSS;
+}
+
+void STTaskProfiler::SetEnabled(Bool_t val) { fEnabled = val; }
+void STTaskProfiler::SetOutputName(TString name) { fOutputName = name; }
+void STTaskProfiler::SetMemoryInterval(Double_t interval) { fMemoryInterval = interval; }
+
+Int_t STTaskProfiler::Register(TString taskName)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+
+  for (Int_t handle = 0; handle < fStats.size(); handle++) {
+    if (fStats[handle].name == taskName) {
+      fStats[handle].numInstances++;
+      return handle;
+    }
+  }
+
+  TaskStat stat;
+  stat.name = taskName;
+  stat.numInstances = 1;
+
+  TString hname = taskName;
+  hname.ReplaceAll(" ", "");
+
+  stat.histWall     = new TH1D(hname + "_wall",    taskName + ";wall time (ms)", 200, 0, 10);
+  stat.histCpu      = new TH1D(hname + "_cpu",     taskName + ";cpu time (ms)", 200, 0, 10);
+  stat.histObjects  = new TH1D(hname + "_objects", taskName + ";number of output objects", 200, 0, 200);
+  for (auto hist : {stat.histWall, stat.histCpu, stat.histObjects}) {
+    hist -> SetDirectory(nullptr);
+    hist -> SetCanExtend(TH1::kAllAxes);
+  }
+
+  fStats.push_back(stat);
+
+  return fStats.size() - 1;
+}
+
+void STTaskProfiler::Now(Double_t &wall, Double_t &cpu)
+{
+  wall = std::chrono::duration<Double_t, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+  // cpu time of the calling thread only, so that tasks running in parallel are not mixed up
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  cpu = ts.tv_sec * 1.e3 + ts.tv_nsec * 1.e-6;
+}
+
+void STTaskProfiler::SampleMemory()
+{
+  Double_t now = std::chrono::duration<Double_t, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  Double_t last = fLastMemorySample.load(std::memory_order_relaxed);
+  if (now - last < fMemoryInterval)
+    return;
+
+  // Only the thread which updates the time stamp reads /proc
+  if (!fLastMemorySample.compare_exchange_strong(last, now))
+    return;
+
+  ProcInfo_t info;
+  gSystem -> GetProcInfo(&info);
+
+  std::lock_guard<std::mutex> lock(fMutex);
+
+  fNumMemorySamples++;
+  fLastRSS = info.fMemResident;
+  if (fLastRSS > fMaxRSS)
+    fMaxRSS = fLastRSS;
+  fHistRSS -> Fill(fLastRSS / 1024.);
+}
+
+void STTaskProfiler::Fill(Int_t handle, Double_t wall, Double_t cpu, Long_t numObjects)
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+
+  TaskStat &stat = fStats[handle];
+  stat.numEvents++;
+  stat.sumWall += wall;
+  stat.sumWall2 += wall * wall;
+  if (wall > stat.maxWall)
+    stat.maxWall = wall;
+  stat.sumCpu += cpu;
+  stat.sumObjects += numObjects;
+
+  stat.histWall -> Fill(wall);
+  stat.histCpu -> Fill(cpu);
+  stat.histObjects -> Fill(numObjects);
+}
+
+void STTaskProfiler::Finish(Int_t handle)
+{
+  Bool_t allFinished = kTRUE;
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+
+    fStats[handle].numFinished++;
+    for (auto &stat : fStats)
+      if (stat.numFinished < stat.numInstances)
+        allFinished = kFALSE;
+  }
+
+  if (allFinished && IsEnabled())
+    Write();
+}
+
+void STTaskProfiler::Print()
+{
+  std::lock_guard<std::mutex> lock(fMutex);
+
+  Double_t totalWall = 0;
+  for (auto &stat : fStats)
+    totalWall += stat.sumWall;
+
+  cout << "-- Task profile" << endl;
+  cout << "   " << left << setw(30) << "task" << right
+       << setw(8)  << "events"
+       << setw(12) << "wall(ms)"
+       << setw(10) << "rms(ms)"
+       << setw(12) << "max(ms)"
+       << setw(12) << "cpu(ms)"
+       << setw(10) << "objects"
+       << setw(8)  << "%" << endl;
+
+  for (auto &stat : fStats)
+  {
+    Double_t n = stat.numEvents > 0 ? stat.numEvents : 1;
+    Double_t mean = stat.sumWall / n;
+    Double_t rms = TMath::Sqrt(TMath::Max(0., stat.sumWall2 / n - mean * mean));
+
+    cout << "   " << left << setw(30) << stat.name << right << fixed << setprecision(2)
+         << setw(8)  << stat.numEvents
+         << setw(12) << mean
+         << setw(10) << rms
+         << setw(12) << stat.maxWall
+         << setw(12) << stat.sumCpu / n
+         << setw(10) << stat.sumObjects / n
+         << setw(8)  << (totalWall > 0 ? stat.sumWall / totalWall * 100 : 0.) << endl;
+  }
+  cout << "   process resident memory (MB): max " << fMaxRSS / 1024. << ", last " << fLastRSS / 1024.
+       << " (" << fNumMemorySamples << " samples)" << endl;
+  cout << endl;
+}
+
+void STTaskProfiler::Write()
+{
+  {
+    // Only the first caller writes, also if two threads finish at once
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (fIsWritten)
+      return;
+    fIsWritten = kTRUE;
+  }
+
+  Print();
+
+  std::lock_guard<std::mutex> lock(fMutex);
+
+  ofstream csv((fOutputName + ".csv").Data());
+  csv << "task,instances,events,wall_mean_ms,wall_rms_ms,wall_max_ms,cpu_mean_ms,objects_mean" << endl;
+  for (auto &stat : fStats)
+  {
+    Double_t n = stat.numEvents > 0 ? stat.numEvents : 1;
+    Double_t mean = stat.sumWall / n;
+    Double_t rms = TMath::Sqrt(TMath::Max(0., stat.sumWall2 / n - mean * mean));
+
+    csv << stat.name << "," << stat.numInstances << "," << stat.numEvents << ","
+        << mean << "," << rms << "," << stat.maxWall << "," << stat.sumCpu / n << ","
+        << stat.sumObjects / n << endl;
+  }
+  csv.close();
+
+  TDirectory *directory = gDirectory;
+  TFile file(fOutputName + ".root", "RECREATE");
+  for (auto &stat : fStats) {
+    stat.histWall -> Write();
+    stat.histCpu -> Write();
+    stat.histObjects -> Write();
+  }
+  fHistRSS -> Write();
+  file.Close();
+  if (directory != nullptr)
+    directory -> cd();
+
+  cout << "-- Task profile written to " << fOutputName << ".csv and " << fOutputName << ".root" << endl;
+}
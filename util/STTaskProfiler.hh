@@ -0,0 +1,108 @@
+/**
+ * @brief Run time profiler of reconstruction tasks.
+ *
+ * @author JungWoo Lee
+ *
+ * @detail
+ *
+ *   Collects wall time, cpu time and number of output objects of each task
+ *   for every event. Profiling is off by default
+ *   and is switched on at run time with
+ *
+ *     STTaskProfiler::Instance() -> SetEnabled();
+ *
+ *   or by setting the environment variable ST_TASK_PROFILE (its value, if not
+ *   "1", is used as the output name). When disabled, the cost is one atomic
+ *   load per task per event.
+ *
+ *   At the end of the run (when every registered task called Finish()),
+ *   a summary table is printed and two files are written:
+ *     [name].root : histograms of each task
+ *     [name].csv  : one line per task, for scripts comparing versions
+ *
+ *   Memory is the resident set size of the whole process, read from /proc at
+ *   most once per SetMemoryInterval() (1 s by default) after an Exec(), not per
+ *   task: it cannot be split between tasks running in parallel lanes. Maximum
+ *   and last values are given in the summary, samples in the histogram "rss".
+ *   Heap allocations are not counted, since no allocator hook is installed.
+ */
+
+#ifndef STTASKPROFILER
+#define STTASKPROFILER
+
+#include "TString.h"
+#include "TH1D.h"
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+class STTaskProfiler
+{
+  public:
+    static STTaskProfiler* Instance();
+
+    STTaskProfiler();
+    ~STTaskProfiler();
+
+    void SetEnabled(Bool_t val = kTRUE);
+    Bool_t IsEnabled() const { return fEnabled.load(std::memory_order_relaxed); }
+
+    /// Output name without extension. Default is "st_task_profile".
+    void SetOutputName(TString name);
+
+    /**
+     * Register one instance of task and return its handle.
+     * Instances with the same name (lanes of STEventParallelTask) share the handle.
+     */
+    Int_t Register(TString taskName);
+
+    /// Minimum time between two samples of the resident memory [ms]
+    void SetMemoryInterval(Double_t interval);
+
+    /// Time stamps of current thread; wall and cpu in ms
+    static void Now(Double_t &wall, Double_t &cpu);
+
+    /// Add measurement of one event
+    void Fill(Int_t handle, Double_t wall, Double_t cpu, Long_t numObjects);
+
+    /// Sample resident memory if the last sample is older than the memory interval
+    void SampleMemory();
+
+    /// Called from Finish() of task. Write() is called when all instances are finished.
+    void Finish(Int_t handle);
+
+    void Print();
+    void Write();
+
+  private:
+    struct TaskStat {
+      TString name;
+      Int_t numInstances = 0;
+      Int_t numFinished = 0;
+      Long64_t numEvents = 0;
+      Double_t sumWall = 0, sumWall2 = 0, maxWall = 0;
+      Double_t sumCpu = 0;
+      Double_t sumObjects = 0;
+      TH1D *histWall = nullptr;
+      TH1D *histCpu = nullptr;
+      TH1D *histObjects = nullptr;
+    };
+
+    std::atomic<bool> fEnabled;
+    TString fOutputName = "st_task_profile";
+    std::vector<TaskStat> fStats;
+    std::mutex fMutex;
+    Bool_t fIsWritten = kFALSE;
+
+    Double_t fMemoryInterval = 1000.;           ///< [ms]
+    std::atomic<Double_t> fLastMemorySample;    ///< wall time of the last sample [ms]
+    Long64_t fNumMemorySamples = 0;
+    Long_t fMaxRSS = 0;                         ///< [kB]
+    Long_t fLastRSS = 0;                        ///< [kB]
+    TH1D *fHistRSS = nullptr;
+
+    static STTaskProfiler* fInstance;
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "STThreadPool.hh"
+
+#include "TROOT.h"
+
+#include <atomic>
+#include <memory>
+using namespace std;
+
+STThreadPool* STThreadPool::fInstance = nullptr;
+
+STThreadPool* STThreadPool::Instance()
+{
+  static std::once_flag flag;
+  std::call_once(flag, []() { fInstance = new STThreadPool(); });
+
+  return fInstance;
+}
+
+STThreadPool::STThreadPool(Int_t numThreads)
+{
+  if (numThreads <= 0)
+    numThreads = std::thread::hardware_concurrency();
+  if (numThreads <= 0)
+    numThreads = 1;
+
+  // Jobs create TObjects and expand TClonesArrays concurrently
+  static std::once_flag threadSafetyFlag;
+  std::call_once(threadSafetyFlag, []() { ROOT::EnableThreadSafety(); });
+
+  for (Int_t iThread = 0; iThread < numThreads; iThread++)
+    fThreads.push_back(std::thread([this]() { this -> WorkerLoop(); }));
+}
+
+STThreadPool::~STThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStop = true;
+  }
+  fCondition.notify_all();
+
+  for (auto &thread : fThreads)
+    thread.join();
+}
+
+Int_t STThreadPool::GetNumThreads() const { return fThreads.size(); }
+
+void STThreadPool::WorkerLoop()
+{
+  while (1)
+  {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      fCondition.wait(lock, [this]() { return fStop || !fQueue.empty(); });
+
+      if (fStop && fQueue.empty())
+        return;
+
+      job = std::move(fQueue.front());
+      fQueue.pop_front();
+    }
+    job();
+  }
+}
+
+std::future<void> STThreadPool::Submit(std::function<void()> job)
+{
+  auto task = std::make_shared<std::packaged_task<void()>>(job);
+  std::future<void> result = task -> get_future();
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fQueue.push_back([task]() { (*task)(); });
+  }
+  fCondition.notify_one();
+
+  return result;
+}
+
+void STThreadPool::ParallelFor(Int_t numJobs, std::function<void(Int_t, Int_t)> job, Int_t chunkSize, Int_t maxWorkers)
+{
+  if (numJobs <= 0)
+    return;
+
+  if (chunkSize < 1)
+    chunkSize = 1;
+
+  Int_t numChunks = (numJobs + chunkSize - 1) / chunkSize;
+  Int_t numHelpers = GetNumThreads();
+  if (maxWorkers > 0 && numHelpers > maxWorkers - 1) numHelpers = maxWorkers - 1;
+  if (numHelpers > numChunks - 1) numHelpers = numChunks - 1;
+
+  /**
+   * State is shared with the helpers through shared_ptr, because a queued
+   * helper may start after this call has already returned. Such a helper
+   * finds the state closed and returns without touching the jobs.
+   */
+  struct State {
+    std::atomic<Int_t> next;
+    std::mutex mutex;
+    std::condition_variable condition;
+    Int_t numRunning = 0;
+    Int_t numWorkers = 0;
+    bool closed = false;
+  };
+  auto state = std::make_shared<State>();
+  state -> next = 0;
+
+  auto RunChunks = [state, numJobs, chunkSize, &job](Int_t iWorker) {
+    while (1) {
+      Int_t begin = state -> next.fetch_add(chunkSize);
+      if (begin >= numJobs)
+        break;
+      Int_t end = begin + chunkSize;
+      if (end > numJobs)
+        end = numJobs;
+      for (Int_t iJob = begin; iJob < end; iJob++)
+        job(iJob, iWorker);
+    }
+  };
+
+  for (Int_t iHelper = 0; iHelper < numHelpers; iHelper++)
+  {
+    Submit([state, RunChunks]() {
+      Int_t iWorker;
+      {
+        std::lock_guard<std::mutex> lock(state -> mutex);
+        if (state -> closed)
+          return;
+        state -> numRunning++;
+        iWorker = state -> numWorkers++;
+      }
+
+      RunChunks(iWorker);
+
+      {
+        std::lock_guard<std::mutex> lock(state -> mutex);
+        state -> numRunning--;
+      }
+      state -> condition.notify_all();
+    });
+  }
+
+  RunChunks(numHelpers);
+
+  std::unique_lock<std::mutex> lock(state -> mutex);
+  state -> closed = true;
+  state -> condition.wait(lock, [state]() { return state -> numRunning == 0; });
+}
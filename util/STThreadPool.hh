@@ -0,0 +1,71 @@
+/**
+ * @brief Persistent pool of worker threads.
+ *
+ * @author JungWoo Lee
+ *
+ * @detail
+ *
+ *   Threads are created once and kept alive for the whole job, so that
+ *   per-event parallel sections do not pay for thread creation.
+ *   Jobs can be queued one by one with Submit(), or a range of jobs can
+ *   be processed with ParallelFor(). The calling thread of ParallelFor()
+ *   takes part in the work, so it is safe to call ParallelFor() from
+ *   inside a job which is already running on the pool.
+ */
+
+#ifndef STTHREADPOOL
+#define STTHREADPOOL
+
+#include "Rtypes.h"
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+
+class STThreadPool
+{
+  public:
+    /**
+     * Create pool with numThreads threads. If 0, hardware concurrency is used.
+     * ROOT::EnableThreadSafety() is called before the first pool starts its threads.
+     */
+    STThreadPool(Int_t numThreads = 0);
+    ~STThreadPool();
+
+    /// Process-wide pool. Created on first call.
+    static STThreadPool *Instance();
+
+    /// Number of worker threads (calling thread not included).
+    Int_t GetNumThreads() const;
+
+    /// Queue a job. Returned future becomes ready when the job is finished.
+    std::future<void> Submit(std::function<void()> job);
+
+    /**
+     * Run job(iJob, iWorker) for iJob in [0, numJobs) and wait until all are done.
+     *
+     * Jobs are handed out through an atomic counter in chunks of chunkSize,
+     * so there is no lock while the jobs are running. iWorker is in
+     * [0, GetNumThreads()] and is unique among the workers of this call, so it
+     * can be used to index per-thread buffers of size GetNumThreads()+1.
+     * maxWorkers limits the number of workers used (0 for all).
+     */
+    void ParallelFor(Int_t numJobs, std::function<void(Int_t, Int_t)> job, Int_t chunkSize = 1, Int_t maxWorkers = 0);
+
+  private:
+    void WorkerLoop();
+
+    std::vector<std::thread> fThreads;
+    std::deque<std::function<void()>> fQueue;
+    std::mutex fMutex;
+    std::condition_variable fCondition;
+    bool fStop = false;
+
+    static STThreadPool *fInstance;
+};
+
+#endif